@@ -83,7 +83,7 @@ Tree *Action::DoBlock(Block *what)
 //    Default is to firm perform action on block's child, then on self
 // ----------------------------------------------------------------------------
 {
-    what->child = what->child->Do(this);
+    what->child.Set(what, what->child->Do(this));
     return Do(what);
 }
 
@@ -93,8 +93,8 @@ Tree *Action::DoPrefix(Prefix *what)
 //   Default is to run the action on the left, then on right
 // ----------------------------------------------------------------------------
 {
-    what->left = what->left->Do(this);
-    what->right = what->right->Do(this);
+    what->left.Set(what, what->left->Do(this));
+    what->right.Set(what, what->right->Do(this));
     return Do(what);
 }
 
@@ -104,8 +104,8 @@ Tree *Action::DoPostfix(Postfix *what)
 //   Default is to run the action on the right, then on the left
 // ----------------------------------------------------------------------------
 {
-    what->right = what->right->Do(this);
-    what->left = what->left->Do(this);
+    what->right.Set(what, what->right->Do(this));
+    what->left.Set(what, what->left->Do(this));
     return Do(what);
 }
 
@@ -115,8 +115,17 @@ Tree *Action::DoInfix(Infix *what)
 //   Default is to run the action on children first
 // ----------------------------------------------------------------------------
 {
-    what->left = what->left->Do(this);
-    what->right = what->right->Do(this);
+    what->left.Set(what, what->left->Do(this));
+    what->right.Set(what, what->right->Do(this));
+    return Do(what);
+}
+
+
+Tree *Action::DoArray(Array *what)
+// ----------------------------------------------------------------------------
+//   Default is simply to invoke 'Do', items are values, not source code
+// ----------------------------------------------------------------------------
+{
     return Do(what);
 }
 
@@ -52,6 +52,7 @@ struct Prefix;                                  // Prefix: sin X
 struct Postfix;                                 // Postfix: 3!
 struct Infix;                                   // Infix: A+B, newline
 struct Block;                                   // Block: (A), {A}
+struct Array;                                   // Array: array (1, 2, 3)
 
 struct Action
 // ----------------------------------------------------------------------------
@@ -74,6 +75,7 @@ struct Action
     virtual Tree *DoPostfix(Postfix *what);
     virtual Tree *DoInfix(Infix *what);
     virtual Tree *DoBlock(Block *what);
+    virtual Tree *DoArray(Array *what);
 };
 
 ELFE_END
@@ -70,7 +70,9 @@ bool RewriteBinding::IsDeferred()
 
     // Defer sequences and function definitions
     if (Infix *infix = val->AsInfix())
-        return infix->name == ";" || infix->name == "\n" || infix->name == "->";
+        return (infix->name == Infix::semicolon ||
+                infix->name == Infix::newline ||
+                infix->name == Infix::rewrite);
 
     return false;
 }
@@ -219,7 +221,7 @@ RewriteCalls::Bind(Context *context,
     {
         Text *f = (Text *) form;
         if (Text *iv = value->AsText())
-            return iv->value == f->value ? PERFECT : FAILED;
+            return iv->Value() == f->value ? PERFECT : FAILED;
         type = types->Type(value);
         if (Unify(rc, type, text_type, value, form))
         {
@@ -283,7 +285,7 @@ RewriteCalls::Bind(Context *context,
         Infix *fi = (Infix *) form;
 
         // Check type declarations
-        if (fi->name == ":" || fi->name == "as")
+        if (fi->name == Infix::colon || fi->name == Infix::as)
         {
             // Check if we can bind the value from what we know
             if (Bind(context, fi->left, value, rc) == FAILED)
@@ -298,7 +300,7 @@ RewriteCalls::Bind(Context *context,
             return rc.Unconditional() ? PERFECT : POSSIBLE;
 
         } // We have an infix :
-        else if (fi->name == "when")
+        else if (fi->name == Infix::when)
         {
             // We have a guard - first test if we can bind the left part
             if (Bind(context, fi->left, value, rc) == FAILED)
@@ -23,8 +23,10 @@
 #include "save.h"
 #include "errors.h"
 #include "basics.h"
+#include "tree-share.h"
 
 #include <algorithm>
+#include <map>
 #include <sstream>
 
 ELFE_BEGIN
@@ -74,6 +76,68 @@ Function *CompileToBytecode(Context *ctx, Tree *what, Tree *type,
 }
 
 
+struct Invalidation
+// ----------------------------------------------------------------------------
+//   Record that declarations in a scope changed, e.g. when reloading a file
+// ----------------------------------------------------------------------------
+{
+    Invalidation(Scope *scope, Tree *replaced)
+        : scope(scope), replaced(replaced) {}
+    Scope_p     scope;          // Scope where declarations changed
+    Tree_p      replaced;       // Code replaced in that scope
+};
+typedef std::vector<Invalidation> Invalidations;
+typedef std::map<uint, uint>      InvalidationUsers;
+static Invalidations     invalidations;         // Not yet checked by all
+static uint              invalidationsBase = 0; // Number of entries dropped
+static InvalidationUsers invalidationUsers;     // Functions by first unchecked
+
+
+static void UseInvalidations(uint first)
+// ----------------------------------------------------------------------------
+//   Record that a function still has to check invalidations from 'first'
+// ----------------------------------------------------------------------------
+{
+    invalidationUsers[first]++;
+}
+
+
+static void ReleaseInvalidations(uint first)
+// ----------------------------------------------------------------------------
+//   Drop the invalidations that all functions have checked
+// ----------------------------------------------------------------------------
+//   The entries keep the replaced code alive, and the vector would otherwise
+//   grow with each reload for as long as the program runs.
+{
+    InvalidationUsers::iterator found = invalidationUsers.find(first);
+    if (found != invalidationUsers.end() && --(*found).second == 0)
+        invalidationUsers.erase(found);
+
+    uint end = invalidationsBase + invalidations.size();
+    uint last = invalidationUsers.empty()
+        ? end : (*invalidationUsers.begin()).first;
+    if (last > invalidationsBase)
+    {
+        invalidations.erase(invalidations.begin(),
+                            invalidations.begin() + (last - invalidationsBase));
+        invalidationsBase = last;
+    }
+}
+
+
+void InvalidateBytecode(Scope *scope, Tree *replaced)
+// ----------------------------------------------------------------------------
+//   Compile again the code that may refer to declarations in the scope
+// ----------------------------------------------------------------------------
+//   Calls are bound to the declarations they found when compiled, so the
+//   code compiled in that scope or in scopes within it is invalid, and is
+//   compiled again the next time it is evaluated. Code already running
+//   keeps running, so the replaced code and what it calls are kept.
+{
+    invalidations.push_back(Invalidation(scope, replaced));
+}
+
+
 
 // ============================================================================
 //
@@ -319,6 +383,31 @@ struct StoreOp : Op
 };
 
 
+struct AssignOp : Op
+// ----------------------------------------------------------------------------
+//    Store a value in an assignment target resolved when building the code
+// ----------------------------------------------------------------------------
+{
+    AssignOp(AssignmentSlot &slot, int valueId): slot(slot), valueId(valueId) {}
+    AssignmentSlot      slot;
+    int                 valueId;
+
+    virtual Op *        Run(Data data)
+    {
+        Tree *value = data[valueId];
+        value = Context::StoreInSlot(NULL, DataScope(data), &slot, value);
+        DataResult(data, value);
+        return success;
+    }
+    virtual kstring     OpID()  { return "assign"; }
+    virtual void        Dump(std::ostream &out)
+    {
+        out << OpID() << "\t" << RewriteDefined(slot.decl->left)
+            << "\t" << valueId;
+    }
+};
+
+
 struct CallOp : Op
 // ----------------------------------------------------------------------------
 //    Call a subroutine using the given inputs
@@ -343,7 +432,7 @@ struct CallOp : Op
         for (uint p = 0; p < sz; p++)
         {
             int parmId = parms[p];
-            out[~p] = data[parmId];
+            out[~int(p)] = data[parmId];
         }
         Op *remaining = target->Run(out);
         ELFE_ASSERT(!remaining);
@@ -458,7 +547,7 @@ struct IndexOp : FailOp
         if (Infix *lifx = callee->AsInfix())
         {
             // Check if we have a function definition
-            if (lifx->name == "->")
+            if (lifx->name == Infix::rewrite)
             {
                 // If we have a single name on the left, like (X->X+1)
                 // interpret that as a lambda function
@@ -697,8 +786,11 @@ Function::Function(Context *context, Tree *self, uint nInputs, uint nLocals)
 // ----------------------------------------------------------------------------
 //   Create a function
 // ----------------------------------------------------------------------------
-    : Code(context, self), nInputs(nInputs), nLocals(nLocals)
-{}
+    : Code(context, self), nInputs(nInputs), nLocals(nLocals),
+      validated(invalidationsBase + invalidations.size())
+{
+    UseInvalidations(validated);
+}
 
 
 Function::Function(Function *original, Data data, ParmOrder &capture)
@@ -707,8 +799,10 @@ Function::Function(Function *original, Data data, ParmOrder &capture)
 // ----------------------------------------------------------------------------
     : Code(original->context, original->self),
       nInputs(original->nInputs), nLocals(original->nLocals),
-      captured()
+      captured(), validated(original->validated)
 {
+    UseInvalidations(validated);
+
     // We have no instrs, so we don't "own" the instructions
     ops = original->ops;
 
@@ -728,7 +822,35 @@ Function::~Function()
 // ----------------------------------------------------------------------------
 //    Destructor for functions
 // ----------------------------------------------------------------------------
-{}
+{
+    ReleaseInvalidations(validated);
+}
+
+
+bool Function::Valid()
+// ----------------------------------------------------------------------------
+//   Check that no declaration visible from the function changed since compiled
+// ----------------------------------------------------------------------------
+{
+    uint first = validated;
+    uint max = invalidationsBase + invalidations.size();
+    bool valid = true;
+    for (; validated < max; validated++)
+    {
+        Scope *changed = invalidations[validated - invalidationsBase].scope;
+        for (Scope *s = context->CurrentScope(); s && valid; s = ScopeParent(s))
+            if (s == changed)
+                valid = false;
+        if (!valid)
+            break;
+    }
+    if (validated != first)
+    {
+        UseInvalidations(validated);
+        ReleaseInvalidations(first);
+    }
+    return valid;
+}
 
 
 Op *Function::Run(Data data)
@@ -1104,15 +1226,31 @@ static Tree *compileLookup(Scope *evalScope, Scope *declScope,
     }
     else if (Opcode *opcode = OpcodeInfo(decl))
     {
-        // Cached callback - Make a copy
         ELFE_ASSERT(!opcode->success);
-        Opcode *clone = opcode->Clone();
-        clone->SetParms(builder->parms);
-        builder->Add(clone);
-        IFTRACE(compile)
-            std::cerr << "COMPILE" << depth << ":" << cindex
-                      << "(" << self << ") OPCODE " << opcode
-                      << "\n";
+        AssignmentSlot slot;
+        Infix *assign = self->AsInfix();
+        if (assign && assign->name == Infix::assign &&
+            builder->parms.size() == 2 &&
+            context->ResolveAssignment(assign->left, slot))
+        {
+            // Assignment to a known declaration: store directly into it
+            builder->Add(new AssignOp(slot, builder->parms[1]));
+            IFTRACE(compile)
+                std::cerr << "COMPILE" << depth << ":" << cindex
+                          << "(" << self << ") ASSIGN " << slot.decl->left
+                          << "\n";
+        }
+        else
+        {
+            // Cached callback - Make a copy
+            Opcode *clone = opcode->Clone();
+            clone->SetParms(builder->parms);
+            builder->Add(clone);
+            IFTRACE(compile)
+                std::cerr << "COMPILE" << depth << ":" << cindex
+                          << "(" << self << ") OPCODE " << opcode
+                          << "\n";
+        }
     }
     else if (isLeaf)
     {
@@ -1150,6 +1288,13 @@ Function *CodeBuilder::Compile(Context *ctx, Tree *what,
 {
     // Check if we already compiled this particular tree (possibly recursive)
     Function *function = what->GetInfo<Function>();
+    Function *invalid = NULL;
+    if (function && !function->Valid())
+    {
+        // Keep invalid code, which may be running, until the tree dies
+        invalid = function;
+        function = NULL;
+    }
     if (function)
     {
         captured = function->captured;
@@ -1191,7 +1336,10 @@ Function *CodeBuilder::Compile(Context *ctx, Tree *what,
     }
 
     // We failed, delete the result and return
-    what->Purge<Code>();
+    if (invalid && what->Remove<Code>(function))
+        function->Delete();
+    else
+        what->Purge<Code>();
     return NULL;
 }
 
@@ -1279,8 +1427,9 @@ bool CodeBuilder::Instructions(Context *ctx, Tree *what)
         case REAL:
         case TEXT:
         case NAME:
-            // If not looked up, return the original
-            Add(new ConstOp(what));
+        case ARRAY:
+            // If not looked up, return the original or a shared copy
+            Add(new ConstOp(SharedLeaves::Share(what)));
             InstructionsSuccess(saveEvals.saved.size());
             return true;
 
@@ -1337,7 +1486,7 @@ bool CodeBuilder::Instructions(Context *ctx, Tree *what)
             // Create a call for forms like (X -> X+1) 31
             if (Infix *lifx = callee->AsInfix())
             {
-                if (lifx->name == "->")
+                if (lifx->name == Infix::rewrite)
                 {
                     TreeIDs   outs;
                     ParmOrder parms;
@@ -1412,10 +1561,10 @@ bool CodeBuilder::Instructions(Context *ctx, Tree *what)
         case INFIX:
         {
             Infix *infix = (Infix *) (Tree *) what;
-            text name = infix->name;
+            itext &name = infix->name;
 
             // Check sequences
-            if (name == ";" || name == "\n")
+            if (name == Infix::semicolon || name == Infix::newline)
             {
                 // Sequences: evaluate left, then right
                 if (!Instructions(ctx, infix->left))
@@ -1425,7 +1574,7 @@ bool CodeBuilder::Instructions(Context *ctx, Tree *what)
             }
 
             // Check declarations
-            if (name == "->")
+            if (name == Infix::rewrite)
             {
                 // Declarations evaluate last non-declaration result, or self
                 InstructionsSuccess(saveEvals.saved.size());
@@ -1433,7 +1582,7 @@ bool CodeBuilder::Instructions(Context *ctx, Tree *what)
             }
 
             // Check scoped reference
-            if (name == ".")
+            if (name == Infix::dot)
             {
                 if (!Instructions(ctx, infix->left))
                     return false;
@@ -1834,11 +1983,27 @@ CodeBuilder::strength CodeBuilder::DoText(Text *what)
 // ----------------------------------------------------------------------------
 {
     if (Text *tval = test->AsText())
-        return tval->value != what->value ? ALWAYS : NEVER;
+        return tval->Value() != what->Value() ? ALWAYS : NEVER;
     if (test->IsConstant())
         return NEVER;
     Evaluate(context, test);
-    Add(new MatchOp<Text>(what->value, failOp));
+    Add(new MatchOp<Text>(what->Value(), failOp));
+    return SOMETIMES;
+}
+
+
+CodeBuilder::strength CodeBuilder::DoArray(Array *what)
+// ----------------------------------------------------------------------------
+//   The pattern contains an array: check we have an equal one
+// ----------------------------------------------------------------------------
+{
+    if (Array *aval = test->AsArray())
+        return Tree::Equal(aval, what) ? ALWAYS : NEVER;
+    if (test->IsConstant())
+        return NEVER;
+    int testID = Evaluate(context, test);
+    int arrayID = Evaluate(argsCtx, what);
+    Add(new NameMatchOp(testID, arrayID, failOp));
     return SOMETIMES;
 }
 
@@ -1969,7 +2134,7 @@ CodeBuilder::strength CodeBuilder::DoInfix(Infix *what)
     Save<Context_p> saveContext(context, context);
 
     // Check if we have typed arguments, e.g. X:integer
-    if (what->name == ":")
+    if (what->name == Infix::colon)
     {
         Name *name = what->left->AsName();
         if (!name)
@@ -2014,7 +2179,7 @@ CodeBuilder::strength CodeBuilder::DoInfix(Infix *what)
     }
 
     // Check if we have typed declarations, e.g. X+Y as integer
-    if (what->name == "as")
+    if (what->name == Infix::as)
     {
         if (resultType)
         {
@@ -2026,7 +2191,7 @@ CodeBuilder::strength CodeBuilder::DoInfix(Infix *what)
     }
 
     // Check if we have a guard clause
-    if (what->name == "when")
+    if (what->name == Infix::when)
     {
         // It must pass the rest (need to bind values first)
         if (what->left->Do(this) == NEVER)
@@ -63,6 +63,7 @@ typedef Tree_p *               Data;
 Tree *          EvaluateWithBytecode(Context *context, Tree *input);
 Function *      CompileToBytecode(Context *context, Tree *input, Tree *type,
                                   TreeIDs &parms, TreeList &captured);
+void            InvalidateBytecode(Scope *scope, Tree *replaced);
 
 
 
@@ -111,6 +112,7 @@ struct Code : Op, Info
     virtual uint        Inputs()        { return 0; }
     virtual uint        Locals()        { return 0; }
     virtual kstring     OpID()          { return "code"; }
+    INFO_SLOT(Code, CODE_SLOT);
 
 public:
     Context_p           context;
@@ -135,6 +137,7 @@ struct Function : Code
     virtual uint        Locals()        { return nLocals; }
     virtual kstring     OpID()          { return "function"; }
 
+    bool                Valid();
     uint                Closures()      { return captured.size(); }
     Tree_p *            ClosureData()   { return &captured[0]; }
     uint                OffsetSize()    { return Inputs() + Closures(); }
@@ -143,6 +146,7 @@ struct Function : Code
 public:
     uint                nInputs, nLocals;
     TreeList            captured;
+    uint                validated;      // Invalidations checked so far
 };
 
 
@@ -179,6 +183,7 @@ public:
     strength    DoPostfix(Postfix *what);
     strength    DoInfix(Infix *what);
     strength    DoBlock(Block *what);
+    strength    DoArray(Array *what);
     strength    DoLeftRight(Tree *wl, Tree *wr, Tree *l, Tree *r);
 
     // Evaluation and binding of values
@@ -224,7 +224,7 @@ Tree *CDeclaration::Parameters(Block *input)
         Infix *infix = args->AsInfix();
         if (infix)
         {
-            if (infix->name == ",")
+            if (infix->name == Infix::comma)
             {
                 args = infix->left;
                 next = infix->right;
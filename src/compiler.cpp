@@ -95,7 +95,7 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
       booleanTy(NULL),
       integerTy(NULL), integer8Ty(NULL), integer16Ty(NULL), integer32Ty(NULL),
       realTy(NULL), real32Ty(NULL),
-      characterTy(NULL), charPtrTy(NULL), textTy(NULL),
+      characterTy(NULL), charPtrTy(NULL), textTy(NULL), itextTy(NULL),
       treeTy(NULL), treePtrTy(NULL), treePtrPtrTy(NULL),
       integerTreeTy(NULL), integerTreePtrTy(NULL),
       realTreeTy(NULL), realTreePtrTy(NULL),
@@ -142,6 +142,7 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
     Allocator<Prefix>   ::Singleton()->AddListener(cgcl);
     Allocator<Postfix>  ::Singleton()->AddListener(cgcl);
     Allocator<Block>    ::Singleton()->AddListener(cgcl);
+    Allocator<Array>    ::Singleton()->AddListener(cgcl);
 
     // Create the runtime environment for just-in-time compilation
     runtime = LLVMS_InitializeJIT(llvm, moduleName, &module);
@@ -170,6 +171,11 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
     llvm_types textElements;
     textElements.push_back(charPtrTy);             // _M_p in gcc's impl
     textTy = StructType::get(llvm, textElements); // text
+    itextTy = PointerType::get(textTy, 0);        // itext
+    llvm_types ctextElements;
+    ctextElements.push_back(LLVM_INTTYPE(uint32)); // size
+    ctextElements.push_back(ArrayType::get(characterTy, ctext::INLINE));
+    StructType *ctextTy = StructType::get(llvm, ctextElements); // ctext
 
     // Create the Info and Symbol pointer types
     OpaqueType *structInfoTy = LLVMS_getOpaqueType(llvm);// struct Info
@@ -194,7 +200,7 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
     {
         LocalTree (const Tree &o): tag(o.tag), info(o.info) {}
         ulong           tag;
-        ELFE::Info*    info;
+        ELFE::InfoSlots *info;
     };
     // If this assert fails, you changed struct tree and need to modify here
     ELFE_CASSERT(sizeof(LocalTree) == sizeof(Tree));
@@ -219,23 +225,26 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
 
     // Create the Text type
     llvm_types textTreeElements = treeElements;
-    textTreeElements.push_back(textTy);                  // value
-    textTreeElements.push_back(textTy);                  // opening
-    textTreeElements.push_back(textTy);                  // closing
+    textTreeElements.push_back(ctextTy);                 // value
+    textTreeElements.push_back(itextTy);                 // opening
+    textTreeElements.push_back(itextTy);                 // closing
+    textTreeElements.push_back(charPtrTy);               // rope
     textTreeTy = StructType::get(llvm, textTreeElements);// struct Text
     textTreePtrTy = PointerType::get(textTreeTy, 0);     // Text *
 
     // Create the Name type
     llvm_types nameElements = treeElements;
-    nameElements.push_back(textTy);
+    nameElements.push_back(ctextTy);
     nameTreeTy = StructType::get(llvm, nameElements);    // struct Name{}
     nameTreePtrTy = PointerType::get(nameTreeTy, 0);     // Name *
 
     // Create the Block type
     llvm_types blockElements = treeElements;
     blockElements.push_back(treePtrTy);                  // Tree *
-    blockElements.push_back(textTy);                     // opening
-    blockElements.push_back(textTy);                     // closing
+    blockElements.push_back(itextTy);                    // opening
+    blockElements.push_back(itextTy);                    // closing
+    blockElements.push_back(integer32Ty);                // hash.value
+    blockElements.push_back(integer32Ty);                // hash.epoch
     blockTreeTy = StructType::get(llvm, blockElements);  // struct Block
     blockTreePtrTy = PointerType::get(blockTreeTy, 0);   // Block *
 
@@ -243,6 +252,9 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
     llvm_types prefixElements = treeElements;
     prefixElements.push_back(treePtrTy);                   // Tree *
     prefixElements.push_back(treePtrTy);                   // Tree *
+    llvm_types infixElements = prefixElements;
+    prefixElements.push_back(integer32Ty);                 // hash.value
+    prefixElements.push_back(integer32Ty);                 // hash.epoch
     prefixTreeTy = StructType::get(llvm, prefixElements);  // struct Prefix
     prefixTreePtrTy = PointerType::get(prefixTreeTy, 0);   // Prefix *
 
@@ -252,8 +264,9 @@ Compiler::Compiler(kstring moduleName, int argc, char **argv)
     postfixTreePtrTy = PointerType::get(postfixTreeTy, 0);   // Postfix *
 
     // Create the Infix type
-    llvm_types infixElements = prefixElements;
-    infixElements.push_back(textTy);                        // name
+    infixElements.push_back(itextTy);                       // name
+    infixElements.push_back(integer32Ty);                   // hash.value
+    infixElements.push_back(integer32Ty);                   // hash.epoch
     infixTreeTy = StructType::get(llvm, infixElements);     // Infix
     infixTreePtrTy = PointerType::get(infixTreeTy, 0);      // Infix *
 
@@ -844,9 +857,11 @@ llvm_type Compiler::MachineType(Tree *tree)
     {
         if (Text *text = tree->AsText())
         {
-            if (text->opening == "'" && text->closing == "'")
+            if (text->opening == Text::charQuote &&
+                text->closing == Text::charQuote)
                 return characterTy;
-            if (text->opening == "\"" && text->closing == "\"")
+            if (text->opening == Text::textQuote &&
+                text->closing == Text::textQuote)
                 return charPtrTy;
         }
     }
@@ -164,6 +164,7 @@ public:
     llvm::PointerType            *charPtrTy;
     llvm::PointerType            *charPtrPtrTy;
     llvm::StructType             *textTy;
+    llvm::PointerType            *itextTy;
     llvm::StructType             *treeTy;
     llvm::PointerType            *treePtrTy;
     llvm::PointerType            *treePtrPtrTy;
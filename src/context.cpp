@@ -61,6 +61,7 @@
 #include <iostream>
 #include <cstdlib>
 #include <sstream>
+#include <set>
 #include <sys/stat.h>
 
 ELFE_BEGIN
@@ -259,18 +260,19 @@ bool Context::ProcessDeclarations(Tree *what)
         bool isInstruction = true;
         if (Infix *infix = what->AsInfix())
         {
-            if (infix->name == "->")
+            if (infix->name == Infix::rewrite)
             {
                 Enter(infix);
                 isInstruction = false;
             }
-            else if (infix->name == "\n" || infix->name == ";")
+            else if (infix->name == Infix::newline ||
+                     infix->name == Infix::semicolon)
             {
                 // Chain of declarations, avoiding recursing if possible.
                 if (Infix *left = infix->left->AsInfix())
                 {
                     isInstruction = false;
-                    if (left->name == "->")
+                    if (left->name == Infix::rewrite)
                         Enter(left);
                     else
                         isInstruction = ProcessDeclarations(left);
@@ -334,6 +336,7 @@ static void ValidateNames(Tree *form)
     case INTEGER:
     case REAL:
     case TEXT:
+    case ARRAY:
         break;
     case NAME:
     {
@@ -401,7 +404,7 @@ Rewrite *Context::Enter(Infix *rewrite, bool overwrite)
 // ----------------------------------------------------------------------------
 {
     // If the rewrite is not good, just exit
-    if (rewrite->name != "->")
+    if (rewrite->name != Infix::rewrite)
         return NULL;
 
     // In interpreted mode, just skip any C declaration
@@ -438,10 +441,13 @@ Rewrite *Context::Enter(Infix *rewrite, bool overwrite)
     // That structure has the following layout: (A->B ; (L; R)), where
     // A->B is the local declaration, L and R are the possible children.
     // Children are initially nil.
+    // Symbol tables and declarations are updated in place, see Tree::Mutable
     Scope   *scope  = symbols;
-    Tree_p  &locals = ScopeLocals(scope);
-    Tree_p  *parent = &locals;
+    TreeChild &locals = ScopeLocals(scope);
+    TreeChild *parent = &locals;
     Rewrite *result = NULL;
+    Tree::Mutable(scope);
+    Tree::Mutable(rewrite);
     while (!result)
     {
         // If we have found a nil spot, that's where we can insert
@@ -456,9 +462,11 @@ Rewrite *Context::Enter(Infix *rewrite, bool overwrite)
             // Create the local entry
             Rewrite *entry = new Rewrite(REWRITE_NAME, rewrite, nil_children,
                                          rewrite->Position());
+            Tree::Mutable(nil_children);
+            Tree::Mutable(entry);
 
             // Insert the entry in the parent
-            *parent = entry;
+            parent->Replace(entry);
 
             // We are done
             result = entry;
@@ -479,7 +487,8 @@ Rewrite *Context::Enter(Infix *rewrite, bool overwrite)
                 {
                     if (overwrite)
                     {
-                        decl->right = rewrite->right;
+                        Tree::Mutable(decl);
+                        decl->right.Replace(rewrite->right);
                         return entry;
                     }
                     else
@@ -504,55 +513,328 @@ Rewrite *Context::Enter(Infix *rewrite, bool overwrite)
 }
 
 
-Tree *Context::Assign(Tree *ref, Tree *value)
+struct TreeOrder
 // ----------------------------------------------------------------------------
-//   Perform an assignment in the given context
+//   Order trees by structure, to find equal trees in a map
+// ----------------------------------------------------------------------------
+{
+    bool operator() (Tree *a, Tree *b) const
+    {
+        return Tree::Compare(a, b) < 0;
+    }
+};
+typedef std::vector<Tree_p *> DeclarationSlots;
+
+
+static void declarationSlots(Tree_p &code, DeclarationSlots &slots)
+// ----------------------------------------------------------------------------
+//   Find where the top-level rewrites are, in the order ProcessDeclarations does
+// ----------------------------------------------------------------------------
+{
+    Tree_p *next = &code;
+    while (Infix *infix = (*next)->AsInfix())
+    {
+        if (infix->name == Infix::rewrite)
+        {
+            slots.push_back(next);
+            break;
+        }
+        if (infix->name != Infix::newline && infix->name != Infix::semicolon)
+            break;
+        declarationSlots(infix->left, slots);
+        next = &infix->right;
+    }
+}
+
+
+static void copyPositions(Tree *to, Tree *from)
+// ----------------------------------------------------------------------------
+//   Copy the positions of a tree into an equal tree
+// ----------------------------------------------------------------------------
+{
+    std::vector<Tree *> pending;
+    while (to)
+    {
+        to->tag = from->tag;
+        switch(to->Kind())
+        {
+        case INFIX:
+            pending.push_back(((Infix *) to)->left);
+            pending.push_back(((Infix *) from)->left);
+            to = ((Infix *) to)->right;
+            from = ((Infix *) from)->right;
+            break;
+        case PREFIX:
+            pending.push_back(((Prefix *) to)->left);
+            pending.push_back(((Prefix *) from)->left);
+            to = ((Prefix *) to)->right;
+            from = ((Prefix *) from)->right;
+            break;
+        case POSTFIX:
+            pending.push_back(((Postfix *) to)->right);
+            pending.push_back(((Postfix *) from)->right);
+            to = ((Postfix *) to)->left;
+            from = ((Postfix *) from)->left;
+            break;
+        case BLOCK:
+            to = ((Block *) to)->child;
+            from = ((Block *) from)->child;
+            break;
+        default:
+            to = NULL;
+            break;
+        }
+        if (!to && !pending.empty())
+        {
+            from = pending.back();
+            pending.pop_back();
+            to = pending.back();
+            pending.pop_back();
+        }
+    }
+}
+
+
+void Context::DeclarationBodies(Tree *code, TreeList &bodies)
+// ----------------------------------------------------------------------------
+//   Record the bodies of the top-level rewrites, as given to Update
+// ----------------------------------------------------------------------------
+{
+    Tree_p root = code;
+    DeclarationSlots slots;
+    declarationSlots(root, slots);
+    for (uint s = 0; s < slots.size(); s++)
+        bodies.push_back(((Infix *) (Tree *) *slots[s])->right);
+}
+
+
+uint Context::Update(Tree *previous, TreeList &bodies, Tree_p &code)
+// ----------------------------------------------------------------------------
+//   Replace the rewrites entered from 'previous' with those in 'code'
+// ----------------------------------------------------------------------------
+//   This is used to reload a file without running it again. An assignment
+//   replaces the body of a rewrite in place, so 'bodies' holds the bodies
+//   of the previous rewrites as parsed, and those of 'code' on return.
+//   A rewrite with the same source is kept with its current value, and put
+//   back in 'code'. Others are replaced, added or removed. Returns the
+//   number of rewrites that changed.
+{
+    typedef std::map<Tree *, Rewrite *>                 entry_map;
+    typedef std::multimap<Tree *, uint, TreeOrder>      pattern_map;
+
+    // Find the local entries in the order of the tree, and what they declare
+    RewriteList entries;
+    entry_map   entered;
+    std::vector<Rewrite *> pending;
+    Rewrite *entry = ScopeRewrites(symbols);
+    while (entry)
+    {
+        entries.push_back(entry);
+        entered[RewriteDeclaration(entry)] = entry;
+        RewriteChildren *children = RewriteNext(entry);
+        if (Rewrite *right = children->right->AsInfix())
+            pending.push_back(right);
+        entry = children->left->AsInfix();
+        if (!entry && !pending.empty())
+        {
+            entry = pending.back();
+            pending.pop_back();
+        }
+    }
+
+    // Index the previous rewrites that were entered by their pattern
+    Tree_p           root = previous;
+    DeclarationSlots previousSlots;
+    pattern_map      patterns;
+    declarationSlots(root, previousSlots);
+    for (uint p = 0; p < previousSlots.size() && p < bodies.size(); p++)
+    {
+        Infix *decl = (Infix *) (Tree *) *previousSlots[p];
+        if (entered.count(decl))
+            patterns.insert(pattern_map::value_type(decl->left, p));
+    }
+
+    // Match the new rewrites with the previous ones
+    DeclarationSlots slots;
+    TreeList         parsed;
+    RewriteList      added;
+    uint             changed = 0;
+    declarationSlots(code, slots);
+    for (uint s = 0; s < slots.size(); s++)
+    {
+        Infix *decl = (Infix *) (Tree *) *slots[s];
+        parsed.push_back(decl->right);
+
+        pattern_map::iterator found = patterns.lower_bound(decl->left);
+        if (found == patterns.end() || !Tree::Equal((*found).first, decl->left))
+        {
+            added.push_back(decl);
+            continue;
+        }
+        uint   p    = (*found).second;
+        Infix *old  = (Infix *) (Tree *) *previousSlots[p];
+        Tree  *body = bodies[p];
+        patterns.erase(found);
+
+        if (Tree::Equal(body, decl->right))
+        {
+            // Same source: keep the rewrite, with the new source positions.
+            // Nothing cached the hash of the new code above the rewrites.
+            copyPositions(old->left, decl->left);
+            if (old->right == body)
+                copyPositions(body, decl->right);
+            old->tag = decl->tag;
+            *slots[s] = old;
+        }
+        else
+        {
+            // New source: the entry now refers to the new rewrite
+            Rewrite *rw = entered[old];
+            Tree::Mutable(rw);
+            rw->left.Replace(decl);
+            changed++;
+        }
+    }
+
+    // Remove the rewrites that are gone by entering the others again
+    if (!patterns.empty())
+    {
+        std::set<Tree *> removed;
+        pattern_map::iterator r;
+        for (r = patterns.begin(); r != patterns.end(); r++)
+            removed.insert(*previousSlots[(*r).second]);
+
+        Clear();
+        for (uint e = 0; e < entries.size(); e++)
+        {
+            Infix *decl = RewriteDeclaration(entries[e]);
+            if (!removed.count(decl))
+                Enter(decl);
+        }
+        changed += removed.size();
+    }
+
+    // Enter the new rewrites
+    for (uint a = 0; a < added.size(); a++)
+        Enter(added[a]);
+    changed += added.size();
+
+    // Code compiled with the previous rewrites is no longer valid
+    if (changed)
+    {
+        compiled.clear();
+        if (MAIN->options.optimize_level)
+            InvalidateBytecode(symbols, previous);
+    }
+
+    bodies.swap(parsed);
+    return changed;
+}
+
+
+bool Context::ResolveAssignment(Tree *ref, AssignmentSlot &slot)
+// ----------------------------------------------------------------------------
+//   Find the declaration an assignment stores into, and how to check its type
 // ----------------------------------------------------------------------------
 {
-    // Check if the reference already exists
     Infix *decl = Reference(ref);
     if (!decl)
+        return false;
+
+    slot.decl = decl;
+    slot.type = NULL;
+    slot.check = NULL;
+
+    // Check if the declaration has a type, i.e. it is 'X as integer'
+    if (Infix *typeDecl = decl->left->AsInfix())
     {
-        // The reference does not exist: we need to create it.
+        if (typeDecl->name == Infix::as)
+        {
+            // Builtin types like 'integer' are names bound to themselves
+            Tree *type = typeDecl->right;
+            if (type->AsName())
+                if (Tree *bound = Bound(type))
+                    type = bound;
+            slot.type = type;
+            slot.check = type->GetInfo<TypeCheckOpcode>();
+        }
+    }
+    return true;
+}
+
 
-        // Strip outermost block if there is one
-        if (Block *block = ref->AsBlock())
-            ref = block->child;
+Tree *Context::Assign(Tree *ref, Tree *value)
+// ----------------------------------------------------------------------------
+//   Perform an assignment in the given context
+// ----------------------------------------------------------------------------
+{
+    // Check if the reference already exists
+    AssignmentSlot slot;
+    if (ResolveAssignment(ref, slot))
+        return StoreInSlot(this, symbols, &slot, value);
 
-        // If we have 'X:integer := 3', define 'X as integer'
-        if (Infix *typed = ref->AsInfix())
-            if (typed->name == ":")
-                typed->name = "as";
+    // The reference does not exist: we need to create it.
 
-        // Enter in the symbol table
-        Define(ref, value);
+    // Strip outermost block if there is one
+    if (Block *block = ref->AsBlock())
+        ref = block->child;
+
+    // If we have 'X:integer := 3', define 'X as integer'
+    if (Infix *typed = ref->AsInfix())
+    {
+        if (typed->name == Infix::colon)
+        {
+            Tree::Changed(typed);
+            typed->name = "as";
+        }
     }
-    else
+
+    // Enter in the symbol table
+    Define(ref, value);
+
+    // Return evaluated assigned value
+    return value;
+}
+
+
+Tree *Context::StoreInSlot(Context *context, Scope *scope,
+                           AssignmentSlot *slot, Tree *value)
+// ----------------------------------------------------------------------------
+//   Store a value in a resolved assignment target, checking its type
+// ----------------------------------------------------------------------------
+{
+    Infix *decl = slot->decl;
+    if (Tree *type = slot->type)
     {
-        // Check if the declaration has a type, i.e. it is 'X as integer'
-        if (Infix *typeDecl = decl->left->AsInfix())
+        Tree *castedValue = NULL;
+        if (TypeCheckOpcode *check = slot->check)
         {
-            if (typeDecl->name == "as")
-            {
-                Tree *type = typeDecl->right;
-                Tree *castedValue = TypeCheck(this, type, value);
-                if (castedValue)
-                {
-                    value = castedValue;
-                }
-                else
-                {
-                    Ooops("New value $1 does not match existing type", value);
-                    Ooops("for declaration $1", decl);
-                    value = decl->right; // Preserve existing value
-                }
-            }
+            castedValue = check->Check(context, value);
+        }
+        else
+        {
+            Context_p typeContext = context;
+            if (!typeContext)
+                typeContext = new Context(scope);
+            castedValue = TypeCheck(typeContext, type, value);
         }
 
-        // Update existing value in place
-        decl->right = value;
+        if (castedValue)
+        {
+            value = castedValue;
+        }
+        else
+        {
+            Ooops("New value $1 does not match existing type", value);
+            Ooops("for declaration $1", decl);
+            value = decl->right; // Preserve existing value
+        }
     }
 
+    // Update existing value in place
+    Tree::Mutable(decl);
+    decl->right.Replace(value);
+
     // Return evaluated assigned value
     return value;
 }
@@ -639,8 +921,8 @@ Tree *Context::Lookup(Tree *what, lookup_fn lookup, void *info, bool recurse)
     while (scope)
     {
         // Initialize local scope
-        Tree_p &locals = ScopeLocals(scope);
-        Tree_p *parent = &locals;
+        TreeChild &locals = ScopeLocals(scope);
+        TreeChild *parent = &locals;
         Tree *result = NULL;
         ulong h = h0;
 
@@ -654,7 +936,7 @@ Tree *Context::Lookup(Tree *what, lookup_fn lookup, void *info, bool recurse)
             Rewrite *entry = (*parent)->AsInfix();
             ELFE_ASSERT(entry && entry->name == REWRITE_NAME);
             Infix *decl = RewriteDeclaration(entry);
-            ELFE_ASSERT(!decl || decl->name == "->");
+            ELFE_ASSERT(!decl || decl->name == Infix::rewrite);
             RewriteChildren *children = RewriteNext(entry);
             ELFE_ASSERT(children && children->name == REWRITE_CHILDREN_NAME);
 
@@ -732,8 +1014,8 @@ static Tree *findValueX(Scope *, Scope *scope,
         if (!Tree::Equal(what, RewriteDefined(decl->left)))
             return NULL;
     Prefix *rewriteInfo = (Prefix *) info;
-    rewriteInfo->left = scope;
-    rewriteInfo->right = decl;
+    rewriteInfo->left.Replace(scope);
+    rewriteInfo->right.Replace(decl);
     return decl->right;
 }
 
@@ -754,6 +1036,7 @@ Tree *Context::Bound(Tree *form, bool recurse, Infix_p *rewrite, Scope_p *ctx)
 // ----------------------------------------------------------------------------
 {
     Prefix info(NULL, NULL);
+    Tree::Mutable(&info);
     Tree *result = Lookup(form, findValueX, &info, recurse);
     if (ctx)
         *ctx = info.left->AsPrefix();
@@ -791,7 +1074,7 @@ static ulong listNames(Rewrite *where, text begin, RewriteList &list, bool pfx)
     while (where)
     {
         Infix *decl = RewriteDeclaration(where);
-        if (decl && decl->name == "->")
+        if (decl && decl->name == Infix::rewrite)
         {
             Tree *declared = decl->left;
             Name *name = declared->AsName();
@@ -807,7 +1090,7 @@ static ulong listNames(Rewrite *where, text begin, RewriteList &list, bool pfx)
                 count++;
             }
         }
-        if (where->name == ";" || where->name == "\n")
+        if (where->name == Infix::semicolon || where->name == Infix::newline)
             count += listNames(where->left->AsInfix(), begin, list, pfx);
         where = decl->right->AsInfix();
     }
@@ -887,7 +1170,7 @@ ulong Context::Hash(Tree *what)
         h += hashRealToInteger(((Real *) what)->value);
         break;
     case TEXT:
-        h += HashText(((Text *) what)->value);
+        h += HashText(((Text *) what)->Value());
         break;
     case NAME:
         h += HashText(((Name *) what)->value);
@@ -906,6 +1189,8 @@ ulong Context::Hash(Tree *what)
         if (Name *name = ((Postfix *) what)->right->AsName())
             h += HashText(name->value);
         break;
+    case ARRAY:
+        break;
     }
 
     return h;
@@ -924,7 +1209,8 @@ void Context::Clear()
 //   Clear the symbol table
 // ----------------------------------------------------------------------------
 {
-    symbols->right = elfe_nil;
+    Tree::Mutable(symbols);
+    symbols->right.Replace(elfe_nil);
 }
 
 
@@ -962,7 +1248,7 @@ void Context::Dump(std::ostream &out, Rewrite *rw)
 
         if (decl)
         {
-            if (decl->name == "->")
+            if (decl->name == Infix::rewrite)
                 out << decl->left << " -> "
                     << ShortTreeForm(decl->right) << "\n";
             else
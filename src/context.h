@@ -177,6 +177,8 @@ ELFE_BEGIN
 // ============================================================================
 
 struct Context;                                 // Execution context
+struct TypeCheckOpcode;                         // Builtin type check
+struct AssignmentSlot;                          // Resolved assignment target
 
 // Give names to components of a symbol table
 typedef Prefix                          Scope;
@@ -250,6 +252,13 @@ public:
     Rewrite *           Define(Tree *from, Tree *to, bool overwrite=false);
     Rewrite *           Define(text name, Tree *to, bool overwrite=false);
     Tree *              Assign(Tree *target, Tree *source);
+    bool                ResolveAssignment(Tree *target, AssignmentSlot &);
+    static Tree *       StoreInSlot(Context *, Scope *,
+                                    AssignmentSlot *, Tree *value);
+
+    // Updating definitions, e.g. when reloading a file
+    static void         DeclarationBodies(Tree *code, TreeList &bodies);
+    uint                Update(Tree *previous, TreeList &bodies, Tree_p &code);
 
     // Set context attributes
     Rewrite *           SetOverridePriority(double priority);
@@ -320,7 +329,7 @@ inline Scope *ScopeParent(Scope *scope)
 }
 
 
-inline Tree_p &ScopeLocals(Scope *scope)
+inline TreeChild &ScopeLocals(Scope *scope)
 // ----------------------------------------------------------------------------
 //   Return the place where we store the parent for a scope
 // ----------------------------------------------------------------------------
@@ -374,6 +383,22 @@ struct ContextStack
 };
 
 
+struct AssignmentSlot
+// ----------------------------------------------------------------------------
+//   Resolved target of an assignment
+// ----------------------------------------------------------------------------
+//   The bytecode builder resolves 'X := Y' once, keeping the declaration
+//   of X and how to check its type in the generated code. That code is
+//   invalidated when declarations change, like code that reads X.
+{
+    AssignmentSlot(): decl(), type(), check(NULL) {}
+
+    Rewrite_p           decl;           // Declaration holding the value
+    Tree_p              type;           // Type of the declaration, if any
+    TypeCheckOpcode *   check;          // Builtin check for that type, if any
+};
+
+
 
 // ============================================================================
 // 
@@ -452,12 +477,12 @@ inline Tree * RewriteDefined(Tree *form)
 {
     // Check 'X as integer', we define X
     if (Infix *typeDecl = form->AsInfix())
-        if (typeDecl->name == "as" || typeDecl->name == ":")
+        if (typeDecl->name == Infix::as || typeDecl->name == Infix::colon)
             form = typeDecl->left;
 
     // Check 'X when Condition', we define X
     if (Infix *typeDecl = form->AsInfix())
-        if (typeDecl->name == "when")
+        if (typeDecl->name == Infix::when)
             form = typeDecl->left;
 
     // Check outermost (X): we define X
@@ -474,7 +499,7 @@ inline Tree * RewriteType(Tree *what)
 // ----------------------------------------------------------------------------
 {
     if (Infix *typeDecl = what->AsInfix())
-        if (typeDecl->name == "as")
+        if (typeDecl->name == Infix::as)
             return typeDecl->right;
     return NULL;
 }
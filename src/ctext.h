@@ -0,0 +1,188 @@
+#ifndef CTEXT_H
+#define CTEXT_H
+// ****************************************************************************
+//  ctext.h                                                       ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Compact text, used for the value of text trees
+//
+//     Most texts in a program are short, so a ctext stores up to 11
+//     characters inline, and only allocates for longer values.
+//     A ctext takes 16 bytes, where a std::string takes 32 with libstdc++.
+//
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "base.h"
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+ELFE_BEGIN
+
+struct ctext
+// ----------------------------------------------------------------------------
+//   A text value stored inline when it is short enough
+// ----------------------------------------------------------------------------
+//   The heap pointer, when there is one, is kept in the inline buffer.
+//   It is accessed with memcpy, since the buffer is not aligned for it.
+{
+    enum { INLINE = 12 };           // Inline bytes, including final NUL
+    static const size_t npos = text::npos;
+
+    ctext()                             { Init("", 0); }
+    ctext(const text &t)                { Init(t.data(), t.length()); }
+    ctext(kstring t)                    { Init(t, strlen(t)); }
+    ctext(kstring t, size_t length)     { Init(t, length); }
+    ctext(const ctext &o)               { Init(o.data(), o.size); }
+    ~ctext()                            { Free(); }
+
+    ctext &operator=(const ctext &o)
+    {
+        if (this != &o)
+        {
+            Free();
+            Init(o.data(), o.size);
+        }
+        return *this;
+    }
+    ctext &operator=(const text &t)
+    {
+        Free();
+        Init(t.data(), t.length());
+        return *this;
+    }
+
+    operator text() const               { return text(data(), size); }
+    text                str() const     { return text(data(), size); }
+    kstring             data() const    { return IsInline()?small:Heap(); }
+    kstring             c_str() const   { return data(); }
+    size_t              length() const  { return size; }
+    bool                empty() const   { return size == 0; }
+    char operator[](size_t i) const     { return data()[i]; }
+    text substr(size_t pos, size_t n = npos) const
+    {
+        return text(data() + pos, std::min(n, size_t(size) - pos));
+    }
+
+    int compare(kstring t, size_t length) const
+    {
+        int result = memcmp(data(), t, std::min(size_t(size), length));
+        if (result == 0 && size != length)
+            result = size < length ? -1 : 1;
+        return result;
+    }
+    int compare(const ctext &o) const   { return compare(o.data(), o.size); }
+    int compare(const text &t) const    { return compare(t.data(),t.size()); }
+    int compare(kstring t) const        { return compare(t, strlen(t)); }
+
+    size_t find(kstring what, size_t length, size_t pos = 0) const
+    {
+        if (pos > size || length > size - pos)
+            return npos;
+        kstring start = data();
+        kstring end = start + size;
+        kstring found = std::search(start + pos, end, what, what + length);
+        if (found == end && length)
+            return npos;
+        return found - start;
+    }
+    size_t find(const ctext &w, size_t pos = 0) const
+    {
+        return find(w.data(), w.size, pos);
+    }
+    size_t find(const text &w, size_t pos = 0) const
+    {
+        return find(w.data(), w.length(), pos);
+    }
+
+private:
+    void Init(kstring t, size_t length)
+    {
+        size = length;
+        ELFE_ASSERT(size == length);
+        char *buffer = small;
+        if (!IsInline())
+        {
+            buffer = new char[length + 1];
+            memcpy(small, &buffer, sizeof(buffer));
+        }
+        memcpy(buffer, t, length);
+        buffer[length] = 0;
+    }
+    void Free()
+    {
+        if (!IsInline())
+            delete[] Heap();
+    }
+    bool IsInline() const               { return size < INLINE; }
+    char *Heap() const
+    {
+        char *heap;
+        memcpy(&heap, small, sizeof(heap));
+        return heap;
+    }
+
+    uint32              size;
+    char                small[INLINE];
+};
+
+
+// Comparisons and concatenation with regular text
+#define CTEXT_COMPARE(op)                                               \
+inline bool operator op(const ctext &a, const ctext &b)                 \
+{ return a.compare(b) op 0; }                                           \
+inline bool operator op(const ctext &a, const text &b)                  \
+{ return a.compare(b) op 0; }                                           \
+inline bool operator op(const text &a, const ctext &b)                  \
+{ return 0 op b.compare(a); }                                           \
+inline bool operator op(const ctext &a, kstring b)                      \
+{ return a.compare(b) op 0; }                                           \
+inline bool operator op(kstring a, const ctext &b)                      \
+{ return 0 op b.compare(a); }
+CTEXT_COMPARE(==)
+CTEXT_COMPARE(!=)
+CTEXT_COMPARE(<)
+CTEXT_COMPARE(>)
+CTEXT_COMPARE(<=)
+CTEXT_COMPARE(>=)
+#undef CTEXT_COMPARE
+
+inline text operator+(const ctext &a, const text &b)    { return a.str()+b; }
+inline text operator+(const text &a, const ctext &b)    { return a+b.str(); }
+inline text operator+(const ctext &a, kstring b)        { return a.str()+b; }
+inline text operator+(kstring a, const ctext &b)        { return a+b.str(); }
+inline text operator+(const ctext &a, const ctext &b)   { return a.str()+b; }
+
+inline std::ostream &operator<<(std::ostream &out, const ctext &t)
+{
+    return out.write(t.data(), t.length());
+}
+
+ELFE_END
+
+#endif // CTEXT_H
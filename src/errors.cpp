@@ -189,12 +189,22 @@ Errors::Errors()
 // ----------------------------------------------------------------------------
 //   Save errors from the top-level error handler
 // ----------------------------------------------------------------------------
-    : parent(MAIN->errors), count(0), context(0)
+    : parent(MAIN->errors), count(0), context(0), current(true)
 {
     MAIN->errors = this;
 }
 
 
+Errors::Errors(Errors *parent)
+// ----------------------------------------------------------------------------
+//   Keep errors apart, e.g. while parsing in another thread
+// ----------------------------------------------------------------------------
+//   The errors are not seen by the current error handler. They are given
+//   to the parent when this object is destroyed
+    : parent(parent), count(0), context(0), current(false)
+{}
+
+
 #define ERROR_OR_CONTEXT(e)                     \
     bool context = *m == ' ' && m++;            \
     Log(e, context);
@@ -204,7 +214,7 @@ Errors::Errors (kstring m, ulong pos)
 // ----------------------------------------------------------------------------
 //   Save errors from the top-level error handler
 // ----------------------------------------------------------------------------
-    : parent(MAIN->errors), count(0), context(0)
+    : parent(MAIN->errors), count(0), context(0), current(true)
 {
     MAIN->errors = this;
     ERROR_OR_CONTEXT(Error(m, pos));
@@ -215,7 +225,7 @@ Errors::Errors (kstring m, Tree *a)
 // ----------------------------------------------------------------------------
 //   Save errors from the top-level error handler
 // ----------------------------------------------------------------------------
-    : parent(MAIN->errors), count(0), context(0)
+    : parent(MAIN->errors), count(0), context(0), current(true)
 {
     MAIN->errors = this;
     ERROR_OR_CONTEXT(Error(m, a));
@@ -226,7 +236,7 @@ Errors::Errors (kstring m, Tree *a, Tree *b)
 // ----------------------------------------------------------------------------
 //   Save errors from the top-level error handler
 // ----------------------------------------------------------------------------
-    : parent(MAIN->errors), count(0), context(0)
+    : parent(MAIN->errors), count(0), context(0), current(true)
 {
     MAIN->errors = this;
     ERROR_OR_CONTEXT(Error(m, a, b));
@@ -237,7 +247,7 @@ Errors::Errors (kstring m, Tree *a, Tree *b, Tree *c)
 // ----------------------------------------------------------------------------
 //   Save errors from the top-level error handler
 // ----------------------------------------------------------------------------
-    : parent(MAIN->errors), count(0), context(0)
+    : parent(MAIN->errors), count(0), context(0), current(true)
 {
     MAIN->errors = this;
     ERROR_OR_CONTEXT(Error(m, a, b, c));
@@ -249,8 +259,11 @@ Errors::~Errors()
 //   Display errors to top-levle handler
 // ----------------------------------------------------------------------------
 {
-    assert (MAIN->errors == this);
-    MAIN->errors = parent;
+    if (current)
+    {
+        assert (MAIN->errors == this);
+        MAIN->errors = parent;
+    }
 
     if (HadErrors())
         Display();
@@ -393,7 +406,7 @@ text FormatTreeForError(Tree *tree)
 // ----------------------------------------------------------------------------
 {
     if (Text *t = tree->AsText())
-        return "\"" + t->value + "\"";
+        return "\"" + t->Value() + "\"";
     text result = ShortTreeForm(tree);
     return "'" + result + "'";
 }
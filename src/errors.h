@@ -80,6 +80,7 @@ struct Errors
 // ----------------------------------------------------------------------------
 {
     Errors();
+    Errors(Errors *parent);
     Errors(kstring m, TreePosition pos = Tree::NOWHERE);
     Errors(kstring m, Tree *a);
     Errors(kstring m, Tree *a, Tree *b);
@@ -98,6 +99,7 @@ struct Errors
     Errors *            parent;
     ulong               count;
     ulong               context;
+    bool                current;        // Installed as MAIN->errors
 };
 
 
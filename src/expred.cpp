@@ -93,6 +93,15 @@ llvm_value CompileExpression::DoText(Text *what)
 }
 
 
+llvm_value CompileExpression::DoArray(Array *what)
+// ----------------------------------------------------------------------------
+//   Arrays are not compiled, pass them as constant trees
+// ----------------------------------------------------------------------------
+{
+    return unit->ConstantTree(what);
+}
+
+
 llvm_value CompileExpression::DoName(Name *what)
 // ----------------------------------------------------------------------------
 //   Compile a name
@@ -135,7 +144,7 @@ llvm_value CompileExpression::DoInfix(Infix *infix)
 // ----------------------------------------------------------------------------
 {
     // Sequences
-    if (infix->name == "\n" || infix->name == ";")
+    if (infix->name == Infix::newline || infix->name == Infix::semicolon)
     {
         llvm_value left = ForceEvaluation(infix->left);
         llvm_value right = ForceEvaluation(infix->right);
@@ -147,14 +156,14 @@ llvm_value CompileExpression::DoInfix(Infix *infix)
     }
 
     // Type casts - REVISIT: may need to do some actual conversion
-    if (infix->name == ":" || infix->name == "as")
+    if (infix->name == Infix::colon || infix->name == Infix::as)
     {
         return infix->left->Do(this);
     }
 
     // Declarations: it's too early to define a function just yet,
     // because we don't have the actual argument types.
-    if (infix->name == "->")
+    if (infix->name == Infix::rewrite)
         return NULL;
 
     // General case: expression
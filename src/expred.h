@@ -64,6 +64,7 @@ public:
     llvm_value DoPostfix(Postfix *what);
     llvm_value DoInfix(Infix *what);
     llvm_value DoBlock(Block *what);
+    llvm_value DoArray(Array *what);
 
     llvm_value DoCall(Tree *call);
     llvm_value DoRewrite(RewriteCandidate &candidate);
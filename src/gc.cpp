@@ -45,14 +45,24 @@
 #include "valgrind/memcheck.h"
 
 #include <iostream>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <pthread.h>
+#include <sys/time.h>
 
 #ifdef CONFIG_MINGW // Windows: When getting in the way becomes an art form...
 #include <malloc.h>
+#include <windows.h>
+#else // Real operating systems
+#include <sys/mman.h>
+#include <execinfo.h>
 #endif // CONFIG_MINGW
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif // __GLIBC__
+
 
 ELFE_BEGIN
 
@@ -62,26 +72,49 @@ ELFE_BEGIN
 //
 // ============================================================================
 
-void *TypeAllocator::lowestAddress = (void *) ~0;
-void *TypeAllocator::highestAddress = (void *) 0;
-void *TypeAllocator::lowestAllocatorAddress = (void *) ~0;
-void *TypeAllocator::highestAllocatorAddress = (void *) 0;
+char *TypeAllocator::arenaBase = NULL;
+uintptr_t TypeAllocator::arenaSpan = 0;
+TypeAllocator **TypeAllocator::arenaOwner = NULL;
+uint *TypeAllocator::arenaRegion = NULL;
+uint TypeAllocator::arenaCount = 0;
+uint TypeAllocator::regionCount = 0;
+Atomic<uint> TypeAllocator::arenaLock = 0;
 Atomic<uint> TypeAllocator::finalizing = 0;
+std::atomic<bool> TypeAllocator::multiThreaded(false);
+Atomic<uint> TypeAllocator::threads = 0;
+uint TypeAllocator::profileRate = 0;
+ulong TypeAllocator::profilePosition = ~0UL;
+Atomic<uint> TypeAllocator::profileLock = 0;
+TypeAllocator::Profile TypeAllocator::profile;
+TypeAllocator::Sampled TypeAllocator::sampled;
 
 // Identifier of the thread currently collecting if any
 #define PTHREAD_NULL ((pthread_t) 0)
 static pthread_t collecting = PTHREAD_NULL;
 
+// Per-thread magazines of free items, indexed by allocator
+static __thread TypeAllocator::Magazines *threadMagazines = NULL;
+static pthread_key_t  magazinesKey;
+static pthread_once_t magazinesOnce = PTHREAD_ONCE_INIT;
+
+// Region the current thread allocates in, if any
+static __thread GCRegion *threadRegion = NULL;
+
 
 TypeAllocator::TypeAllocator(kstring tn, uint os)
 // ----------------------------------------------------------------------------
 //    Setup an empty allocator
 // ----------------------------------------------------------------------------
-    : gc(NULL), name(tn), locked(0), lowestInUse(~0UL), highestInUse(0),
+    : gc(NULL), name(tn), index(0),
+      locked(0), lowestInUse(~0UL), highestInUse(0),
       chunks(), freeList(NULL), toDelete(NULL),
       available(0), freedCount(0),
-      chunkSize(1022), objectSize(os), alignedSize(os),
-      allocatedCount(0), scannedCount(0), collectedCount(0), totalCount(0)
+      freshBase(NULL), freshNext(NULL), freshEnd(NULL),
+      scanLow(NULL), scanHigh(NULL),
+      scanChunk(0), scanNext(NULL), scanCollected(0),
+      chunkSize(0), objectSize(os), alignedSize(os),
+      allocatedCount(0), scannedCount(0), collectedCount(0),
+      releasedCount(0), totalCount(0), regionChunks(0)
 {
     MEMORY("New type allocator %p name '%s' object size %u", this, tn, os);
 
@@ -94,6 +127,9 @@ TypeAllocator::TypeAllocator(kstring tn, uint os)
         alignedSize = totalSize - sizeof(Chunk);
     }
 
+    // Fill an arena with items, skipping the first one like in the past
+    chunkSize = (ARENA_SIZE - alignedSize) / (alignedSize + sizeof(Chunk));
+
     // Use the address of the garbage collector as signature
     gc = GarbageCollector::GC();
 
@@ -103,13 +139,6 @@ TypeAllocator::TypeAllocator(kstring tn, uint os)
     // Make sure that we have the correct alignment
     ELFE_ASSERT(this == ValidPointer(this));
 
-    // Update allocator addresses
-    if (lowestAllocatorAddress > this)
-        lowestAllocatorAddress = (void *) this;
-    char *highMark = (char *) this + sizeof(TypeAllocator);
-    if (highestAllocatorAddress < (void *) highMark)
-        highestAllocatorAddress = (void *) highMark;
-
     VALGRIND_CREATE_MEMPOOL(this, 0, 0);
 }
 
@@ -124,85 +153,144 @@ TypeAllocator::~TypeAllocator()
     VALGRIND_DESTROY_MEMPOOL(this);
 
     for (Chunks::iterator c = chunks.begin(); c != chunks.end(); c++)
-        free((void *) *c);
+        FreeArena((void *) *c);
 }
 
 
-void *TypeAllocator::Allocate()
+void TypeAllocator::ReserveArenas()
 // ----------------------------------------------------------------------------
-//   Allocate a chunk of the given size
+//   Reserve the address space where all arenas will be allocated
 // ----------------------------------------------------------------------------
+//   Reserving address space does not use memory. Having all arenas in one
+//   reserved range makes IsGarbageCollected exact, and the arena size
+//   alignment lets us find the owner of a pointer with a table lookup.
+//   If we cannot reserve that much, e.g. on a 32-bit system, try less.
 {
-    MEMORY("Allocate in '%s', free list %p", this->name, freeList.Get());
-
-    Chunk_vp result;
-    do
+    size_t span = sizeof(void *) >= 8 ? (size_t) 1 << 30 : (size_t) 256 << 20;
+    for (; span >= ((size_t) 16 << 20); span /= 2)
     {
-        result = freeList;
-        while (!result)
+        size_t size = span + ARENA_ALIGN;
+#ifdef CONFIG_MINGW // Windows
+        void *reserved = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else // Real operating systems
+        void *reserved = mmap(NULL, size, PROT_NONE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                              -1, 0);
+        if (reserved == MAP_FAILED)
+            reserved = NULL;
+#endif // WINDOWS or real operating system
+        if (reserved)
         {
-            // Make sure only one thread allocates chunks
-            uint wasLocked = locked++;
-            if (wasLocked)
-            {
-                locked--;
-                result = freeList;
-                continue;
-            }
-        
-            // Nothing free: allocate a big enough chunk
-            size_t  itemSize  = alignedSize + sizeof(Chunk);
-            size_t  allocSize = (chunkSize + 1) * itemSize;
+            uintptr_t base = ((uintptr_t) reserved + ARENA_ALIGN - 1);
+            base &= ~(uintptr_t) (ARENA_ALIGN - 1);
+            arenaOwner = (TypeAllocator **)
+                calloc(span >> ARENA_BITS, sizeof(TypeAllocator *));
+            arenaRegion = (uint *) calloc(span >> ARENA_BITS, sizeof(uint));
+            arenaBase = (char *) base;
+            arenaSpan = span;
+            MEMORY("Reserved %lu bytes for arenas at %p", (ulong) span,
+                   (void *) base);
+            return;
+        }
+    }
+    throw std::bad_alloc();
+}
+
+
+void *TypeAllocator::AllocateArena(uint region)
+// ----------------------------------------------------------------------------
+//   Get memory for a chunk from the reserved address space
+// ----------------------------------------------------------------------------
+//   We reuse arenas released earlier before using new ones
+{
+    while (!arenaLock.SetQ(0, 1)) {}
+    if (!arenaBase)
+        ReserveArenas();
+
+    uint max = arenaSpan >> ARENA_BITS;
+    uint index = 0;
+    while (index < arenaCount && arenaOwner[index])
+        index++;
+    if (index >= max)
+    {
+        arenaLock.SetQ(1, 0);
+        throw std::bad_alloc();
+    }
 
-            void   *allocated = malloc(allocSize);
-            (void)VALGRIND_MAKE_MEM_NOACCESS(allocated, allocSize);
+    char *arena = arenaBase + ((uintptr_t) index << ARENA_BITS);
+#ifdef CONFIG_MINGW // Windows
+    bool ok = VirtualAlloc(arena, ARENA_SIZE, MEM_COMMIT, PAGE_READWRITE);
+#else // Real operating systems
+    bool ok = mprotect(arena, ARENA_SIZE, PROT_READ | PROT_WRITE) == 0;
+#endif // WINDOWS or real operating system
+    if (ok)
+    {
+        arenaOwner[index] = this;
+        arenaRegion[index] = region;
+        if (index == arenaCount)
+            arenaCount++;
+    }
+    arenaLock.SetQ(1, 0);
 
-            MEMORY("New chunk %p in '%s'", allocated, this->name);
+    if (!ok)
+        throw std::bad_alloc();
+    return arena;
+}
 
-            char *chunkBase = (char *) allocated + alignedSize;
-            Chunk_vp last = (Chunk_vp) chunkBase;
-            Chunk_vp free = result;
-            for (uint i = 0; i < chunkSize; i++)
-            {
-                Chunk_vp ptr = (Chunk_vp) (chunkBase + i * itemSize);
-                VALGRIND_MAKE_MEM_UNDEFINED(&ptr->next,sizeof(ptr->next));
-                ptr->next = free;
-                free = ptr;
-            }
 
-            // Update the chunks list
-            chunks.push_back((Chunk *) allocated);
-            available += chunkSize;
-            if (lowestAddress > allocated)
-                lowestAddress = allocated;
-            char *highMark = (char *) allocated + (chunkSize+1) * itemSize;
-            if (highestAddress < (void *) highMark)
-                highestAddress = highMark;
-
-            // Update the freelist
-            while (!freeList.SetQ(result, free))
-            {
-                result = freeList;
-                last->next = result;
-            }
+void TypeAllocator::FreeArena(void *arena)
+// ----------------------------------------------------------------------------
+//   Give the memory for an arena back to the system
+// ----------------------------------------------------------------------------
+//   The address space remains reserved, and the arena can be reused
+{
+#ifdef CONFIG_MINGW // Windows
+    VirtualFree(arena, ARENA_SIZE, MEM_DECOMMIT);
+#else // Real operating systems
+    madvise(arena, ARENA_SIZE, MADV_DONTNEED);
+    mprotect(arena, ARENA_SIZE, PROT_NONE);
+#endif // WINDOWS or real operating system
 
-            // Unlock the chunks
-            --locked;
+    uint index = ((char *) arena - arenaBase) >> ARENA_BITS;
+    while (!arenaLock.SetQ(0, 1)) {}
+    if (arenaRegion[index] == RELEASED_REGION)
+        arenaOwner[index]->regionChunks--;
+    arenaRegion[index] = 0;
+    arenaOwner[index] = NULL;
+    arenaLock.SetQ(1, 0);
+}
 
-            // Read back the free list
-            result = freeList;
-        }
-    }
-    while (!freeList.SetQ(result, result->next));
+
+void *TypeAllocator::Allocate()
+// ----------------------------------------------------------------------------
+//   Allocate a chunk of the given size
+// ----------------------------------------------------------------------------
+//   Items come from the magazine of the current thread, which is refilled
+//   from the shared free list in batches, so that we rarely touch shared data.
+{
+    Magazine &magazine = ThreadMagazine();
+    MEMORY("Allocate in '%s', magazine %p", this->name, magazine.free);
+
+    if (!magazine.free)
+        Refill(magazine);
+
+    Chunk_vp result = magazine.free;
+    magazine.free = result->next;
+    magazine.count--;
+    magazine.allocated++;
 
     VALGRIND_MAKE_MEM_UNDEFINED(result, sizeof(Chunk));
     result->allocator = this;
     result->bits |= IN_USE;     // Mark it as in use for current collection
     result->count = 0;
-    UpdateInUseRange(result);
-    allocatedCount++;
-    if (--available < chunkSize * 0.9)
-        gc->MustRun();
+    magazine.InUse(result);
+
+    // Allocation profiling: record one allocation every profileRate
+    if (profileRate && !magazine.sample--)
+    {
+        magazine.sample = profileRate - 1;
+        Sample(result, __builtin_return_address(0));
+    }
 
     void *ret =  (void *) &result[1];
     VALGRIND_MEMPOOL_ALLOC(this, ret, objectSize);
@@ -229,15 +317,19 @@ void TypeAllocator::Delete(void *ptr)
                  "Deleted GC pointer that was already freed");
     ELFE_ASSERT(!chunk->count &&
                  "Deleted pointer has live references");
+    if (chunk->bits & SAMPLED)
+        Unsample(chunk);
 
-    // Put the pointer back on the free list
-    do
-    {
-        chunk->next = freeList;
-    }
-    while (!freeList.SetQ(chunk->next, chunk));
-    available++;
-    freedCount++;
+    // Put the pointer back in the magazine for the current thread
+    Magazine &magazine = ThreadMagazine();
+    chunk->next = magazine.free;
+    magazine.free = chunk;
+    magazine.count++;
+    magazine.freed++;
+
+    // Give items back to other threads if we hold too many
+    if (magazine.count >= 2 * MAGAZINE_SIZE)
+        Flush(magazine, MAGAZINE_SIZE);
 
 #ifdef DEBUG
     // Scrub all the pointers
@@ -252,6 +344,254 @@ void TypeAllocator::Delete(void *ptr)
 }
 
 
+TypeAllocator::Magazine &TypeAllocator::ThreadMagazine()
+// ----------------------------------------------------------------------------
+//   Return the magazine for this allocator in the current thread
+// ----------------------------------------------------------------------------
+{
+    Magazines *magazines = threadMagazines;
+    if (!magazines || index >= magazines->size())
+    {
+        if (!magazines)
+        {
+            magazines = new Magazines;
+            threadMagazines = magazines;
+            pthread_setspecific(magazinesKey, magazines);
+
+            // A second thread needs atomic reference counts from the start
+            uint running = threads++;
+            ELFE_ASSERT((!running || IsMultiThreaded()) &&
+                        "GarbageCollector::MultiThreaded not called");
+            (void) running;
+        }
+        magazines->resize(gc->allocators.size());
+    }
+    return (*magazines)[index];
+}
+
+
+void TypeAllocator::Refill(Magazine &magazine)
+// ----------------------------------------------------------------------------
+//   Move a batch of items to a thread magazine
+// ----------------------------------------------------------------------------
+//   We first recycle freed items, so that the items in use stay close
+//   together and collections scan a narrow range. We only carve items never
+//   used from the newest chunk when there is none, and add a chunk when
+//   that is exhausted as well.
+//   A region that allocated more than a few items of this type only
+//   bump-allocates from arenas of its own.
+{
+    Lock();
+    uint taken = 0;
+    GCRegion *region = threadRegion;
+    GCRegion::Nursery *nursery = NULL;
+    if (region)
+    {
+        if (region->nurseries.size() <= index)
+            region->nurseries.resize(gc->allocators.size());
+        nursery = &region->nurseries[index];
+
+        // Small regions share chunks, so that each small file does not
+        // keep a mostly empty arena for each type
+        if (!nursery->end && nursery->shared < chunkSize / 4)
+            nursery = NULL;
+    }
+
+    if (nursery)
+    {
+        if (nursery->next == nursery->end)
+            AddChunk(region);
+        taken = Carve(nursery->next, nursery->end, magazine);
+    }
+    else if (!freeList)
+    {
+        if (freshNext == freshEnd)
+            AddChunk();
+        taken = Carve(freshNext, freshEnd, magazine);
+    }
+    else
+    {
+        // Take up to MAGAZINE_SIZE items from the head of the free list
+        Chunk_vp first = freeList;
+        Chunk_vp last = first;
+        taken = 1;
+        while (taken < MAGAZINE_SIZE && last->next)
+        {
+            last = last->next;
+            taken++;
+        }
+        freeList = last->next;
+        last->next = magazine.free;
+        magazine.free = first;
+        magazine.count += taken;
+    }
+    if (region && !nursery)
+        region->nurseries[index].shared += taken;
+
+    available -= taken;
+    uint left = available;
+    ReportCounters(magazine);
+    Unlock();
+
+    MEMORY("Refill '%s' with %u items, %u left", name, taken, left);
+    if (left < chunkSize * 0.9)
+        gc->MustRun();
+}
+
+
+uint TypeAllocator::Carve(char *&next, char *end, Magazine &magazine)
+// ----------------------------------------------------------------------------
+//   Move up to a magazine worth of contiguous items to a thread magazine
+// ----------------------------------------------------------------------------
+//   Items are linked so that they are used in address order
+{
+    size_t itemSize = alignedSize + sizeof(Chunk);
+    uint   room = (end - next) / itemSize;
+    uint   taken = room < MAGAZINE_SIZE ? room : MAGAZINE_SIZE;
+    char  *first = next;
+    next += taken * itemSize;
+    for (char *item = next; item > first; )
+    {
+        item -= itemSize;
+        Chunk_vp ptr = (Chunk_vp) item;
+        VALGRIND_MAKE_MEM_UNDEFINED(&ptr->next,sizeof(ptr->next));
+        ptr->next = magazine.free;
+        magazine.free = ptr;
+    }
+    magazine.count += taken;
+    return taken;
+}
+
+
+void TypeAllocator::Flush(Magazine &magazine, uint keep)
+// ----------------------------------------------------------------------------
+//   Give all but 'keep' items of a magazine back to the shared free list
+// ----------------------------------------------------------------------------
+{
+    if (magazine.count <= keep)
+    {
+        Lock();
+        ReportCounters(magazine);
+        Unlock();
+        return;
+    }
+
+    // Skip the items we keep, the rest goes back to the free list
+    Chunk_vp *tail = (Chunk_vp *) &magazine.free;
+    for (uint i = 0; i < keep; i++)
+        tail = (Chunk_vp *) &(*tail)->next;
+    Chunk_vp first = *tail;
+    Chunk_vp last = first;
+    while (last->next)
+        last = last->next;
+    *tail = NULL;
+    uint given = magazine.count - keep;
+    magazine.count = keep;
+
+    Lock();
+    last->next = freeList;
+    freeList = first;
+    available += given;
+    ReportCounters(magazine);
+    Unlock();
+
+    MEMORY("Flush %u items to '%s'", given, name);
+}
+
+
+void TypeAllocator::ReportCounters(Magazine &magazine)
+// ----------------------------------------------------------------------------
+//   Fold the counters accumulated in a magazine into the allocator
+// ----------------------------------------------------------------------------
+//   This includes the range of items the thread allocated or marked in use,
+//   which the next collection must scan
+{
+    allocatedCount += magazine.allocated;
+    freedCount += magazine.freed;
+    magazine.allocated = 0;
+    magazine.freed = 0;
+
+    if (magazine.lowestInUse < magazine.highestInUse)
+    {
+        lowestInUse.Minimize(magazine.lowestInUse);
+        highestInUse.Maximize(magazine.highestInUse);
+        magazine.lowestInUse = ~0UL;
+        magazine.highestInUse = 0;
+    }
+}
+
+
+void TypeAllocator::AddChunk(GCRegion *region)
+// ----------------------------------------------------------------------------
+//   Allocate a new chunk whose items Refill carves in order
+// ----------------------------------------------------------------------------
+//   This is called with the allocator locked. Items in the chunk are only
+//   touched when they are carved by Refill. Items that a region did not
+//   use yet read as zero, so a scan does not mistake them for allocated
+//   items.
+{
+    size_t  itemSize  = alignedSize + sizeof(Chunk);
+    void   *allocated = AllocateArena(region ? region->id : 0);
+    (void)VALGRIND_MAKE_MEM_NOACCESS(allocated, ARENA_SIZE);
+
+    MEMORY("New chunk %p in '%s' region %u",
+           allocated, this->name, region ? region->id : 0);
+
+    char *chunkBase = (char *) allocated + alignedSize;
+    if (region)
+    {
+        GCRegion::Nursery &nursery = region->nurseries[index];
+        nursery.next = chunkBase;
+        nursery.end = chunkBase + chunkSize * itemSize;
+    }
+    else
+    {
+        freshBase = chunkBase;
+        freshNext = chunkBase;
+        freshEnd = chunkBase + chunkSize * itemSize;
+    }
+
+    // Update the chunks list
+    chunks.push_back((Chunk *) allocated);
+    available += chunkSize;
+}
+
+
+void TypeAllocator::Sample(Chunk_vp chunk, void *caller)
+// ----------------------------------------------------------------------------
+//   Record an allocation for the allocation profiler
+// ----------------------------------------------------------------------------
+//   The caller is the return address of Allocate, which is the code doing
+//   'new' once the inline Allocator<T>::Allocate and operator new are inlined
+{
+    Site site = { this, profilePosition, caller };
+    chunk->bits |= SAMPLED;
+
+    while (!profileLock.SetQ(0, 1)) {}
+    Samples &samples = profile[site];
+    samples.allocated++;
+    samples.alive++;
+    sampled[(void *) chunk] = site;
+    profileLock.SetQ(1, 0);
+}
+
+
+void TypeAllocator::Unsample(Chunk_vp chunk)
+// ----------------------------------------------------------------------------
+//   Record that a sampled object was freed
+// ----------------------------------------------------------------------------
+{
+    while (!profileLock.SetQ(0, 1)) {}
+    Sampled::iterator found = sampled.find((void *) chunk);
+    if (found != sampled.end())
+    {
+        profile[found->second].alive--;
+        sampled.erase(found);
+    }
+    profileLock.SetQ(1, 0);
+}
+
+
 void TypeAllocator::Finalize(void *ptr)
 // ----------------------------------------------------------------------------
 //   We should never reach this one
@@ -278,6 +618,10 @@ void TypeAllocator::ScheduleDelete(TypeAllocator::Chunk_vp ptr)
 
         if (allocator->finalizing)
         {
+            // Linking overwrites the allocation bits, profile it as freed
+            if (ptr->bits & SAMPLED)
+                allocator->Unsample(ptr);
+
             // Put it on the to-delete list to avoid deep recursion
             LinkedListInsert(allocator->toDelete, ptr);
         }
@@ -297,6 +641,20 @@ bool TypeAllocator::CheckLeakedPointers()
 // ----------------------------------------------------------------------------
 //   Check if any pointers were allocated and not captured between safe points
 // ----------------------------------------------------------------------------
+{
+    StartScan();
+    ContinueScan(0);
+    return scanCollected;
+}
+
+
+void TypeAllocator::StartScan()
+// ----------------------------------------------------------------------------
+//   Record the range of items to check in this collection
+// ----------------------------------------------------------------------------
+//   We scan the range of items that were allocated, marked in use or
+//   released since the last collection. Items marked or allocated while
+//   the scan is in progress are recorded for the next collection.
 {
     MEMORY("CheckLeaks in '%s'", name);
 
@@ -306,15 +664,39 @@ bool TypeAllocator::CheckLeakedPointers()
     lowestInUse.Set((uintptr_t) lo, ~0UL);
     highestInUse.Set((uintptr_t) hi, 0UL);
 
-    uint  collected = 0;
-    totalCount = 0;
-    for (Chunks::iterator chk = chunks.begin(); chk != chunks.end(); chk++)
+    scanLow = lo;
+    scanHigh = hi;
+    scanChunk = 0;
+    scanNext = NULL;
+    scanCollected = 0;
+}
+
+
+bool TypeAllocator::ContinueScan(ulonglong deadline)
+// ----------------------------------------------------------------------------
+//   Scan items from where we stopped, return true when the scan is complete
+// ----------------------------------------------------------------------------
+//   If the deadline (in microseconds) is not zero, we check it periodically
+//   and stop scanning when it has passed.
+{
+    char   *lo = scanLow;
+    char   *hi = scanHigh;
+    size_t  itemSize = alignedSize + sizeof(Chunk);
+    uint    collected = 0;
+    uint    scanned = 0;
+    uint    max = chunks.size();
+    bool    done = true;
+
+    totalCount = max * chunkSize;
+    while (scanChunk < max)
     {
-        char   *chunkBase = (char *) *chk + alignedSize;
-        size_t  itemSize  = alignedSize + sizeof(Chunk);
+        char   *chunkBase = (char *) chunks[scanChunk] + alignedSize;
         char   *chunkEnd = chunkBase + itemSize * chunkSize;
-        totalCount += chunkSize;
-        
+
+        // Items of the newest chunk past those carved were never initialized
+        if (chunkBase == freshBase)
+            chunkEnd = freshNext;
+
         if (chunkBase <= hi && chunkEnd  >= lo)
         {
             char *start = (char *) chunkBase;
@@ -323,10 +705,20 @@ bool TypeAllocator::CheckLeakedPointers()
                 start = lo;
             if (end > hi)
                 end = hi;
-            scannedCount += (end - start) / itemSize;
+            if (scanNext > start)
+                start = scanNext;
 
             for (char *addr = start; addr < end; addr += itemSize)
             {
+                // Check the time every now and then
+                if (deadline && (++scanned & 255) == 0 &&
+                    GarbageCollector::Microseconds() >= deadline)
+                {
+                    scanNext = addr;
+                    done = false;
+                    break;
+                }
+
                 Chunk_vp ptr = (Chunk_vp) addr;
                 if (AllocatorPointer(ptr->allocator) == this)
                 {
@@ -339,13 +731,22 @@ bool TypeAllocator::CheckLeakedPointers()
                     }
                 }
             }
+            if (!done)
+            {
+                scannedCount += (scanNext - start) / itemSize;
+                break;
+            }
+            scannedCount += (end - start) / itemSize;
         }
+        scanChunk++;
+        scanNext = NULL;
     }
 
+    scanCollected += collected;
     collectedCount += collected;
-    MEMORY("CheckLeaks in '%s' done, scanned %u, collected %u",
-           name, scannedCount, collected);
-    return collected;
+    MEMORY("CheckLeaks in '%s' %s, scanned %u, collected %u",
+           name, done ? "done" : "paused", scannedCount, collected);
+    return done;
 }
 
 
@@ -377,10 +778,149 @@ void TypeAllocator::ResetStatistics()
     allocatedCount = 0;
     scannedCount = 0;
     collectedCount = 0;
+    releasedCount = 0;
     totalCount = 0;
 }
 
 
+bool TypeAllocator::ListObjects(Objects &objects, uint &chunk,
+                                ulonglong deadline)
+// ----------------------------------------------------------------------------
+//    Append the objects currently allocated to the given list
+// ----------------------------------------------------------------------------
+//    This must be called at a safe point, when no allocation is in flight.
+//    Items in free lists, in thread magazines or on the toDelete list
+//    are not linked to the allocator, so they are not listed.
+//    We start at the given chunk, and if the deadline (in microseconds)
+//    is not zero, we stop after the first chunk that ends past it. The chunk
+//    index is updated for the next call. We return true once all are listed.
+{
+    size_t  itemSize = alignedSize + sizeof(Chunk);
+    uint    max = chunks.size();
+    while (chunk < max)
+    {
+        char   *chunkBase = (char *) chunks[chunk++] + alignedSize;
+        char   *chunkEnd = chunkBase + itemSize * chunkSize;
+
+        // Items of the newest chunk past those carved were never initialized
+        if (chunkBase == freshBase)
+            chunkEnd = freshNext;
+
+        for (char *addr = chunkBase; addr < chunkEnd; addr += itemSize)
+        {
+            Chunk_vp ptr = (Chunk_vp) addr;
+            if (AllocatorPointer(ptr->allocator) == this)
+                objects.push_back((void *) (ptr + 1));
+        }
+
+        if (deadline && chunk < max &&
+            GarbageCollector::Microseconds() >= deadline)
+            return false;
+    }
+    return true;
+}
+
+
+uint TypeAllocator::Trim(uint keep)
+// ----------------------------------------------------------------------------
+//    Give chunks with no live item back to the system, return count
+// ----------------------------------------------------------------------------
+//    We count the items of the shared free list that belong to each chunk.
+//    A chunk where all items are in the free list has no live object and
+//    no item in a thread magazine, so it can be released. We keep up to
+//    'keep' empty chunks to avoid allocating them again right away,
+//    but never chunks of a released region.
+//    This must not be called while a collection is in progress.
+{
+    size_t  itemSize = alignedSize + sizeof(Chunk);
+    uint    freshLeft = (freshEnd - freshNext) / itemSize;
+    uint    reserve = regionChunks ? 0 : keep;
+
+    // Quick exit if there are not enough free items to empty a chunk
+    if (available < freshLeft + (reserve + 1) * chunkSize)
+        return 0;
+
+    Lock();
+
+    // Sort chunks by address to find which chunk each free item belongs to
+    typedef std::pair<char *, uint> ChunkIndex;
+    typedef std::vector<ChunkIndex> ChunkIndices;
+    uint max = chunks.size();
+    ChunkIndices sorted(max);
+    for (uint c = 0; c < max; c++)
+        sorted[c] = ChunkIndex((char *) chunks[c], c);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<uint> freeItems(max, 0);
+    std::vector<uint> owner;
+    for (Chunk_vp item = freeList; item; item = item->next)
+    {
+        ChunkIndex key((char *) item, ~0U);
+        ChunkIndices::iterator found =
+            std::upper_bound(sorted.begin(), sorted.end(), key);
+        uint c = (--found)->second;
+        freeItems[c]++;
+        owner.push_back(c);
+    }
+
+    // Select the chunks to release, never the one still being carved
+    std::vector<bool> release(max, false);
+    uint empty = 0, released = 0;
+    for (uint c = 0; c < max; c++)
+    {
+        char *chunkBase = (char *) chunks[c] + alignedSize;
+        if (freeItems[c] == chunkSize && chunkBase != freshBase)
+        {
+            uint arena = ((char *) chunks[c] - arenaBase) >> ARENA_BITS;
+            if (arenaRegion[arena] == RELEASED_REGION || empty++ >= keep)
+            {
+                release[c] = true;
+                released++;
+            }
+        }
+    }
+
+    if (released)
+    {
+        // Rebuild the free list without the items of released chunks
+        Chunk_vp head = NULL;
+        Chunk_vp *tail = &head;
+        uint i = 0;
+        for (Chunk_vp item = freeList; item; item = item->next, i++)
+        {
+            if (!release[owner[i]])
+            {
+                *tail = item;
+                tail = (Chunk_vp *) &item->next;
+            }
+        }
+        *tail = NULL;
+        freeList = head;
+
+        // Unmap the released chunks
+        Chunks kept;
+        for (uint c = 0; c < max; c++)
+        {
+            if (release[c])
+            {
+                MEMORY("Release chunk %p in '%s'", chunks[c], name);
+                FreeArena((void *) chunks[c]);
+            }
+            else
+            {
+                kept.push_back(chunks[c]);
+            }
+        }
+        chunks.swap(kept);
+        available -= released * chunkSize;
+        releasedCount += released;
+    }
+
+    Unlock();
+    return released;
+}
+
+
 void *TypeAllocator::operator new(size_t size)
 // ----------------------------------------------------------------------------
 //   Force 16-byte alignment not guaranteed by regular operator new
@@ -436,11 +976,21 @@ bool TypeAllocator::CanDelete(void *obj)
 //
 // ============================================================================
 
+static void createMagazinesKey()
+// ----------------------------------------------------------------------------
+//   Create the key used to give magazines back when a thread exits
+// ----------------------------------------------------------------------------
+{
+    pthread_key_create(&magazinesKey, GarbageCollector::FlushThreadMagazines);
+}
+
+
 GarbageCollector::GarbageCollector()
 // ----------------------------------------------------------------------------
 //   Create the garbage collector
 // ----------------------------------------------------------------------------
-    : mustRun(false), running(false)
+    : mustRun(false), running(false), pressure(0),
+      budget(0), scanIndex(0), inCycle(false)
 {}
 
 
@@ -452,16 +1002,14 @@ GarbageCollector::~GarbageCollector()
     MustRun();
     Collect();
     Collect();
+    FlushThreadMagazines();
 
     Allocators::iterator i;
     for (i = allocators.begin(); i != allocators.end(); i++)
         delete *i;
 
     // Make sure that destructors down the line won't try something silly
-    TypeAllocator::lowestAddress = (void *) ~0;
-    TypeAllocator::highestAddress = (void *) 0;
-    TypeAllocator::lowestAllocatorAddress = (void *) ~0;
-    TypeAllocator::highestAllocatorAddress = (void *) 0;
+    TypeAllocator::arenaSpan = 0;
 
 }
 
@@ -471,10 +1019,65 @@ void GarbageCollector::Register(TypeAllocator *allocator)
 //    Record each individual allocator
 // ----------------------------------------------------------------------------
 {
+    pthread_once(&magazinesOnce, createMagazinesKey);
+    allocator->index = allocators.size();
     allocators.push_back(allocator);
 }
 
 
+void GarbageCollector::ReportThreadCounters()
+// ----------------------------------------------------------------------------
+//   Fold the counters of the current thread's magazines into the allocators
+// ----------------------------------------------------------------------------
+//   Other threads report theirs the next time they refill or flush
+{
+    Allocators::iterator a;
+    for (a = allocators.begin(); a != allocators.end(); a++)
+    {
+        TypeAllocator *ta = *a;
+        ta->Lock();
+        ta->ReportCounters(ta->ThreadMagazine());
+        ta->Unlock();
+    }
+}
+
+
+void GarbageCollector::FlushThreadMagazines(void *magazines)
+// ----------------------------------------------------------------------------
+//   Return all items held by a thread, called on thread exit
+// ----------------------------------------------------------------------------
+//   If the thread is in a region, the magazines of the region are left alone
+{
+    TypeAllocator::Magazines **owner = &threadMagazines;
+    if (threadRegion)
+        owner = &threadRegion->saved;
+
+    TypeAllocator::Magazines *mags = (TypeAllocator::Magazines *) magazines;
+    if (!mags)
+        mags = *owner;
+    if (!mags)
+        return;
+
+    if (gc)
+    {
+        Allocators &allocators = gc->allocators;
+        uint max = mags->size();
+        for (uint i = 0; i < max; i++)
+            allocators[i]->Flush((*mags)[i], 0);
+    }
+
+    if (mags == *owner)
+    {
+        *owner = NULL;
+        pthread_setspecific(magazinesKey, NULL);
+    }
+    delete mags;
+
+    // The thread will count again if it allocates after that
+    TypeAllocator::threads--;
+}
+
+
 bool GarbageCollector::Sweep()
 // ----------------------------------------------------------------------------
 //    Cleanup all the pending deletions
@@ -488,10 +1091,12 @@ bool GarbageCollector::Sweep()
 }
 
 
-bool GarbageCollector::Collect()
+bool GarbageCollector::Collect(uint budget)
 // ----------------------------------------------------------------------------
 //   Run garbage collection on all the allocators we own
 // ----------------------------------------------------------------------------
+//   If budget is not zero, we stop after that many microseconds, and the
+//   next call resumes the collection where this one stopped.
 {
     pthread_t self = pthread_self();
 
@@ -501,84 +1106,264 @@ bool GarbageCollector::Collect()
     {
         MEMORY("Garbage collection in thread %p", self);
 
-        Allocators::iterator a;
-        Listeners listeners;
-        Listeners::iterator l;
-
-        // Build the listeners from all allocators
-        for (a = allocators.begin(); a != allocators.end(); a++)
-            for (l = (*a)->listeners.begin(); l != (*a)->listeners.end(); l++)
-                listeners.insert(*l);
+        ulonglong deadline = budget ? Microseconds() + budget : 0;
+        bool finished = false;
 
         // Notify all the listeners that we begin a collection
-        for (l = listeners.begin(); l != listeners.end(); l++)
-            (*l)->BeginCollection();
+        if (!inCycle)
+        {
+            NotifyListeners(BEGIN_COLLECTION);
+            StartPass();
+            inCycle = true;
+        }
 
         // Cleanup pending purges to maximize the effect of garbage collection
-        bool sweeping = true;
-        while (sweeping)
+        while (!finished)
         {
             // Check if any object was allocated and not captured at this stage
-            for (a = allocators.begin(); a != allocators.end(); a++)
-                (*a)->CheckLeakedPointers();
-            sweeping = Sweep();
+            uint max = allocators.size();
+            while (scanIndex < max &&
+                   allocators[scanIndex]->ContinueScan(deadline))
+                scanIndex++;
+            if (scanIndex < max)
+                break;
+
+            // If this freed anything, we need another pass
+            if (!Sweep())
+            {
+                finished = true;
+                break;
+            }
+            StartPass();
+            if (deadline && Microseconds() >= deadline)
+                break;
         }
 
-        // Notify all the listeners that we completed the collection
-        for (l = listeners.begin(); l != listeners.end(); l++)
-            (*l)->EndCollection();
+        if (finished)
+        {
+            // Notify all the listeners that we completed the collection
+            NotifyListeners(END_COLLECTION);
+            inCycle = false;
+
+            // Give the memory we no longer need back to the system
+            Trim(pressure.SetQ(1U, 0U));
 
-        // Print statistics (inside lock, to increase race pressure)
-        IFTRACE(memory)
-            PrintStatistics();
+            // Print statistics (inside lock, to increase race pressure)
+            IFTRACE(memory)
+                PrintStatistics();
+
+            // We are done, mark it so
+            mustRun &= 0U;
+        }
 
-        // We are done, mark it so
-        mustRun &= 0U;
         if (!Atomic<pthread_t>::SetQ(collecting, self, PTHREAD_NULL))
         {
             ELFE_ASSERT(!"Someone else stole the collection lock?");
         }
 
-        MEMORY("Finished garbage collection in thread %p", self);
-        return true;
+        MEMORY("%s garbage collection in thread %p",
+               finished ? "Finished" : "Paused", self);
+        return finished;
     }
     MEMORY("Garbage collection for thread %p was blocked", self);
     return false;
 }
 
 
+void GarbageCollector::StartPass()
+// ----------------------------------------------------------------------------
+//   Start scanning all allocators
+// ----------------------------------------------------------------------------
+//   The in-use range of this thread is reported first. Other threads report
+//   theirs when they refill or flush a magazine, so the items they used
+//   since then are only scanned by a later collection.
+{
+    ReportThreadCounters();
+
+    Allocators::iterator a;
+    for (a = allocators.begin(); a != allocators.end(); a++)
+        (*a)->StartScan();
+    scanIndex = 0;
+}
+
+
+void GarbageCollector::Trim(bool aggressive)
+// ----------------------------------------------------------------------------
+//   Release empty chunks after a collection
+// ----------------------------------------------------------------------------
+//   Normally, we keep one empty chunk per allocator to absorb the next burst.
+//   Under memory pressure, listeners get a chance to free what they can,
+//   we give back the items held by this thread, and keep nothing in reserve.
+{
+    if (aggressive)
+    {
+        NotifyListeners(MEMORY_PRESSURE);
+        FlushThreadMagazines();
+    }
+
+    uint released = 0;
+    Allocators::iterator a;
+    for (a = allocators.begin(); a != allocators.end(); a++)
+        released += (*a)->Trim(aggressive ? 0 : 1);
+
+#ifdef __GLIBC__
+    // Also return what malloc holds for other data structures
+    if (aggressive)
+        malloc_trim(0);
+#endif // __GLIBC__
+
+    MEMORY("Trimmed %u chunks%s", released, aggressive ? " under pressure":"");
+}
+
+
+void GarbageCollector::NotifyListeners(Notification what)
+// ----------------------------------------------------------------------------
+//   Notify the listeners of all allocators of a collection event
+// ----------------------------------------------------------------------------
+{
+    Allocators::iterator a;
+    Listeners listeners;
+    Listeners::iterator l;
+
+    // Build the listeners from all allocators
+    for (a = allocators.begin(); a != allocators.end(); a++)
+        for (l = (*a)->listeners.begin(); l != (*a)->listeners.end(); l++)
+            listeners.insert(*l);
+
+    for (l = listeners.begin(); l != listeners.end(); l++)
+    {
+        switch(what)
+        {
+        case BEGIN_COLLECTION:  (*l)->BeginCollection();        break;
+        case END_COLLECTION:    (*l)->EndCollection();          break;
+        case MEMORY_PRESSURE:   (*l)->MemoryPressure();         break;
+        }
+    }
+}
+
+
+ulonglong GarbageCollector::Microseconds()
+// ----------------------------------------------------------------------------
+//   Current time used to limit the duration of a collection step
+// ----------------------------------------------------------------------------
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (ulonglong) tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+
 void GarbageCollector::PrintStatistics()
 // ----------------------------------------------------------------------------
 //    Print statistics about collection
 // ----------------------------------------------------------------------------
 {
     uint tot = 0, alloc = 0, avail = 0, freed = 0, scan = 0, collect = 0;
-    printf("%24s %8s %8s %8s %8s %8s %8s\n",
-           "NAME", "TOTAL", "AVAIL", "ALLOC", "FREED", "SCANNED", "COLLECT");
+    uint release = 0;
+    ReportThreadCounters();
+    printf("%24s %8s %8s %8s %8s %8s %8s %8s\n",
+           "NAME", "TOTAL", "AVAIL", "ALLOC", "FREED", "SCANNED", "COLLECT",
+           "RELEASE");
 
     Allocators::iterator a;
     for (a = allocators.begin(); a != allocators.end(); a++)
     {
         TypeAllocator *ta = *a;
-        printf("%24s %8u %8u %8u %8u %8u %8u\n",
+        uint released = ta->releasedCount * ta->chunkSize;
+        printf("%24s %8u %8u %8u %8u %8u %8u %8u\n",
                ta->name, ta->totalCount,
                ta->available.Get(), ta->allocatedCount,
-               ta->freedCount.Get(), ta->scannedCount, ta->collectedCount);
+               ta->freedCount.Get(), ta->scannedCount, ta->collectedCount,
+               released);
         tot     += ta->totalCount     * ta->alignedSize;
         alloc   += ta->allocatedCount * ta->alignedSize;
         avail   += ta->available      * ta->alignedSize;
         freed   += ta->freedCount     * ta->alignedSize;
         scan    += ta->scannedCount   * ta->alignedSize;
         collect += ta->collectedCount * ta->alignedSize;
+        release += released           * ta->alignedSize;
 
         ta->ResetStatistics();            
     }
-    printf("%24s %8s %8s %8s %8s %8s %8s\n",
-           "=====", "=====", "=====", "=====", "=====", "=====", "=====");
-    printf("%24s %7uK %7uK %7uK %7uK %7uK %7uK\n",
+    printf("%24s %8s %8s %8s %8s %8s %8s %8s\n",
+           "=====", "=====", "=====", "=====", "=====", "=====", "=====",
+           "=====");
+    printf("%24s %7uK %7uK %7uK %7uK %7uK %7uK %7uK\n",
            "Kilobytes",
            tot >> 10, avail >> 10, alloc >> 10,
-           freed >> 10, scan >> 10, collect >> 10);
+           freed >> 10, scan >> 10, collect >> 10, release >> 10);
+}
+
+
+void GarbageCollector::SetProfileRate(uint rate)
+// ----------------------------------------------------------------------------
+//    Sample one allocation every 'rate' for profiling, 0 to disable
+// ----------------------------------------------------------------------------
+{
+    TypeAllocator::profileRate = rate;
+}
+
+
+void GarbageCollector::PrintProfile(PositionName positionName)
+// ----------------------------------------------------------------------------
+//    Print the allocation sites recorded by the allocation profiler
+// ----------------------------------------------------------------------------
+//    Counts are estimated by scaling the samples by the sampling rate.
+{
+    typedef TypeAllocator::Profile  Profile;
+    typedef std::vector<const Profile::value_type *> Entries;
+    struct BySampledBytes
+    {
+        // Sort entries with those that allocated the most bytes first
+        bool operator()(const Profile::value_type *a,
+                        const Profile::value_type *b)
+        {
+            ulonglong aSize = a->first.allocator->alignedSize;
+            ulonglong bSize = b->first.allocator->alignedSize;
+            return a->second.allocated * aSize > b->second.allocated * bSize;
+        }
+    };
+
+    uint rate = TypeAllocator::profileRate;
+    if (!rate)
+        return;
+
+    while (!TypeAllocator::profileLock.SetQ(0, 1)) {}
+    Profile &profile = TypeAllocator::profile;
+    Entries entries;
+    for (Profile::iterator p = profile.begin(); p != profile.end(); p++)
+        entries.push_back(&*p);
+    std::sort(entries.begin(), entries.end(), BySampledBytes());
+
+    fprintf(stderr, "Allocation profile, one sample every %u allocations\n",
+            rate);
+    fprintf(stderr, "%24s %10s %10s %10s %10s  %-24s %s\n",
+            "NAME", "OBJECTS", "BYTES", "ALIVE", "ALIVEBYTES",
+            "SOURCE", "CALLER");
+    for (Entries::iterator e = entries.begin(); e != entries.end(); e++)
+    {
+        const TypeAllocator::Site &site = (*e)->first;
+        const TypeAllocator::Samples &samples = (*e)->second;
+        ulonglong size = site.allocator->alignedSize;
+        ulonglong objects = (ulonglong) samples.allocated * rate;
+        ulonglong alive = (ulonglong) samples.alive * rate;
+        text source = positionName(site.position);
+
+        text caller;
+#ifndef CONFIG_MINGW
+        void *address = site.caller;
+        if (char **symbols = backtrace_symbols(&address, 1))
+        {
+            caller = symbols[0];
+            free(symbols);
+        }
+#endif // CONFIG_MINGW
+
+        fprintf(stderr, "%24s %10llu %10llu %10llu %10llu  %-24s %s\n",
+                site.allocator->name, objects, objects * size,
+                alive, alive * size, source.c_str(), caller.c_str());
+    }
+    TypeAllocator::profileLock.SetQ(1, 0);
 }
 
 
@@ -590,6 +1375,7 @@ void GarbageCollector::Statistics(uint &total,
 // ----------------------------------------------------------------------------
 {
     uint tot = 0, alloc = 0, avail = 0, free = 0, scan = 0, collect = 0;
+    ReportThreadCounters();
     std::vector<TypeAllocator *>::iterator a;
     for (a = allocators.begin(); a != allocators.end(); a++)
     {
@@ -637,6 +1423,101 @@ void GarbageCollector::Delete()
     }
 }
 
+
+
+// ============================================================================
+//
+//   Regions
+//
+// ============================================================================
+
+GCRegion::GCRegion()
+// ----------------------------------------------------------------------------
+//   Create a new region and make it current for this thread
+// ----------------------------------------------------------------------------
+    : id(0), magazines(), saved(threadMagazines), previous(threadRegion),
+      nurseries()
+{
+    typedef TypeAllocator TA;
+    while (!TA::arenaLock.SetQ(0, 1)) {}
+    if (++TA::regionCount == TA::RELEASED_REGION)
+        TA::regionCount = 1;
+    id = TA::regionCount;
+    TA::arenaLock.SetQ(1, 0);
+
+    threadMagazines = &magazines;
+    threadRegion = this;
+}
+
+
+GCRegion::~GCRegion()
+// ----------------------------------------------------------------------------
+//   Give the items the region did not use to the allocators
+// ----------------------------------------------------------------------------
+{
+    typedef TypeAllocator::Chunk_vp Chunk_vp;
+    typedef TypeAllocator::Chunk    Chunk;
+
+    threadMagazines = saved;
+    threadRegion = previous;
+
+    GarbageCollector::Allocators &allocators = GarbageCollector::gc->allocators;
+    uint max = magazines.size();
+    for (uint i = 0; i < max; i++)
+        allocators[i]->Flush(magazines[i], 0);
+
+    max = nurseries.size();
+    for (uint i = 0; i < max; i++)
+    {
+        Nursery &nursery = nurseries[i];
+        if (nursery.next < nursery.end)
+        {
+            TypeAllocator *ta = allocators[i];
+            size_t itemSize = ta->alignedSize + sizeof(Chunk);
+            ta->Lock();
+            for (char *item = nursery.end; item > nursery.next; )
+            {
+                item -= itemSize;
+                Chunk_vp ptr = (Chunk_vp) item;
+                VALGRIND_MAKE_MEM_UNDEFINED(&ptr->next,sizeof(ptr->next));
+                ptr->next = ta->freeList;
+                ta->freeList = ptr;
+            }
+            ta->Unlock();
+        }
+    }
+    MEMORY("Left region %u", id);
+}
+
+
+void GCRegion::Release(uint id)
+// ----------------------------------------------------------------------------
+//   Give the arenas of a region back to the system once their objects died
+// ----------------------------------------------------------------------------
+//   Whatever still references objects in the region keeps their arena.
+//   The others are released by the trim following the next collection,
+//   which we do not force, since it is needed anyway to delete the objects.
+{
+    typedef TypeAllocator TA;
+    if (!id || !TA::arenaSpan)
+        return;
+
+    uint released = 0;
+    while (!TA::arenaLock.SetQ(0, 1)) {}
+    for (uint a = 0; a < TA::arenaCount; a++)
+    {
+        if (TA::arenaRegion[a] == id)
+        {
+            TA::arenaRegion[a] = TA::RELEASED_REGION;
+            TA::arenaOwner[a]->regionChunks++;
+            released++;
+        }
+    }
+    TA::arenaLock.SetQ(1, 0);
+
+    MEMORY("Released region %u with %u arenas", id, released);
+}
+
 ELFE_END
 
 void debuggc(void *ptr)
@@ -44,6 +44,7 @@
 #include "base.h"
 #include "atomic.h"
 
+#include <atomic>
 #include <vector>
 #include <map>
 #include <set>
@@ -55,6 +56,7 @@ extern void debuggc(void *);
 ELFE_BEGIN
 
 struct GarbageCollector;
+struct GCRegion;
 template <class Object, typename ValueType=void> struct GCPtr;
 
 
@@ -83,6 +85,52 @@ struct TypeAllocator
     typedef volatile Chunk *Chunk_vp;
     typedef std::vector<Chunk_vp> Chunks;
 
+    struct Magazine
+    {
+        Magazine(): free(NULL), count(0), allocated(0), freed(0), sample(0),
+                    lowestInUse(~0UL), highestInUse(0) {}
+        Chunk_vp        free;           // Free items owned by one thread
+        uint            count;          // Number of items in free
+        uint            allocated;      // Allocations not yet reported
+        uint            freed;          // Deletions not yet reported
+        uint            sample;         // Allocations until next sample
+        uintptr_t       lowestInUse;    // In-use range not yet reported
+        uintptr_t       highestInUse;
+
+        void InUse(Chunk_vp chunk)
+        {
+            if ((uintptr_t) chunk < lowestInUse)
+                lowestInUse = (uintptr_t) chunk;
+            if ((uintptr_t) (chunk + 1) > highestInUse)
+                highestInUse = (uintptr_t) (chunk + 1);
+        }
+    };
+    typedef std::vector<Magazine> Magazines;
+    typedef std::vector<void *> Objects;
+
+    struct Site
+    {
+        TypeAllocator * allocator;      // Type being allocated
+        ulong           position;       // Source position being evaluated
+        void *          caller;         // C++ code doing the allocation
+        bool operator<(const Site &o) const
+        {
+            if (allocator != o.allocator)
+                return allocator < o.allocator;
+            if (position != o.position)
+                return position < o.position;
+            return caller < o.caller;
+        }
+    };
+    struct Samples
+    {
+        Samples(): allocated(0), alive(0) {}
+        uint            allocated;      // Sampled allocations at this site
+        uint            alive;          // Sampled objects not yet freed
+    };
+    typedef std::map<Site, Samples>     Profile;
+    typedef std::map<void *, Site>      Sampled;
+
 public:
     TypeAllocator(kstring name, uint objectSize);
     virtual ~TypeAllocator();
@@ -100,11 +148,32 @@ public:
     static bool         IsGarbageCollected(void *ptr);
     static bool         IsAllocated(void *ptr);
     static void *       InUse(void *ptr);
+    static bool         IsInUse(void *ptr);
     static void         UpdateInUseRange(Chunk_vp chunk);
     static void         ScheduleDelete(Chunk_vp);
     bool                CheckLeakedPointers();
+    void                StartScan();
+    bool                ContinueScan(ulonglong deadline);
     bool                Sweep();
     void                ResetStatistics();
+    bool                ListObjects(Objects &objects, uint &chunk,
+                                    ulonglong deadline = 0);
+    uint                Trim(uint keep);
+
+    Magazine &          ThreadMagazine();
+    void                Refill(Magazine &magazine);
+    void                Flush(Magazine &magazine, uint keep);
+    void                ReportCounters(Magazine &magazine);
+    uint                Carve(char *&next, char *end, Magazine &magazine);
+    void                AddChunk(GCRegion *region = NULL);
+    void *              AllocateArena(uint region = 0);
+    static void         FreeArena(void *arena);
+    static void         ReserveArenas();
+    static TypeAllocator *ArenaOwner(void *ptr);
+    void                Sample(Chunk_vp chunk, void *caller);
+    void                Unsample(Chunk_vp chunk);
+    void                Lock()          { while (!locked.SetQ(0, 1)) {} }
+    void                Unlock()        { locked.SetQ(1, 0); }
 
     void *operator new(size_t size);
     void operator delete(void *ptr);
@@ -115,7 +184,16 @@ public:
         PTR_MASK        = 15,           // Special bits we take out of the ptr
         CHUNKALIGN_MASK = 7,            // Alignment for chunks
         ALLOCATED       = 0,            // Just allocated
-        IN_USE          = 1             // Set if already marked this time
+        IN_USE          = 1,            // Set if already marked this time
+        SAMPLED         = 2             // Recorded by allocation profiler
+    };
+    enum
+    {
+        MAGAZINE_SIZE   = 64,           // Items moved to/from a thread at once
+        ARENA_BITS      = 16,           // Chunks are aligned 64K arenas
+        ARENA_SIZE      = 1 << ARENA_BITS,
+        ARENA_ALIGN     = 2 << 20,      // Reserved space aligned for huge pages
+        RELEASED_REGION = ~0U           // Region of arenas freed when empty
     };
 
 public:
@@ -124,6 +202,7 @@ public:
         virtual void BeginCollection()          {}
         virtual bool CanDelete(void *)          { return true; }
         virtual void EndCollection()            {}
+        virtual void MemoryPressure()           {}
     };
     typedef std::set<Listener *> Listeners;
     void AddListener(Listener *l) { listeners.insert(l); }
@@ -132,6 +211,7 @@ public:
 protected:
     GarbageCollector *  gc;
     kstring             name;
+    uint                index;
     Atomic<uint>        locked;
     Atomic<uintptr_t>   lowestInUse;
     Atomic<uintptr_t>   highestInUse;
@@ -142,23 +222,53 @@ protected:
     Atomic<uint>        available;
     Atomic<uint>        freedCount;
 
+    char *              freshBase;      // Newest chunk, items carved lazily
+    char *              freshNext;      // Next item never used yet
+    char *              freshEnd;       // End of the newest chunk
+
+    char *              scanLow;        // Range scanned by current collection
+    char *              scanHigh;
+    uint                scanChunk;      // Where to resume scanning
+    char *              scanNext;
+    uint                scanCollected;  // Items collected in current scan
+
     uint                chunkSize;
     uint                objectSize;
     uint                alignedSize;
     uint                allocatedCount;
     uint                scannedCount;
     uint                collectedCount;
+    uint                releasedCount;
     uint                totalCount;
+    uint                regionChunks;   // Chunks in released regions
 
     friend void ::debuggc(void *ptr);
     friend struct GarbageCollector;
+    friend struct GCRegion;
 
 public:
-    static void *       lowestAddress;
-    static void *       highestAddress;
-    static void *       lowestAllocatorAddress;
-    static void *       highestAllocatorAddress;
+    static char *       arenaBase;      // Address space reserved for arenas
+    static uintptr_t    arenaSpan;      // Size of the reserved space
+    static TypeAllocator **arenaOwner;  // Allocator owning each arena
+    static uint *       arenaRegion;    // Region each arena belongs to
+    static uint         arenaCount;     // Arenas used so far
+    static uint         regionCount;    // Regions created so far
+    static Atomic<uint> arenaLock;
     static Atomic<uint> finalizing;
+    static std::atomic<bool> multiThreaded;
+    static Atomic<uint> threads;
+
+    static bool         IsMultiThreaded()
+    {
+        return multiThreaded.load(std::memory_order_acquire);
+    }
+
+    // Allocation profiler
+    static uint         profileRate;    // Sample one allocation every N
+    static ulong        profilePosition;// Position currently evaluated
+    static Atomic<uint> profileLock;
+    static Profile      profile;
+    static Sampled      sampled;
 } __attribute__((aligned(16)));
 
 
@@ -209,6 +319,10 @@ struct GCPtr
     GCPtr(Object &ptr): pointer(&ptr)           { TA::Acquire(pointer); }
     GCPtr(const GCPtr &ptr)
         : pointer(ptr.Pointer())                { TA::Acquire(pointer); }
+#if __cplusplus >= 201103L
+    GCPtr(GCPtr &&ptr)
+        : pointer(ptr.pointer)                  { ptr.pointer = 0; }
+#endif
     template<class U, typename V>
     GCPtr(const GCPtr<U,V> &p)
         : pointer((U*) p.Pointer())             { TA::Acquire(pointer); }
@@ -241,6 +355,18 @@ struct GCPtr
     // e.g. if we update a same Tree child from two different threads.
     GCPtr& Assign(Object *oldVal, Object *newVal)
     {
+        if (!TA::IsMultiThreaded())
+        {
+            // Only one thread uses the runtime, no need for a CAS
+            oldVal = pointer;
+            if (newVal != oldVal)
+            {
+                pointer = newVal;
+                TA::Acquire(newVal);
+                TA::Release(oldVal);
+            }
+            return *this;
+        }
         while (!Atomic<Object *>::SetQ(pointer, oldVal, newVal))
             oldVal = pointer;
         if (newVal != oldVal)
@@ -255,6 +381,27 @@ struct GCPtr
     {
         return Assign(pointer, (Object *) o.ConstPointer());
     }
+
+#if __cplusplus >= 201103L
+    GCPtr &operator= (GCPtr &&o)
+    {
+        // Moving to ourselves must keep the reference we hold
+        if (&o == this)
+            return *this;
+
+        // Take over the reference held by 'o', drop the one we held
+        Object *newVal = o.pointer;
+        Object *oldVal = pointer;
+        o.pointer = 0;
+        if (TA::IsMultiThreaded())
+            while (!Atomic<Object *>::SetQ(pointer, oldVal, newVal))
+                oldVal = pointer;
+        else
+            pointer = newVal;
+        TA::Release(oldVal);
+        return *this;
+    }
+#endif
             
     template<class U, typename V>
     GCPtr& operator=(const GCPtr<U,V> &o)
@@ -303,6 +450,10 @@ struct GarbageCollector
     static void                 MustRun()       { gc->mustRun |= 1U; }
     static bool                 Running()       { return gc->running; }
     static bool                 SafePoint();
+    static void                 SetBudget(uint us) { gc->budget = us; }
+    static uint                 Budget()        { return gc->budget; }
+    static void                 MemoryPressure();
+    static void                 MultiThreaded();
     static bool                 Sweep();
     
     void                        Statistics(uint &totalBytes,
@@ -312,11 +463,22 @@ struct GarbageCollector
                                            uint &scannedBytes,
                                            uint &collectedBytes);
     void                        PrintStatistics();
+    typedef text              (*PositionName)(ulong position);
+    void                        PrintProfile(PositionName positionName);
+    static void                 SetProfileRate(uint rate);
+    static void                 ProfilePosition(ulong position);
     void                        Register(TypeAllocator *a);
+    void                        ReportThreadCounters();
+    static void                 FlushThreadMagazines(void *magazines = NULL);
+    static ulonglong            Microseconds();
 
 private:
     // Collection happens at SafePoint, you can't trigger it manually.
-    bool                        Collect();
+    bool                        Collect(uint budget = 0);
+    void                        StartPass();
+    void                        Trim(bool aggressive);
+    enum Notification { BEGIN_COLLECTION, END_COLLECTION, MEMORY_PRESSURE };
+    void                        NotifyListeners(Notification what);
 
 private:
     typedef std::vector<TypeAllocator *> Allocators;
@@ -327,8 +489,59 @@ private:
     Allocators                  allocators;
     Atomic<uint>                mustRun;
     Atomic<uint>                running;
+    Atomic<uint>                pressure;       // Trim aggressively
+    uint                        budget;         // Microseconds per step
+    uint                        scanIndex;      // Allocator being scanned
+    bool                        inCycle;        // Collection in progress
 
     friend void ::debuggc(void *ptr);
+    friend struct TypeAllocator;
+    friend struct GCRegion;
+};
+
+
+
+// ****************************************************************************
+//
+//    Regions - Objects allocated together, e.g. the tree for a source file
+//
+// ****************************************************************************
+
+struct GCRegion
+// ----------------------------------------------------------------------------
+//    Allocate objects in arenas reserved for them while the region exists
+// ----------------------------------------------------------------------------
+//    While a region object exists, objects allocated by the current thread
+//    come from arenas that only this region uses, in allocation order.
+//    When it is destroyed, the remaining items become ordinary free items.
+//    The region identifier outlives the object. Once it is released,
+//    the region's arenas are given back to the system as soon as they
+//    no longer contain any live object, instead of being kept in reserve.
+{
+    GCRegion();
+    ~GCRegion();
+
+    uint                        Id()            { return id; }
+    static void                 Release(uint id);
+
+private:
+    struct Nursery
+    {
+        Nursery(): next(NULL), end(NULL), shared(0) {}
+        char *          next;           // Next item to bump-allocate
+        char *          end;            // End of the current region arena
+        uint            shared;         // Items taken from shared chunks
+    };
+    typedef std::vector<Nursery>        Nurseries;
+
+    uint                        id;
+    TypeAllocator::Magazines    magazines;      // Items used in this region
+    TypeAllocator::Magazines *  saved;          // Magazines of the thread
+    GCRegion *                  previous;       // Enclosing region if any
+    Nurseries                   nurseries;      // One per allocator
+
+    friend struct TypeAllocator;
+    friend struct GarbageCollector;
 };
 
 
@@ -388,8 +601,21 @@ inline bool TypeAllocator::IsGarbageCollected(void *ptr)
 // ----------------------------------------------------------------------------
 //   Tell if a pointer is managed by the garbage collector
 // ----------------------------------------------------------------------------
+//   All arenas are in the reserved space, and nothing else can be there
 {
-    return ptr >= lowestAddress && ptr <= highestAddress;
+    return (uintptr_t) ptr - (uintptr_t) arenaBase < arenaSpan;
+}
+
+
+inline TypeAllocator *TypeAllocator::ArenaOwner(void *ptr)
+// ----------------------------------------------------------------------------
+//   Return the allocator owning the arena containing ptr, or NULL
+// ----------------------------------------------------------------------------
+{
+    uintptr_t offset = (uintptr_t) ptr - (uintptr_t) arenaBase;
+    if (offset >= arenaSpan)
+        return NULL;
+    return arenaOwner[offset >> ARENA_BITS];
 }
 
 
@@ -398,16 +624,15 @@ inline bool TypeAllocator::IsAllocated(void *ptr)
 //   Tell if a pointer is allocated by the garbage collector (not free)
 // ----------------------------------------------------------------------------
 {
-    if (IsGarbageCollected(ptr))
+    if (TypeAllocator *owner = ArenaOwner(ptr))
     {
         if ((uintptr_t) ptr & CHUNKALIGN_MASK)
             return false;
+        if (((uintptr_t) ptr & (ARENA_SIZE-1)) < sizeof(Chunk))
+            return false;
 
         Chunk_vp chunk = (Chunk_vp) ptr - 1;
-        TypeAllocator *alloc = AllocatorPointer(chunk->allocator);
-        if (alloc >= lowestAllocatorAddress && alloc <= highestAllocatorAddress)
-            if (alloc->gc == GarbageCollector::GC())
-                return true;
+        return AllocatorPointer(chunk->allocator) == owner;
     }
     return false;
 }
@@ -423,8 +648,16 @@ inline void TypeAllocator::Acquire(void *pointer)
         ELFE_ASSERT (((intptr_t) pointer & CHUNKALIGN_MASK) == 0);
         ELFE_ASSERT (IsAllocated(pointer));
 
-        Chunk_vp chunk = ((Chunk_vp) pointer) - 1;
-        ++chunk->count;
+        if (IsMultiThreaded())
+        {
+            Chunk_vp chunk = ((Chunk_vp) pointer) - 1;
+            Atomic<uint>::Add(chunk->count, 1);
+        }
+        else
+        {
+            Chunk *chunk = ((Chunk *) pointer) - 1;
+            ++chunk->count;
+        }
     }
 }
 
@@ -441,7 +674,11 @@ inline void TypeAllocator::Release(void *pointer)
 
         Chunk_vp chunk = ((Chunk_vp) pointer) - 1;
         ELFE_ASSERT(chunk->count);
-        uint count = --chunk->count;
+        uint count;
+        if (IsMultiThreaded())
+            count = Atomic<uint>::Sub(chunk->count, 1) - 1;
+        else
+            count = --((Chunk *) chunk)->count;
         if (!count)
             ScheduleDelete(chunk);
     }
@@ -472,7 +709,16 @@ inline void *TypeAllocator::InUse(void *pointer)
     {
         ELFE_ASSERT (((intptr_t) pointer & CHUNKALIGN_MASK) == 0);
         Chunk_vp chunk = ((Chunk_vp) pointer) - 1;
-        uint bits = Atomic<uintptr_t>::Or(chunk->bits, IN_USE);
+        uintptr_t bits;
+        if (IsMultiThreaded())
+        {
+            bits = Atomic<uintptr_t>::Or(chunk->bits, IN_USE);
+        }
+        else
+        {
+            bits = chunk->bits;
+            chunk->bits = bits | IN_USE;
+        }
         if (!chunk->count && (~bits & IN_USE))
             UpdateInUseRange(chunk);
     }
@@ -480,14 +726,29 @@ inline void *TypeAllocator::InUse(void *pointer)
 }
 
 
+inline bool TypeAllocator::IsInUse(void *pointer)
+// ----------------------------------------------------------------------------
+//   Check if a pointer was marked as in use since it was last scanned
+// ----------------------------------------------------------------------------
+{
+    if (IsGarbageCollected(pointer))
+    {
+        Chunk_vp chunk = ((Chunk_vp) pointer) - 1;
+        return chunk->bits & IN_USE;
+    }
+    return false;
+}
+
+
 inline void TypeAllocator::UpdateInUseRange(Chunk_vp chunk)
 // ----------------------------------------------------------------------------
 //    Update the range of in-use pointers when in-use bit is set
 // ----------------------------------------------------------------------------
+//    The range is recorded in the magazine of the current thread, and
+//    reported to the allocator with the other counters of the magazine
 {
     TypeAllocator *allocator = ValidPointer(chunk->allocator);
-    allocator->lowestInUse.Minimize((uintptr_t) chunk);
-    allocator->highestInUse.Maximize((uintptr_t) (chunk + 1));
+    allocator->ThreadMagazine().InUse(chunk);
 }
 
 
@@ -576,17 +837,7 @@ bool Allocator<Object>::IsAllocated(void *ptr)
 //   Tell if a pointer is allocated in this particular pool
 // ----------------------------------------------------------------------------
 {
-    if (IsGarbageCollected(ptr))
-    {
-        if ((uintptr_t) ptr & CHUNKALIGN_MASK)
-            return false;
-
-        Chunk_vp chunk = (Chunk_vp) ptr - 1;
-        TypeAllocator *alloc = AllocatorPointer(chunk->allocator);
-        if (alloc == allocator)
-            return true;
-    }
-    return false;
+    return ArenaOwner(ptr) == allocator && TypeAllocator::IsAllocated(ptr);
 }
 
 
@@ -605,12 +856,50 @@ inline bool GarbageCollector::SafePoint()
 //    allocation "in flight", i.e. not recorded using a root pointer
 //    This looks for pointers that were allocated since the last
 //    safe point and not assigned to any GCPtr yet.
+//    If a time budget is set, each safe point only runs part of the
+//    collection, and the next one resumes where it stopped.
 {
     if (gc->mustRun)
-        return gc->Collect();
+        return gc->Collect(gc->budget);
     return false;
 }
 
+
+inline void GarbageCollector::MultiThreaded()
+// ----------------------------------------------------------------------------
+//    Switch reference counting to atomic operations
+// ----------------------------------------------------------------------------
+//    Call this before starting the first thread that uses the runtime.
+//    Switching while another thread runs could lose plain increments that
+//    are in flight, so this asserts that only the caller ever allocated.
+{
+    ELFE_ASSERT(TypeAllocator::threads <= 1 &&
+                "Must switch to atomics before starting threads");
+    TypeAllocator::multiThreaded.store(true, std::memory_order_release);
+}
+
+
+inline void GarbageCollector::ProfilePosition(ulong position)
+// ----------------------------------------------------------------------------
+//    Record the source position being evaluated for allocation profiling
+// ----------------------------------------------------------------------------
+{
+    if (TypeAllocator::profileRate && position != ~0UL)
+        TypeAllocator::profilePosition = position;
+}
+
+
+inline void GarbageCollector::MemoryPressure()
+// ----------------------------------------------------------------------------
+//    Request a collection that gives as much memory as possible back
+// ----------------------------------------------------------------------------
+//    This only sets flags, so it can be called from a signal handler or
+//    from another thread. The work is done at the next safe point.
+{
+    gc->pressure |= 1U;
+    gc->MustRun();
+}
+
 ELFE_END
 
 #endif // GC_H
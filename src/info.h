@@ -51,11 +51,27 @@ struct Info
 // ----------------------------------------------------------------------------
 //   Information associated with a tree
 // ----------------------------------------------------------------------------
+//   The kinds of information checked in the interpreter loop each have a
+//   slot in the InfoSlots of a tree. All info is also kept in a list.
 {
+public:
+    enum Slot
+    {
+        CODE_SLOT,                      // Bytecode for the tree
+        OPCODE_SLOT,                    // Builtin opcode
+        TYPECHECK_SLOT,                 // Builtin type check
+        CLOSURE_SLOT,                   // Closure marker
+        OTHER_SLOT,                     // List of all info, owns it
+        SLOT_COUNT
+    };
+    enum { SLOT = OTHER_SLOT };         // Where GetInfo looks for this class
+    typedef Info        slot_t;         // Class declaring that slot
+
 public:    
                         Info()                  : next(NULL) {}
     virtual             ~Info()                 {}
     virtual void        Delete()                { delete this; }
+    virtual uint        Slots()                 { return 0; }
 
 public:
     friend struct Tree;
@@ -69,6 +85,84 @@ private:
                         Info(const Info &)      : next(NULL) {}
 };
 
+
+#define INFO_SLOT(type, slot)                                           \
+/* ------------------------------------------------------------ */      \
+/*  Declare that a kind of info has a slot of its own           */      \
+/* ------------------------------------------------------------ */      \
+    enum { SLOT = Info::slot };                                         \
+    typedef type slot_t;                                                \
+    virtual uint Slots()        { return 1U << Info::slot; }
+
+
+template <class I, class S>
+struct InfoCast
+// ----------------------------------------------------------------------------
+//   Check if the info found in a slot has the requested type
+// ----------------------------------------------------------------------------
+{
+    static I *Cast(Info *i)     { return dynamic_cast<I *> (i); }
+};
+
+
+template <class I>
+struct InfoCast<I, I>
+// ----------------------------------------------------------------------------
+//   When looking for the class that declared the slot, no check is needed
+// ----------------------------------------------------------------------------
+{
+    static I *Cast(Info *i)     { return static_cast<I *> (i); }
+};
+
+
+struct InfoSlots
+// ----------------------------------------------------------------------------
+//   The information attached to a tree
+// ----------------------------------------------------------------------------
+//   A tree only gets that structure when some information is attached.
+//   All the info is in the list, which owns it. Each slot is a shortcut
+//   to the most recent info for that slot in the list, so that an info
+//   covering several slots is owned once, and an older info comes back
+//   in a slot when the newer one is removed.
+{
+                        InfoSlots();
+                        ~InfoSlots();
+
+    template<class I>   I *     Find();
+    void                        Insert(Info *info);
+    bool                        Unlink(Info *info);
+
+private:
+    bool                        UnlinkOther(Info *info);
+
+public:
+    Atomic<Info *>              slots[Info::SLOT_COUNT];
+};
+
+
+template <class I> inline I *InfoSlots::Find()
+// ----------------------------------------------------------------------------
+//   Find the most recent information of the given type
+// ----------------------------------------------------------------------------
+//   An empty slot means that there is no info of that kind. If the slot
+//   holds another class than requested, e.g. Code when looking for a
+//   Function, an older info of the right class may be in the list.
+{
+    Info *i = slots[I::SLOT];
+    if ((uint) I::SLOT != (uint) Info::OTHER_SLOT)
+    {
+        if (I *ic = InfoCast<I, typename I::slot_t>::Cast(i))
+            return ic;
+        if (!i)
+            return NULL;
+        i = slots[Info::OTHER_SLOT];
+    }
+    for (; i; i = i->next)
+        if (I *ic = dynamic_cast<I *> (i))
+            return ic;
+    return NULL;
+}
+
 ELFE_END
 
 #endif // INFO_H
@@ -0,0 +1,208 @@
+// ****************************************************************************
+//  interned.cpp                                                  ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Table of interned text values
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "interned.h"
+#include "atomic.h"
+
+#include <vector>
+
+
+ELFE_BEGIN
+
+struct InternEntry : text
+// ----------------------------------------------------------------------------
+//   An interned value, with its hash and the number of itext using it
+// ----------------------------------------------------------------------------
+{
+    InternEntry(kstring t, size_t length, uint hash)
+        : text(t, length), hash(hash), refs(1) {}
+    uint                hash;
+    mutable Atomic<uint> refs;
+};
+
+typedef std::vector<InternEntry *> InternTable;
+
+struct InternShard
+// ----------------------------------------------------------------------------
+//   One part of the interned values, with its own lock
+// ----------------------------------------------------------------------------
+//   Values are spread across shards by the high bits of their hash, so that
+//   threads creating or releasing different names rarely wait on each other
+{
+    InternShard(): lock(0), count(0), table(16, (InternEntry *) NULL) {}
+    Atomic<uint>        lock;
+    uint                count;
+    InternTable         table;  // Open addressing, size is a power of 2
+
+    void                Lock()          { while (!lock.SetQ(0, 1)) {} }
+    void                Unlock()        { lock.SetQ(1, 0); }
+};
+
+enum { INTERN_SHARD_BITS = 6 };
+
+
+static InternShard &internShard(uint hash)
+// ----------------------------------------------------------------------------
+//   Return the shard holding values with the given hash
+// ----------------------------------------------------------------------------
+//   Trees may be created by static initializers, so create them on first use
+{
+    static InternShard shards[1 << INTERN_SHARD_BITS];
+    return shards[hash >> (32 - INTERN_SHARD_BITS)];
+}
+
+
+static inline uint internHash(kstring t, size_t length)
+// ----------------------------------------------------------------------------
+//   FNV-1a hash of the text
+// ----------------------------------------------------------------------------
+{
+    uint hash = 2166136261U;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (byte) t[i]) * 16777619U;
+    return hash;
+}
+
+
+const text *itext::Intern(kstring t, size_t length)
+// ----------------------------------------------------------------------------
+//   Return the unique copy of the given text, creating it if needed
+// ----------------------------------------------------------------------------
+{
+    uint hash = internHash(t, length);
+    InternShard &shard = internShard(hash);
+    shard.Lock();
+
+    InternTable &interned = shard.table;
+    uint mask = interned.size() - 1;
+    uint index = hash & mask;
+    while (InternEntry *found = interned[index])
+    {
+        if (found->hash == hash && found->length() == length &&
+            found->compare(0, length, t, length) == 0)
+        {
+            found->refs++;
+            shard.Unlock();
+            return found;
+        }
+        index = (index + 1) & mask;
+    }
+
+    InternEntry *result = new InternEntry(t, length, hash);
+    interned[index] = result;
+
+    // Keep the table at most half full
+    if (2 * ++shard.count > mask)
+    {
+        InternTable larger(2 * (mask + 1), (InternEntry *) NULL);
+        uint largerMask = larger.size() - 1;
+        for (uint i = 0; i <= mask; i++)
+        {
+            if (InternEntry *entry = interned[i])
+            {
+                uint e = entry->hash;
+                while (larger[e & largerMask])
+                    e++;
+                larger[e & largerMask] = entry;
+            }
+        }
+        interned.swap(larger);
+    }
+
+    shard.Unlock();
+    return result;
+}
+
+
+void itext::Acquire(const text *value)
+// ----------------------------------------------------------------------------
+//   Record one more itext using the value
+// ----------------------------------------------------------------------------
+{
+    static_cast<const InternEntry *> (value)->refs++;
+}
+
+
+void itext::Release(const text *value)
+// ----------------------------------------------------------------------------
+//   Record one less itext using the value, free it with the last one
+// ----------------------------------------------------------------------------
+//   The last reference is dropped while holding the shard lock, so that
+//   Intern cannot find the entry again while we remove it from the table.
+{
+    const InternEntry *entry = static_cast<const InternEntry *> (value);
+    for (;;)
+    {
+        uint refs = entry->refs;
+        if (refs <= 1)
+            break;
+        if (entry->refs.SetQ(refs, refs - 1))
+            return;
+    }
+
+    InternShard &shard = internShard(entry->hash);
+    shard.Lock();
+    if (--entry->refs)
+    {
+        shard.Unlock();
+        return;
+    }
+
+    // Remove the entry, and move back the entries that probed past it
+    InternTable &interned = shard.table;
+    uint mask = interned.size() - 1;
+    uint hole = entry->hash & mask;
+    while (interned[hole] != entry)
+        hole = (hole + 1) & mask;
+    interned[hole] = NULL;
+    for (uint i = (hole + 1) & mask; interned[i]; i = (i + 1) & mask)
+    {
+        uint home = interned[i]->hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            interned[hole] = interned[i];
+            interned[i] = NULL;
+            hole = i;
+        }
+    }
+    shard.count--;
+    shard.Unlock();
+
+    delete entry;
+}
+
+ELFE_END
@@ -0,0 +1,109 @@
+#ifndef INTERNED_H
+#define INTERNED_H
+// ****************************************************************************
+//  interned.h                                                    ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Interned text, used for delimiters and operator names in trees
+//
+//     There are only a few distinct delimiters and operators, so each
+//     distinct value is stored once, and trees only keep a pointer to it.
+//     Interned values are reference counted, and freed with the last itext.
+//
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "base.h"
+#include <iostream>
+#include <string.h>
+
+ELFE_BEGIN
+
+struct itext
+// ----------------------------------------------------------------------------
+//   A text value shared by all the trees that use it
+// ----------------------------------------------------------------------------
+{
+    itext(): value(Intern("", 0))                       {}
+    itext(const text &t): value(Intern(t.data(), t.length())) {}
+    itext(kstring t): value(Intern(t, strlen(t)))       {}
+    itext(const itext &o): value(o.value)               { Acquire(value); }
+    ~itext()                                            { Release(value); }
+
+    itext &operator=(const itext &o)
+    {
+        const text *old = value;
+        Acquire(o.value);
+        value = o.value;
+        Release(old);
+        return *this;
+    }
+    operator const text &() const       { return *value; }
+    const text &        str() const     { return *value; }
+    kstring             c_str() const   { return value->c_str(); }
+    size_t              length() const  { return value->length(); }
+    char operator[](size_t i) const     { return (*value)[i]; }
+
+    bool operator==(const itext &o) const { return value == o.value; }
+    bool operator!=(const itext &o) const { return value != o.value; }
+    bool operator<(const itext &o) const  { return *value <  *o.value; }
+    bool operator>(const itext &o) const  { return *value >  *o.value; }
+    bool operator<=(const itext &o) const { return *value <= *o.value; }
+    bool operator>=(const itext &o) const { return *value >= *o.value; }
+
+    static const text * Intern(kstring t, size_t length);
+    static void         Acquire(const text *value);
+    static void         Release(const text *value);
+
+private:
+    const text *        value;
+};
+
+
+// Comparisons and concatenation with regular text
+inline bool operator==(const itext &a, const text &b)   { return a.str()==b; }
+inline bool operator==(const text &a, const itext &b)   { return a==b.str(); }
+inline bool operator==(const itext &a, kstring b)       { return a.str()==b; }
+inline bool operator==(kstring a, const itext &b)       { return a==b.str(); }
+inline bool operator!=(const itext &a, const text &b)   { return a.str()!=b; }
+inline bool operator!=(const text &a, const itext &b)   { return a!=b.str(); }
+inline bool operator!=(const itext &a, kstring b)       { return a.str()!=b; }
+inline bool operator!=(kstring a, const itext &b)       { return a!=b.str(); }
+inline text operator+(const itext &a, const text &b)    { return a.str()+b; }
+inline text operator+(const text &a, const itext &b)    { return a+b.str(); }
+inline text operator+(const itext &a, kstring b)        { return a.str()+b; }
+inline text operator+(kstring a, const itext &b)        { return a+b.str(); }
+inline text operator+(const itext &a, const itext &b)   { return a.str()+b.str(); }
+
+inline std::ostream &operator<<(std::ostream &out, const itext &t)
+{
+    return out << t.str();
+}
+
+ELFE_END
+
+#endif // INTERNED_H
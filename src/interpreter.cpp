@@ -111,6 +111,7 @@ struct Bindings
     bool  DoPostfix(Postfix *what);
     bool  DoInfix(Infix *what);
     bool  DoBlock(Block *what);
+    bool  DoArray(Array *what);
 
     // Evaluation and binding of values
     void  MustEvaluate(bool updateContext = false);
@@ -165,13 +166,27 @@ inline bool Bindings::DoText(Text *what)
 {
     MustEvaluate();
     if (Text *tval = test->AsText())
-        if (tval->value == what->value)         // Do delimiters matter?
+        if (tval->Value() == what->Value())     // Do delimiters matter?
             return true;
     Ooops("Text $1 does not match $2", what, test);
     return false;
 }
 
 
+inline bool Bindings::DoArray(Array *what)
+// ----------------------------------------------------------------------------
+//   The pattern contains an array: check we have an equal one
+// ----------------------------------------------------------------------------
+{
+    MustEvaluate();
+    if (Array *aval = test->AsArray())
+        if (Tree::Equal(aval, what))
+            return true;
+    Ooops("Array $1 does not match $2", what, test);
+    return false;
+}
+
+
 inline bool Bindings::DoName(Name *what)
 // ----------------------------------------------------------------------------
 //   The pattern contains a name: bind it as a closure, no evaluation
@@ -314,7 +329,7 @@ bool Bindings::DoInfix(Infix *what)
     Save<Context_p> saveContext(context, context);
 
     // Check if we have typed arguments, e.g. X:integer
-    if (what->name == ":")
+    if (what->name == Infix::colon)
     {
         Name *name = what->left->AsName();
         if (!name)
@@ -343,7 +358,7 @@ bool Bindings::DoInfix(Infix *what)
     }
 
     // Check if we have typed declarations, e.g. X+Y as integer
-    if (what->name == "as")
+    if (what->name == Infix::as)
     {
         if (resultType)
         {
@@ -355,7 +370,7 @@ bool Bindings::DoInfix(Infix *what)
     }
 
     // Check if we have a guard clause
-    if (what->name == "when")
+    if (what->name == Infix::when)
     {
         // It must pass the rest (need to bind values first)
         if (!what->left->Do(this))
@@ -385,7 +400,7 @@ bool Bindings::DoInfix(Infix *what)
         if (ifx->name != what->name)
         {
             Ooops("Infix names $1 and $2 don't match", what->Position())
-                .Arg(ifx->name).Arg(what->name);
+                .Arg(ifx->name.str()).Arg(what->name.str());
             return false;
         }
 
@@ -630,6 +645,9 @@ static Tree *Instructions(Context_p context, Tree_p what)
     // Loop to avoid recursion for a few common cases, e.g. sequences, blocks
     while (what)
     {
+        // Tell the allocation profiler where we are
+        GarbageCollector::ProfilePosition(what->Position());
+
         // First attempt to look things up
         EvalCache cache;
         if (Tree *eval = context->Lookup(what, evalLookup, &cache))
@@ -652,6 +670,7 @@ static Tree *Instructions(Context_p context, Tree_p what)
         case INTEGER:
         case REAL:
         case TEXT:
+        case ARRAY:
             return what;
 
         case NAME:
@@ -704,7 +723,7 @@ static Tree *Instructions(Context_p context, Tree_p what)
             if (Infix *lifx = callee->AsInfix())
             {
                 // Check if we have a function definition
-                if (lifx->name == "->")
+                if (lifx->name == Infix::rewrite)
                 {
                     // If we have a single name on the left, like (X->X+1)
                     // interpret that as a lambda function
@@ -745,7 +764,7 @@ static Tree *Instructions(Context_p context, Tree_p what)
                     what = arg;
                     // Check if we have a single definition on the left
                     if (Infix *ifx = inside->AsInfix())
-                        if (ifx->name == "->")
+                        if (ifx->name == Infix::rewrite)
                             what = new Prefix(newCallee, arg, pfx->Position());
                 }
                 else
@@ -771,10 +790,10 @@ static Tree *Instructions(Context_p context, Tree_p what)
         case INFIX:
         {
             Infix *infix = (Infix *) (Tree *) what;
-            text name = infix->name;
+            itext &name = infix->name;
 
             // Check sequences
-            if (name == ";" || name == "\n")
+            if (name == Infix::semicolon || name == Infix::newline)
             {
                 // Sequences: evaluate left, then right
                 Context *leftContext = context;
@@ -786,14 +805,14 @@ static Tree *Instructions(Context_p context, Tree_p what)
             }
 
             // Check declarations
-            if (name == "->")
+            if (name == Infix::rewrite)
             {
                 // Declarations evaluate last non-declaration result, or self
                 return encloseResult(context, originalScope, result);
             }
 
             // Check type matching
-            if (name == "as")
+            if (name == Infix::as)
             {
                 result = TypeCheck(context, infix->right, infix->left);
                 if (!result)
@@ -806,7 +825,7 @@ static Tree *Instructions(Context_p context, Tree_p what)
             }
 
             // Check scoped reference
-            if (name == ".")
+            if (name == Infix::dot)
             {
                 Tree *left = Instructions(context, infix->left);
                 IsClosure(left, &context);
@@ -872,6 +891,10 @@ struct Expansion
     {
         return what;
     }
+    Tree *  DoArray(Array *what)
+    {
+        return what;
+    }
     Tree *  DoName(Name *what)
     {
         if (Tree *bound = context->Bound(what))
@@ -901,7 +924,8 @@ struct Expansion
     }
     Tree *  DoInfix(Infix *what)
     {
-        if (what->name == ":" || what->name == "as" || what->name == "when")
+        if (what->name == Infix::colon || what->name == Infix::as ||
+            what->name == Infix::when)
             return what->left->Do(this);
         Tree *left  = what->left->Do(this);
         Tree *right = what->right->Do(this);
@@ -63,7 +63,9 @@ struct ClosureInfo : Info
 // ----------------------------------------------------------------------------
 //   Mark a given Prefix as a closure
 // ----------------------------------------------------------------------------
-{};
+{
+    INFO_SLOT(ClosureInfo, CLOSURE_SLOT);
+};
 
 
 inline Tree *IsClosure(Tree *tree, Context_p *context)
@@ -40,6 +40,8 @@
 
 #include "configuration.h"
 #include "tree-clone.h"
+#include "tree-cycles.h"
+#include "tree-share.h"
 #include "main.h"
 #include "scanner.h"
 #include "parser.h"
@@ -66,6 +68,9 @@
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <algorithm>
 #include <map>
 #include <iostream>
 #include <fstream>
@@ -94,7 +99,7 @@ SourceFile::SourceFile(text n, Tree *t, Context *ctx, bool ro)
 //   Construct a source file given a name
 // ----------------------------------------------------------------------------
     : name(n), tree(t), context(ctx),
-      modified(0), changed(false), readOnly(ro)
+      modified(0), changed(false), readOnly(ro), region(0)
 {
     utf8_filestat_t st;
     if (utf8_stat (n.c_str(), &st) < 0)
@@ -110,7 +115,7 @@ SourceFile::SourceFile()
 //   Default constructor
 // ----------------------------------------------------------------------------
     : name(""), tree(NULL), context(NULL),
-      modified(0), changed(false), readOnly(false)
+      modified(0), changed(false), readOnly(false), region(0)
 {}
 
 
@@ -122,6 +127,140 @@ SourceFile::~SourceFile()
 
 
 
+
+// ============================================================================
+//
+//     Files parsed ahead
+//
+// ============================================================================
+
+void ParsedFile::Parse(text name, Syntax &syntax)
+// ----------------------------------------------------------------------------
+//   Parse a file with positions and errors of its own
+// ----------------------------------------------------------------------------
+//   All nodes are allocated in the region, so a thread running this needs
+//   no magazines of its own. No other thread sees the tree before Attach,
+//   but the nodes it shares with other threads, like interned names,
+//   pooled integers or the syntax, need atomic reference counts.
+{
+    Positions positions;
+    errors = new Errors(&MAIN->topLevelErrors);
+
+    GCRegion region;
+    this->region = region.Id();
+    {
+        Parser parser(name.c_str(), syntax, positions, *errors);
+        tree = parser.Parse();
+    }
+    end = positions.CurrentPosition();
+}
+
+
+Tree *ParsedFile::Attach(text name, Positions &positions)
+// ----------------------------------------------------------------------------
+//   Move positions after those of the files already loaded, report errors
+// ----------------------------------------------------------------------------
+//   This gives the same positions and errors as parsing the file now
+{
+    ulong start = positions.OpenFile(name);
+    positions.CloseFile(start + end);
+    if (tree)
+        tree->ShiftPositions(start);
+
+    std::vector<Error>::iterator e;
+    for (e = errors->errors.begin(); e != errors->errors.end(); e++)
+        if ((long) (*e).position >= 0)
+            (*e).position += start;
+    delete errors;
+    errors = NULL;
+
+    return tree;
+}
+
+
+struct ParseAheadWork
+// ----------------------------------------------------------------------------
+//   The files that a pool of threads parses ahead
+// ----------------------------------------------------------------------------
+{
+    ParseAheadWork(Syntax &syntax)
+        : syntax(syntax), names(), files(), next(0) {}
+
+    Syntax &                    syntax;
+    source_names                names;
+    std::vector<ParsedFile *>   files;
+    Atomic<uint>                next;   // Index of the next file to parse
+};
+
+
+static void *parseAhead(void *data)
+// ----------------------------------------------------------------------------
+//   Thread parsing files until there are none left
+// ----------------------------------------------------------------------------
+{
+    ParseAheadWork *work = (ParseAheadWork *) data;
+    uint max = work->names.size();
+    for (uint i = work->next++; i < max; i = work->next++)
+        work->files[i]->Parse(work->names[i], work->syntax);
+    return NULL;
+}
+
+
+static bool caseInsensitiveEqual(char a, char b)
+// ----------------------------------------------------------------------------
+//   Compare characters ignoring case, e.g. for -nocase
+// ----------------------------------------------------------------------------
+{
+    return tolower((byte) a) == tolower((byte) b);
+}
+
+
+static bool mayChangeSyntax(text file)
+// ----------------------------------------------------------------------------
+//   Check if a file may contain a syntax statement
+// ----------------------------------------------------------------------------
+//   Such a statement changes how the files after it parse. A file is only
+//   parsed ahead if it does not contain the word at all, even in comments.
+//   Inputs that cannot be read twice, like pipes, are not parsed ahead.
+{
+    utf8_filestat_t st;
+    if (file == "-" || utf8_stat(file.c_str(), &st) < 0)
+        return true;
+    if (!S_ISREG(st.st_mode))
+        return true;
+
+    static const char keyword[] = "syntax";
+    const size_t length = sizeof(keyword) - 1;
+    ScannerInput input(file.c_str());
+    while (input.Remaining() >= length)
+    {
+        input.Skip(input.RunUntil('s', 'S'));
+        if (input.Remaining() < length)
+            break;
+        kstring word = input.Cursor();
+        if (std::equal(keyword, keyword + length, word, caseInsensitiveEqual))
+            return true;
+        input.Skip(1);
+    }
+    return false;
+}
+
+
+static uint processors()
+// ----------------------------------------------------------------------------
+//   Number of processors available, for the default number of threads
+// ----------------------------------------------------------------------------
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+        return count;
+#endif // _SC_NPROCESSORS_ONLN
+    return 1;
+}
+
+
+
 // ============================================================================
 //
 //     Main
@@ -144,7 +283,7 @@ Main::Main(int inArgc, char **inArgv, text compilerName,
 #endif // INTERPRETER_ONLY
       context(new Context),
       renderer(std::cout, styleSheetName, syntax),
-      reader(NULL), writer(NULL)
+      watcher(NULL), stream(NULL), reader(NULL), writer(NULL)
 {
     ELFE_INIT_TRACES();
     Options::options = &options;
@@ -177,6 +316,8 @@ Main::~Main()
         topLevelErrors.Clear();
     }
     
+    delete watcher;
+    delete stream;
     delete reader;
     delete writer;
 }
@@ -187,6 +328,9 @@ int Main::LoadAndRun()
 //   An single entry point for the normal phases
 // ----------------------------------------------------------------------------
 {
+    if (options.syntax_tables)
+        return Syntax::PrintTables(std::cout, file_names);
+
     int rc = LoadFiles();
     if (!rc && !options.parseOnly)
         rc = Run();
@@ -214,6 +358,16 @@ Errors *Main::InitMAIN()
 }
 
 
+text Main::PositionName(ulong position)
+// ----------------------------------------------------------------------------
+//   Return a source position as file:line, e.g. for profiling reports
+// ----------------------------------------------------------------------------
+{
+    Error error("", position);
+    return error.Position();
+}
+
+
 int Main::ParseOptions()
 // ----------------------------------------------------------------------------
 //   Load all files given on the command line and compile them
@@ -235,8 +389,27 @@ int Main::ParseOptions()
         file_names.push_back(cmd);
 
     // Load builtins before the rest (only after parsing options for builtins)
-    if (!options.builtins.empty())
+    if (!options.builtins.empty() && !options.syntax_tables)
         file_names.insert(file_names.begin(), options.builtins);
+
+    // Limit the duration of each garbage collection step if requested
+    GarbageCollector::SetBudget(options.gc_budget);
+
+    // Look for reference cycles between trees every few collections
+    CycleCollector::Install(options.gc_cycles);
+
+    // Share the nodes for small computed integers
+    if (options.gc_integers)
+        Integer::MakePool(-16, options.gc_integers);
+
+    // Share nodes between equal constants built at run time
+    SharedLeaves::SetLimit(options.gc_share);
+
+    // Concatenate large texts as ropes
+    Text::ropeLength = options.rope_length;
+
+    // Sample allocations to find where memory is allocated
+    GarbageCollector::SetProfileRate(options.gc_profile);
     
     return false;
 }
@@ -247,17 +420,98 @@ int Main::LoadFiles()
 //   Load all files given on the command line and compile them
 // ----------------------------------------------------------------------------
 {
-    source_names::iterator  file;
+    uint max = file_names.size();
     bool hadError = false;
 
+    // Watch the files to reload them if requested
+    if (options.reload && !options.packed && !options.crypted && !watcher)
+        watcher = new FileWatcher;
+
     // Loop over files we will process
-    for (file = file_names.begin(); file != file_names.end(); file++)
-        hadError |= LoadFile(*file);
+    for (uint first = 0; first < max; )
+    {
+        // Parse the files that follow ahead, until one changes the syntax
+        uint last = ParseAhead(first);
+        if (last == first)
+            last++;
+        for (; first < last; first++)
+            hadError |= LoadFile(file_names[first]);
+    }
 
     return hadError;
 }
 
 
+uint Main::ParseAhead(uint first)
+// ----------------------------------------------------------------------------
+//   Parse files on several threads before loading them in order
+// ----------------------------------------------------------------------------
+//   Returns the index of the first file that may change the syntax.
+//   Files before it that were not parsed ahead are parsed by LoadFile.
+{
+    uint max = file_names.size();
+    uint threads = options.parse_threads;
+    if (threads == 1 || options.packed || options.crypted)
+        return max;
+    if (!threads)
+        threads = processors();
+    if (threads < 2)
+        return max;
+
+    // Find the files that can be parsed with the current syntax
+    ParseAheadWork work(syntax);
+    uint last = first;
+    for (; last < max && !mayChangeSyntax(file_names[last]); last++)
+    {
+        text &name = file_names[last];
+        if (!parsed.count(name))
+        {
+            work.names.push_back(name);
+            work.files.push_back(&parsed[name]);
+        }
+    }
+
+    // Parsing a single file is faster without starting a thread
+    if (threads > work.names.size())
+        threads = work.names.size();
+    if (threads < 2)
+    {
+        for (uint i = 0; i < work.names.size(); i++)
+            parsed.erase(work.names[i]);
+        return last;
+    }
+
+    // The parser recurses on nested blocks, give threads a large stack
+    pthread_attr_t attributes;
+    size_t stack = 0;
+    pthread_attr_init(&attributes);
+    pthread_attr_getstacksize(&attributes, &stack);
+    if (stack < 8 << 20)
+        pthread_attr_setstacksize(&attributes, 8 << 20);
+
+    // Lookup tables must not be built lazily while threads share them
+    syntax.BuildTokenTables();
+
+    // Threads share the syntax, interned names and pooled integers
+    GarbageCollector::MultiThreaded();
+
+    // Parse in this thread as well, then wait for the others
+    std::vector<pthread_t> workers;
+    for (uint t = 1; t < threads; t++)
+    {
+        pthread_t worker;
+        if (pthread_create(&worker, &attributes, parseAhead, &work) == 0)
+            workers.push_back(worker);
+    }
+    pthread_attr_destroy(&attributes);
+    parseAhead(&work);
+    for (uint t = 0; t < workers.size(); t++)
+        pthread_join(workers[t], NULL);
+
+    return last;
+}
+
+
 int Main::LoadFile(text file, text modname)
 // ----------------------------------------------------------------------------
 //   Load an individual file
@@ -269,6 +523,7 @@ int Main::LoadFile(text file, text modname)
     Tree_p              tree     = NULL;
     utf8_ifstream       inputFile(file.c_str(), std::ios::in|std::ios::binary);
     std::stringstream   inputStream;
+    uint                regionId = 0;
 
 
     // See if we read from standard input
@@ -299,27 +554,60 @@ int Main::LoadFile(text file, text modname)
         input = &inputStream;
     }
 
-    // Check if we need to deserialize the input file first
-    if (options.packed)
+    // Allocate the nodes of the file together, in a region of their own
+    parsed_files::iterator ahead = parsed.find(file);
+    if (ahead != parsed.end())
     {
-        Deserializer deserializer(*input);
-        tree = deserializer.ReadTree();
-        if (deserializer.IsValid())
+        // The file was parsed ahead, possibly by another thread
+        regionId = (*ahead).second.region;
+        tree = (*ahead).second.Attach(file, positions);
+        parsed.erase(ahead);
+    }
+    else
+    {
+        GCRegion region;
+        regionId = region.Id();
+
+        // Check if we need to deserialize the input file first
+        if (options.packed)
         {
-            IFTRACE(fileload)
-                std::cerr << "Input was in serialized format\n";
+            Deserializer deserializer(*input);
+            tree = deserializer.ReadTree();
+            if (deserializer.IsValid())
+            {
+                IFTRACE(fileload)
+                    std::cerr << "Input was in serialized format\n";
+            }
         }
-    }
 
-    // Read in standard format if we could not read it from packed format
-    if (!tree)
-    {
-        // Set the name used for error messages
-        kstring errName = file.c_str();
-        if (file == "-")
-            errName = "<stdin>";
-        Parser parser (*input, syntax, positions, topLevelErrors, errName);
-        tree = parser.Parse();
+        // Read in standard format if we could not read it from packed format
+        if (!tree)
+        {
+            // Set the name used for error messages
+            // Files are scanned from memory, other inputs from a stream
+            kstring errName = file.c_str();
+            if (input == &inputFile)
+            {
+                Parser parser(errName, syntax, positions, topLevelErrors);
+                tree = parser.Parse();
+            }
+            else if (input == &std::cin && options.stream &&
+                     !options.pack && !stream)
+            {
+                // Parse the first statement now, the others in Run
+                stream = new Parser(*input, syntax, positions,
+                                    topLevelErrors, "<stdin>");
+                tree = stream->ParseStatement();
+            }
+            else
+            {
+                if (file == "-")
+                    errName = "<stdin>";
+                Parser parser(*input, syntax, positions, topLevelErrors,
+                              errName);
+                tree = parser.Parse();
+            }
+        }
     }
 
     // If at this stage we don't have a tree, this is an error
@@ -327,6 +615,7 @@ int Main::LoadFile(text file, text modname)
     {
         IFTRACE(fileload)
             std::cerr << "File load error for " << file << "\n";
+        GCRegion::Release(regionId);
         return false;
     }
 
@@ -393,8 +682,14 @@ int Main::LoadFile(text file, text modname)
         MAIN->context = ctx;
     }
 
-    // Register the source file we had
+    // Register the source file we had, release what a previous load used
+    GCRegion::Release(sf.region);
     sf = SourceFile (file, tree, ctx);
+    sf.region = regionId;
+
+    // Record what the rewrites were to compare when the file changes
+    if (watcher && watcher->Watch(file))
+        Context::DeclarationBodies(tree, sf.bodies);
 
     // Process declarations from the program
     IFTRACE(fileload)
@@ -405,6 +700,56 @@ int Main::LoadFile(text file, text modname)
 }
 
 
+bool Main::Reload(text file)
+// ----------------------------------------------------------------------------
+//   Parse a file again after it changed, and update its rewrites in place
+// ----------------------------------------------------------------------------
+//   Instructions in the file are not evaluated again, so that the state of
+//   the program, e.g. variables or sampling windows, is kept. If the new
+//   source has errors, they are shown and the previous rewrites are kept.
+{
+    source_files::iterator found = files.find(file);
+    if (found == files.end() || !(*found).second.context)
+        return false;
+    SourceFile &sf = (*found).second;
+
+    IFTRACE(fileload)
+        std::cerr << "Reloading " << file << "\n";
+
+    // Parse the new source in a region of its own
+    Tree_p tree = NULL;
+    uint   regionId = 0;
+    uint   errorCount = topLevelErrors.Count();
+    {
+        GCRegion region;
+        regionId = region.Id();
+        Parser parser(file.c_str(), syntax, positions, topLevelErrors);
+        tree = parser.Parse();
+    }
+    if (!tree || topLevelErrors.Count() != errorCount)
+    {
+        topLevelErrors.Display();
+        topLevelErrors.Clear();
+        GCRegion::Release(regionId);
+        return false;
+    }
+    tree = Normalize(tree);
+
+    // Update the rewrites in the context where the file was loaded
+    Context *context = sf.context;
+    uint changed = context->Update(sf.tree, sf.bodies, tree);
+    IFTRACE(fileload)
+        std::cerr << "Reloaded " << file << ", "
+                  << changed << " rewrites changed\n";
+
+    // Objects still used in the previous tree keep their arena
+    GCRegion::Release(sf.region);
+    sf.tree = tree;
+    sf.region = regionId;
+    return true;
+}
+
+
 int Main::Run()
 // ----------------------------------------------------------------------------
 //   Run all files given on the command line
@@ -425,9 +770,9 @@ int Main::Run()
         SourceFile &sf = files[*file];
 
         // Evaluate the given tree
-        Errors errors;
         if (Tree *tree = sf.tree)
         {
+            Errors errors;
             Context *context = sf.context;
             result = context->Evaluate(tree);
             if (errors.HadErrors())
@@ -437,6 +782,10 @@ int Main::Run()
             }
         }
 
+        // Evaluate the rest of a stream as statements come in
+        if (stream && *file == "-")
+            hadError |= RunStream(sf.context, result);
+
         if (!result)
         {
             hadError = true;
@@ -455,6 +804,48 @@ int Main::Run()
 }
 
 
+bool Main::RunStream(Context *context, Tree_p &result)
+// ----------------------------------------------------------------------------
+//   Evaluate the statements of the standard input as they are parsed
+// ----------------------------------------------------------------------------
+//   Statements are evaluated in the context of the input, so that they see
+//   the declarations of earlier statements, but not those of later ones.
+//   Output is flushed after each statement for programs reading from a pipe.
+{
+    bool hadError = false;
+    std::cout.flush();
+    while (Tree_p tree = stream->ParseStatement())
+    {
+        if (topLevelErrors.HadErrors())
+        {
+            topLevelErrors.Display();
+            topLevelErrors.Clear();
+            hadError = true;
+        }
+
+        Errors errors;
+        result = context->Evaluate(Normalize(tree));
+        if (errors.HadErrors())
+        {
+            errors.Display();
+            errors.Clear();
+        }
+        if (!result)
+            hadError = true;
+        std::cout.flush();
+    }
+
+    // Report errors in the last statement, e.g. at end of input
+    if (topLevelErrors.HadErrors())
+    {
+        topLevelErrors.Display();
+        topLevelErrors.Clear();
+        hadError = true;
+    }
+    return hadError;
+}
+
+
 
 // ============================================================================
 //
@@ -545,9 +936,18 @@ bool Main::Refresh(double delay)
 // ----------------------------------------------------------------------------
 //   Tell that the program won't execute again after the given delay
 // ----------------------------------------------------------------------------
+//   This is when we reload the files that changed, if we watch them
 {
     (void) delay;
-    return false;
+    FileWatcher::file_set changed;
+    if (!watcher || !watcher->Changed(changed))
+        return false;
+
+    bool reloaded = false;
+    FileWatcher::file_set::iterator file;
+    for (file = changed.begin(); file != changed.end(); file++)
+        reloaded |= Reload(*file);
+    return reloaded;
 }
 
 
@@ -598,8 +998,14 @@ int main(int argc, char **argv)
     ELFE::Main main(argc, argv);
     int rc = main.LoadAndRun();
 
+    if (main.options.gc_profile)
+        ELFE::GarbageCollector::GC()->PrintProfile(ELFE::Main::PositionName);
+
     IFTRACE(gcstats)
+    {
         ELFE::GarbageCollector::GC()->PrintStatistics();
+        ELFE::CycleCollector::Singleton()->PrintStatistics();
+    }
 
 #if CONFIG_USE_SBRK
     IFTRACE(memory)
@@ -49,6 +49,7 @@
 #include "context.h"
 #include "options.h"
 #include "info.h"
+#include "watcher.h"
 #include <map>
 #include <set>
 #include <time.h>
@@ -78,11 +79,32 @@ struct SourceFile
     text        hash;
     bool        changed;
     bool        readOnly;
+    uint        region;         // GC region holding the parsed tree
+    TreeList    bodies;         // Rewrite bodies as parsed, for reloading
 };
 typedef std::map<text, SourceFile> source_files;
 typedef std::vector<text> source_names;
 
 
+struct ParsedFile
+// ----------------------------------------------------------------------------
+//    A file parsed ahead of loading it, possibly in another thread
+// ----------------------------------------------------------------------------
+//    Positions start at 0 and errors are kept apart until the file is loaded
+{
+    ParsedFile(): tree(NULL), region(0), end(0), errors(NULL) {}
+
+    void        Parse(text name, Syntax &syntax);
+    Tree *      Attach(text name, Positions &positions);
+
+    Tree_p      tree;
+    uint        region;         // GC region holding the parsed tree
+    ulong       end;            // Position after the end of the file
+    Errors *    errors;         // Errors found while parsing
+};
+typedef std::map<text, ParsedFile> parsed_files;
+
+
 struct Main
 // ----------------------------------------------------------------------------
 //    The main entry point and associated data
@@ -102,12 +124,16 @@ struct Main
     Errors *     InitMAIN();
     int          ParseOptions();
     int          LoadFiles();
+    uint         ParseAhead(uint first);
     int          LoadFile(text file, text modname="");
+    bool         Reload(text file);
     int          Run();
+    bool         RunStream(Context *context, Tree_p &result);
 
     // Error checking
     void         Log(Error &e)   { errors->Log(e); }
     uint         HadErrors() { return errors->Count(); }
+    static text  PositionName(ulong position);
 
     // Hooks for use as a library in an application
     virtual text SearchFile(text input);
@@ -136,6 +162,9 @@ public:
     Renderer     renderer;
     source_files files;
     source_names file_names;
+    parsed_files parsed;
+    FileWatcher *watcher;
+    Parser *     stream;
     Deserializer *reader;
     Serializer   *writer;
 };
@@ -45,6 +45,7 @@
 #include "types.h"
 #include "runtime.h"
 #include "renderer.h"
+#include "tree-share.h"
 
 #ifndef INTERPRETER_ONLY
 #include "compiler.h"
@@ -131,6 +132,7 @@ void NameOpcode::Register(Context *context)
 
     context->Define(toDefine, toDefine);
     toDefine->SetInfo<Opcode> (this);
+    SharedLeaves::Enter(toDefine);
 
 #ifndef INTERPRETER_ONLY
     if (MAIN->options.optimize_level > 1)
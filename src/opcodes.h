@@ -97,6 +97,13 @@ typedef Block   Block_r;
 typedef Prefix  Prefix_r;
 typedef Postfix Postfix_r;
 typedef Infix   Infix_r;
+typedef Array   Array_r;
+
+// Value of a builtin argument, flattening texts that were built as ropes
+inline Integer::value_t &ArgValue(Integer &arg) { return arg.value; }
+inline Real::value_t    &ArgValue(Real &arg)    { return arg.value; }
+inline Text::value_t    &ArgValue(Text &arg)    { return arg.Value(); }
+inline Name::value_t    &ArgValue(Name &arg)    { return arg.value; }
 
 
 // ============================================================================
@@ -138,6 +145,7 @@ public:
     virtual Opcode *            Clone() = 0;
     virtual Op *                Run(Data data) = 0;
     virtual void                SetParms(ParmOrder &parms)  {}
+    INFO_SLOT(Opcode, OPCODE_SLOT);
 
 public:
     static void                 Enter(Context *context);
@@ -187,6 +195,14 @@ struct TypeCheckOpcode : NameOpcode
     {
         return what;
     }
+
+    // Found both as an opcode and as a type check
+    enum { SLOT = Info::TYPECHECK_SLOT };
+    typedef TypeCheckOpcode slot_t;
+    virtual uint                Slots()
+    {
+        return (1U << Info::OPCODE_SLOT) | (1U << Info::TYPECHECK_SLOT);
+    }
 };
 
 
@@ -371,8 +387,8 @@ ELFE_END
     DataResult(data, result);                                           \
     return success;
 
-#define LEFT            left.value
-#define RIGHT           right.value
+#define LEFT            ArgValue(left)
+#define RIGHT           ArgValue(right)
 #define ULEFT           ((ulonglong) LEFT)
 #define URIGHT          ((ulonglong) RIGHT)
 #define RIGHT0          ( RIGHT != 0 ? RIGHT : DIV0)
@@ -382,10 +398,10 @@ ELFE_END
 #define RIGHT_B         (right.value == "true")
 #define POSITION        (DataSelf(data)->Position())
 #define ELFE_CONTEXT    (Context(DataScope(data)).Pointer())
-#define AS_INT(x)       (new Integer((x), POSITION))
+#define AS_INT(x)       (Integer::Make((x), POSITION))
 #define AS_REAL(x)      (new Real((x), POSITION))
 #define AS_BOOL(x)      ((x) ? elfe_true : elfe_false)
-#define AS_TEXT(x)      (new Text(x, POSITION))
+#define AS_TEXT(x)      (new Text(Text::value_t(x), POSITION))
 #define R_INT(x)        RESULT(AS_INT(x))
 #define R_REAL(x)       RESULT(AS_REAL(x))
 #define R_BOOL(x)       RESULT(AS_BOOL(x))
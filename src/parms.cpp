@@ -124,6 +124,15 @@ bool ParameterList::DoText(Text *)
 }
 
 
+bool ParameterList::DoArray(Array *)
+// ----------------------------------------------------------------------------
+//   Nothing to do for arrays, they hold values, not parameters
+// ----------------------------------------------------------------------------
+{
+    return true;
+}
+
+
 bool ParameterList::DoName(Name *what)
 // ----------------------------------------------------------------------------
 //    Identify the named parameters being defined in the shape
@@ -156,7 +165,7 @@ bool ParameterList::DoInfix(Infix *what)
 // ----------------------------------------------------------------------------
 {
     // Check if we match a type, e.g. 2 vs. 'K : integer'
-    if (what->name == ":" || what->name == "as")
+    if (what->name == Infix::colon || what->name == Infix::as)
     {
         // Check the variable name, e.g. K in example above
         if (Name *varName = what->left->AsName())
@@ -196,7 +205,7 @@ bool ParameterList::DoInfix(Infix *what)
     // If this is the first one, this is what we define
     if (!defined)
     {
-        if (what->name == "as")
+        if (what->name == Infix::as)
             return what->left->Do(this);
 
         defined = what;
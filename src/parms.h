@@ -78,6 +78,7 @@ public:
     bool DoPostfix(Postfix *what);
     bool DoInfix(Infix *what);
     bool DoBlock(Block *what);
+    bool DoArray(Array *what);
 
 public:
     CompiledUnit *  unit;         // Current compilation unit
@@ -241,15 +241,9 @@ static inline Tree *CreatePrefix(Tree *left, Tree *right, TreePosition pos)
             if (name->value == "-")
             {
                 if (Integer *iv = right->AsInteger())
-                {
-                    iv->value = -iv->value;
-                    return iv;
-                }
+                    return new Integer(-iv->value, iv->Position());
                 if (Real *rv = right->AsReal())
-                {
-                    rv->value = -rv->value;
-                    return rv;
-                }
+                    return new Real(-rv->value, rv->Position());
             }
         }
     }
@@ -589,6 +583,14 @@ Tree *Parser::Parse(text closing)
                     // End of text: the result is what we just got
                     result = left;
                 }
+                else if (statement && infix == "\n" &&
+                         closing == "" && stack.size() == 0)
+                {
+                    // End of a top-level statement: the token after the
+                    // new-line is pending for the next statement
+                    result = left;
+                    done = true;
+                }
                 else
                 {
                     // Something like A+B+C, just got second +
@@ -673,4 +675,19 @@ Tree *Parser::Parse(text closing)
     return result;
 }
 
+
+Tree *Parser::ParseStatement()
+// ----------------------------------------------------------------------------
+//   Parse the next top-level statement, return NULL at end of input
+// ----------------------------------------------------------------------------
+//   A statement is complete when the next line is not indented and does not
+//   begin with an infix like 'else'. This allows a program read from a pipe
+//   to be evaluated statement by statement, without waiting for the end.
+{
+    statement = true;
+    Tree *result = Parse();
+    statement = false;
+    return result;
+}
+
 ELFE_END
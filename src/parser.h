@@ -97,23 +97,27 @@ public:
         : scanner(name, stx, pos, err),
           syntax(stx), errors(err), pending(tokNONE),
           openquote(), closequote(), comments(), commented(NULL),
-          hadSpaceBefore(false), hadSpaceAfter(false), beginningLine(true) {}
+          hadSpaceBefore(false), hadSpaceAfter(false), beginningLine(true),
+          statement(false) {}
     Parser(std::istream &input, Syntax &stx, Positions &pos, Errors &err,
            kstring name="<stream>")
         : scanner(input, stx, pos, err, name),
           syntax(stx), errors(err), pending(tokNONE),
           openquote(), closequote(), comments(), commented(NULL),
-          hadSpaceBefore(false), hadSpaceAfter(false), beginningLine(true) {}
+          hadSpaceBefore(false), hadSpaceAfter(false), beginningLine(true),
+          statement(false) {}
     Parser(Scanner &scanner, Syntax *stx)
         : scanner(scanner),
           syntax(stx ? *stx : scanner.InputSyntax()),
           errors(scanner.InputErrors()),
           pending(tokNONE),
           openquote(), closequote(), comments(), commented(NULL),
-          hadSpaceBefore(false), hadSpaceAfter(false), beginningLine(true) {}
+          hadSpaceBefore(false), hadSpaceAfter(false), beginningLine(true),
+          statement(false) {}
 
 public:
     Tree *              Parse(text closing_paren = "");
+    Tree *              ParseStatement();
     Scanner *           ParserScanner()         { return &scanner; }
     token_t             NextToken();
     void                AddComment(text c)      { comments.push_back(c); }
@@ -128,6 +132,7 @@ private:
     CommentsList        comments;
     Tree *              commented;
     bool                hadSpaceBefore, hadSpaceAfter, beginningLine;
+    bool                statement;      // Stop after a top-level statement
 };
 
 
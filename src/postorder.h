@@ -60,6 +60,7 @@ struct PostOrderTraversal
     value_type DoReal(Real *what)               { return what->Do(action); }
     value_type DoText(Text *what)               { return what->Do(action); }
     value_type DoName(Name *what)               { return what->Do(action); }
+    value_type DoArray(Array *what)             { return what->Do(action); }
 
     value_type DoBlock(Block *what)
     {
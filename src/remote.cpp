@@ -24,6 +24,7 @@
 #include "main.h"
 #include "save.h"
 #include "tree-clone.h"
+#include "tree-share.h"
 #include "fdstream.hpp"
 
 #include <sys/types.h>
@@ -110,6 +111,8 @@ struct StopAtGlobalsCloneMode
     {
         if (t == cutpoint)
             return elfe_nil;
+        if (t->IsLeaf() && SharedLeaves::Enabled())
+            return SharedLeaves::Share(t);
         return t->Do(clone);
     }
 
@@ -160,22 +163,22 @@ static Tree *elfe_restore_nil(Tree *tree)
     }
     else if (Infix *infix = tree->AsInfix())
     {
-        infix->left  = elfe_restore_nil(infix->left);
-        infix->right = elfe_restore_nil(infix->right);
+        infix->left.Set(infix, elfe_restore_nil(infix->left));
+        infix->right.Set(infix, elfe_restore_nil(infix->right));
     }
     else if (Prefix *prefix = tree->AsPrefix())
     {
-        prefix->left  = elfe_restore_nil(prefix->left);
-        prefix->right = elfe_restore_nil(prefix->right);
+        prefix->left.Set(prefix, elfe_restore_nil(prefix->left));
+        prefix->right.Set(prefix, elfe_restore_nil(prefix->right));
     }
     else if (Postfix *postfix = tree->AsPostfix())
     {
-        postfix->left  = elfe_restore_nil(postfix->left);
-        postfix->right = elfe_restore_nil(postfix->right);
+        postfix->left.Set(postfix, elfe_restore_nil(postfix->left));
+        postfix->right.Set(postfix, elfe_restore_nil(postfix->right));
     }
     else if (Block *block = tree->AsBlock())
     {
-        block->child = elfe_restore_nil(block->child);
+        block->child.Set(block, elfe_restore_nil(block->child));
     }
     return tree;
 }
@@ -203,7 +206,7 @@ static Tree_p elfe_merge_context(Context *context, Tree *code)
                     scope = parent;
                 
                 // Reattach that end to current scope
-                scope->left = context->CurrentScope();
+                scope->left.Set(scope, context->CurrentScope());
             }
                 
             // And make the resulting code a closure at that location
@@ -507,6 +510,9 @@ int elfe_listen(Context *context, uint forking, uint port)
         IFTRACE(remote)
             std::cerr << "elfe_listen: Got incoming connexion\n";
 
+        // Reload source files that changed before handling the request
+        MAIN->Refresh(0);
+
         // Fork child for incoming connexion
         int pid = forking ? fork() : 0;
         if (pid == -1)
@@ -88,7 +88,7 @@ struct EnterFormatsAction : Action
             }
             else if (Text *txt = what->left->AsText())
             {
-                formats[txt->value] = what->right;
+                formats[txt->Value()] = what->right;
                 return what;
             }
         }
@@ -135,11 +135,9 @@ void Renderer::SelectStyleSheet(text styleFile, text syntaxFile)
 //   Select an arbitrary style sheet
 // ----------------------------------------------------------------------------
 {
-    Syntax defaultSyntax, emptySyntax;
+    Syntax defaultSyntax(syntaxFile.c_str());
     Positions positions;
     Errors errors;
-    Scanner scanner(syntaxFile.c_str(), emptySyntax, positions, errors);
-    defaultSyntax.ReadSyntaxFile(scanner);
     Parser p(styleFile.c_str(), defaultSyntax, positions, errors);
 
     // Some defaults
@@ -280,7 +278,7 @@ void Renderer::RenderFormat(Tree *format)
 {
     if (Text *tf = format->AsText())
     {
-        text t = tf->value;
+        text t = tf->Value();
         if (tf->opening == Text::textQuote)
         {
             if (need_newline && t != "")
@@ -460,11 +458,11 @@ bool Renderer::IsAmbiguousPrefix(Tree *test, bool testL, bool testR)
         Tree *r = t->right;
         if (testL)
             if (Name *n = l->AsName())
-                if (syntax.infix_priority.count(n->value) > 0)
+                if (syntax.KnownInfix(n->value))
                     return true;
         if (testR)
             if (Name *n = r->AsName())
-                if (syntax.infix_priority.count(n->value) > 0)
+                if (syntax.KnownInfix(n->value))
                     return true;
     }
     return false;
@@ -478,9 +476,9 @@ bool Renderer::IsSubFunctionInfix(Tree *test)
 {
     if (Infix *it = test->AsInfix())
     {
-        if (syntax.infix_priority.count(it->name) <= 0)
+        if (!syntax.KnownInfix(it->name))
             return true;
-        else if (syntax.infix_priority[it->name] < syntax.function_priority)
+        else if (syntax.InfixPriority(it->name) < syntax.function_priority)
             return true;
     }
     return false;
@@ -493,8 +491,8 @@ int Renderer::InfixPriority(Tree *test)
 // ----------------------------------------------------------------------------
 {
     if (Infix_p it = test->AsInfix())
-        if (syntax.infix_priority.count(it->name) > 0)
-            return syntax.infix_priority[it->name];
+        if (syntax.KnownInfix(it->name))
+            return syntax.InfixPriority(it->name);
     return 9997;                                // Approximate infinity
 }
 
@@ -610,7 +608,7 @@ void Renderer::RenderBody(Tree *what)
                  break;
              case TEXT: {
                  Text *w = what->AsText();
-                 t = w->value;
+                 t = w->Value();
                  text q0 = t.find("\n") != t.npos ? "longtext " : "text ";
                  text q1 = q0 + w->opening;
                  text q2 = q1 + " " + w->closing;
@@ -787,6 +785,19 @@ void Renderer::RenderBody(Tree *what)
                      RenderFormat (w->closing, w->closing, "closing ");
                  }
              }   break;
+             case ARRAY: {
+                 // Rendered as 'array (A, B, C)', without building that tree
+                 Array *w = what->AsArray();
+                 RenderFormat ("array (", "array (");
+                 for (size_t i = 0, n = w->Length(); i < n; i++)
+                 {
+                     if (i)
+                         RenderFormat (",", "array ,");
+                     Tree_p item = w->Item(i);
+                     Render (item);
+                 }
+                 RenderFormat (")", "array )");
+             }   break;
              }
 
         this->self = old_self;
@@ -49,6 +49,7 @@
 #include "main.h"
 #include "save.h"
 #include "tree-clone.h"
+#include "tree-cycles.h"
 #include "utf8_fileutils.h"
 #include "interpreter.h"
 #include "winglob.h"
@@ -125,7 +126,7 @@ Integer *elfe_new_integer(longlong value)
 //    Called by generated code to build a new Integer
 // ----------------------------------------------------------------------------
 {
-    Integer *result = new Integer(value);
+    Integer *result = Integer::Make(value);
     return result;
 }
 
@@ -238,6 +239,7 @@ Tree *elfe_parse_tree_inner(Context *context, Tree *tree)
     case REAL:
     case TEXT:
     case NAME:
+    case ARRAY:
         return tree;
     case INFIX:
     {
@@ -267,10 +269,10 @@ Tree *elfe_parse_tree_inner(Context *context, Tree *tree)
     {
         Block *block = (Block *) tree;
         Tree *result = block->child;
-        if (block->opening == "{" && block->closing == "}")
+        if (block->IsBraces())
         {
             Block *child = result->AsBlock();
-            if (child && child->opening == "{" && child->closing == "}")
+            if (child && child->IsBraces())
             {
                 // Case where we have parse_tree {{x}}: Return {x}
                 result = elfe_parse_tree_inner(context, child->child);
@@ -306,10 +308,20 @@ Tree *elfe_parse_text(text source)
 // ----------------------------------------------------------------------------
 //   Generate a tree from text
 // ----------------------------------------------------------------------------
+//   The nodes are allocated together, and their arenas are given back
+//   as soon as the whole tree is dead.
 {
     std::istringstream input(source);
     Parser parser(input, MAIN->syntax,MAIN->positions,*MAIN->errors, "<text>");
-    return parser.Parse();
+    Tree_p result;
+    uint region = 0;
+    {
+        GCRegion scope;
+        region = scope.Id();
+        result = parser.Parse();
+    }
+    GCRegion::Release(region);
+    return result;
 }
 
 
@@ -351,7 +363,8 @@ static void elfe_list_files(Context *context, Tree *patterns, Tree_p *&parent)
     }
     if (Infix *infix = patterns->AsInfix())
     {
-        if (infix->name == "," || infix->name == ";" || infix->name == "\n")
+        if (infix->name == Infix::comma || infix->name == Infix::semicolon ||
+            infix->name == Infix::newline)
         {
             elfe_list_files(context, infix->left, parent);
             elfe_list_files(context, infix->right, parent);
@@ -363,7 +376,7 @@ static void elfe_list_files(Context *context, Tree *patterns, Tree_p *&parent)
     if (Text *regexp = patterns->AsText())
     {
         glob_t files;
-        text filename = regexp->value;
+        text filename = regexp->Value();
         glob(filename.c_str(), GLOB_MARK, NULL, &files);
         for (uint i = 0; i < files.gl_pathc; i++)
         {
@@ -388,6 +401,82 @@ static void elfe_list_files(Context *context, Tree *patterns, Tree_p *&parent)
 
 
 
+// ============================================================================
+//
+//   Arrays
+//
+// ============================================================================
+
+Array *elfe_new_array(Context *context, Tree *items)
+// ----------------------------------------------------------------------------
+//   Build an array from the evaluated items of a comma-separated list
+// ----------------------------------------------------------------------------
+{
+    Array_p result = new Array(items->Position());
+    if (Block *block = items->AsBlock())
+        items = block->child;
+    if (Name *name = items->AsName())
+        if (name->value == "")
+            return result;              // Empty array, e.g. 'array ()'
+
+    while (Infix *infix = items->AsInfix())
+    {
+        if (infix->name != Infix::comma)
+            break;
+        result->Append(context->Evaluate(infix->left));
+        items = infix->right;
+    }
+    result->Append(context->Evaluate(items));
+    return result;
+}
+
+
+Tree *elfe_array_item(Array *array, longlong index)
+// ----------------------------------------------------------------------------
+//   Return the item at the given index, counting from 0
+// ----------------------------------------------------------------------------
+{
+    if (index < 0 || (ulonglong) index >= array->Length())
+        return Ooops("Index $1 is out of range for $2",
+                     new Integer(index), array);
+    return array->Item(index);
+}
+
+
+Tree *elfe_array_slice(Array *array, longlong first, longlong count)
+// ----------------------------------------------------------------------------
+//   Return the 'count' items starting at 'first', clipped to the array
+// ----------------------------------------------------------------------------
+{
+    longlong length = array->Length();
+    if (first < 0)
+        first = 0;
+    if (first > length)
+        first = length;
+    if (count < 0)
+        count = 0;
+    if (count > length - first)
+        count = length - first;
+    return array->Slice(first, count);
+}
+
+
+Array *elfe_array_map(Context *context, Array *array, Tree *function)
+// ----------------------------------------------------------------------------
+//   Apply a function to each item in turn, collecting the results
+// ----------------------------------------------------------------------------
+{
+    Array_p result = new Array(array->Position());
+    for (size_t i = 0; i < array->Length(); i++)
+    {
+        Tree_p call = new Prefix(function, array->Item(i), function->Position());
+        result->Append(context->Evaluate(call));
+    }
+    return result;
+}
+
+
+
 // ============================================================================
 //
 //   File utilities
@@ -422,7 +511,7 @@ bool elfe_file_exists(Context *context, Tree_p self, text path)
             if (Tree * dir = context->Named("module_dir"))
             {
                 if (Text * txt = dir->AsText())
-                    path = txt->value + "/" + path;
+                    path = txt->Value() + "/" + path;
             }
         }
    }
@@ -473,7 +562,7 @@ Tree *elfe_import(Context *context, Tree *self, text name, int phase)
             {
                 if (Text * txt = dir->AsText())
                 {
-                    path = txt->value + "/" + name;
+                    path = txt->Value() + "/" + name;
                     utf8_filestat_t st;
                     if (utf8_stat (path.c_str(), &st) < 0)
                         path = "";
@@ -680,7 +769,7 @@ Tree *elfe_load_data(Context *context, Tree *self, text inputName,
                 longlong l = strtoll(buffer, &ptr2, 10);
                 if (ptr2 == ptr-1)
                 {
-                    child = new Integer(l);
+                    child = Integer::Make(l);
                 }
                 else
                 {
@@ -1109,6 +1198,16 @@ bool elfe_random_seed(int seed)
     return true;
 }
 
+
+integer_t elfe_cycles_found()
+// ----------------------------------------------------------------------------
+//    Return the number of trees the cycle collector freed so far
+// ----------------------------------------------------------------------------
+{
+    CycleCollector *cycles = CycleCollector::Singleton();
+    return cycles ? cycles->Found() : 0;
+}
+
 } // extern "C"
 
 
@@ -59,6 +59,7 @@ struct Block;
 struct Infix;
 struct Prefix;
 struct Postfix;
+struct Array;
 struct Context;
 struct Main;
 struct SourceFile;
@@ -126,6 +127,8 @@ integer_t       elfe_GMT_offset();
 
 real_t          elfe_random();
 bool            elfe_random_seed(int seed);
+
+integer_t       elfe_cycles_found();
 #pragma GCC diagnostic pop
 }
 
@@ -182,6 +185,19 @@ Tree *  elfe_parse_text(text source);
 
 
 
+// ============================================================================
+//
+//    Arrays
+//
+// ============================================================================
+
+Array * elfe_new_array(Context *, Tree *items);
+Tree *  elfe_array_item(Array *array, longlong index);
+Tree *  elfe_array_slice(Array *array, longlong first, longlong count);
+Array * elfe_array_map(Context *, Array *array, Tree *function);
+
+
+
 // ============================================================================
 // 
 //   File utilities
@@ -0,0 +1,413 @@
+// ****************************************************************************
+//  sampling.cpp                                                 ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Streaming aggregation of samples, e.g. moving averages of sensor data
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//  (C) 2015 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2015 Taodyne SAS
+// ****************************************************************************
+//
+//  Each aggregate is an array of reals holding its samples, with an Info
+//  attached to that array keeping the running state. Adding a sample or
+//  reading an aggregate is a single builtin call doing a constant amount
+//  of work, instead of a few ELFE assignments per sample.
+//
+//  A sliding window keeps its last N samples in a ring, so the array items
+//  are in storage order, not arrival order. The sum is updated with each
+//  sample, and recomputed from the ring each time it wraps around so that
+//  rounding errors do not accumulate. Minimum and maximum are read from
+//  monotonic queues, which costs amortized constant time per sample.
+//
+//  A tumbling window accumulates N samples, then starts over with the
+//  next sample. Its aggregates are those of the window being filled, or
+//  of the last completed window until a new sample arrives.
+//
+
+#include "sampling.h"
+#include "vectors.h"
+#include "info.h"
+#include "errors.h"
+
+#include <deque>
+#include <cmath>
+
+
+ELFE_BEGIN
+
+// ============================================================================
+//
+//    State attached to the arrays
+//
+// ============================================================================
+
+struct WindowInfo : Info
+// ----------------------------------------------------------------------------
+//   Running state of a sliding or tumbling window
+// ----------------------------------------------------------------------------
+{
+    typedef std::pair<ulonglong, double>        indexed_t;
+    typedef std::deque<indexed_t>               queue_t;
+
+    WindowInfo(size_t size, bool sliding)
+        : size(size), sliding(sliding), next(0), seen(0), sum(0.0),
+          lows(), highs() {}
+
+    void        Add(Array *array, double sample);
+    void        Enqueue(queue_t &queue, double sample, bool lowest);
+
+    size_t      size;           // Number of samples in a full window
+    bool        sliding;        // Sliding or tumbling window
+    size_t      next;           // Ring slot for the next sliding sample
+    ulonglong   seen;           // Samples added since the window was reset
+    double      sum;            // Running sum of the samples in the window
+    queue_t     lows;           // Increasing candidates for the minimum
+    queue_t     highs;          // Decreasing candidates for the maximum
+};
+
+
+struct AverageInfo : Info
+// ----------------------------------------------------------------------------
+//   Smoothing factor for an exponentially weighted moving average
+// ----------------------------------------------------------------------------
+{
+    AverageInfo(double alpha): alpha(alpha) {}
+    double      alpha;
+};
+
+
+struct TriggerInfo : Info
+// ----------------------------------------------------------------------------
+//   Threshold for a change trigger
+// ----------------------------------------------------------------------------
+{
+    TriggerInfo(double threshold): threshold(threshold) {}
+    double      threshold;
+};
+
+
+void WindowInfo::Enqueue(queue_t &queue, double sample, bool lowest)
+// ----------------------------------------------------------------------------
+//   Add a sample to a monotonic queue, dropping samples it supersedes
+// ----------------------------------------------------------------------------
+//   A sample older than a smaller one can never be the minimum again,
+//   so the queue for minimums is increasing, and the front is the minimum
+{
+    while (!queue.empty() && (lowest ? queue.back().second >= sample
+                                     : queue.back().second <= sample))
+        queue.pop_back();
+    queue.push_back(indexed_t(seen, sample));
+    if (sliding)
+        while (queue.front().first + size <= seen)
+            queue.pop_front();
+}
+
+
+void WindowInfo::Add(Array *array, double sample)
+// ----------------------------------------------------------------------------
+//   Add a sample to the window, updating the running state
+// ----------------------------------------------------------------------------
+{
+    std::vector<double> &ring = array->reals;
+    if (!sliding && ring.size() == size)
+    {
+        // Tumbling window: a new sample starts the next window
+        ring.clear();
+        lows.clear();
+        highs.clear();
+        seen = 0;
+        sum = 0.0;
+    }
+
+    if (ring.size() < size)
+    {
+        ring.push_back(sample);
+        sum += sample;
+    }
+    else
+    {
+        sum += sample - ring[next];
+        ring[next] = sample;
+    }
+    if (sliding && ++next == size)
+    {
+        next = 0;
+        sum = elfe_vector_sum(ring.data(), ring.size());
+    }
+
+    Enqueue(lows, sample, true);
+    Enqueue(highs, sample, false);
+    seen++;
+}
+
+
+
+// ============================================================================
+//
+//    Helpers
+//
+// ============================================================================
+
+static Array *sampleArray(size_t size, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   Create the array of reals holding the samples
+// ----------------------------------------------------------------------------
+//   Only room for a few samples is reserved, the array grows as they come,
+//   so that a large window does not take memory it may never use
+{
+    const size_t RESERVED = 1024;
+    Array *array = new Array(pos);
+    array->packing = Array::REALS;
+    array->reals.reserve(size < RESERVED ? size : RESERVED);
+    return array;
+}
+
+
+template <class I>
+static Tree *notSampling(Array *array, I *&info, text kind)
+// ----------------------------------------------------------------------------
+//   Return an error if the array has no running state, NULL otherwise
+// ----------------------------------------------------------------------------
+//   Appending to the array directly would break the running state
+{
+    info = array->GetInfo<I>();
+    if (!info)
+        return Ooops(("The array $1 is not a " + kind).c_str(), array);
+    if (array->packing != Array::REALS)
+        return Ooops(("The " + kind + " $1 was modified").c_str(), array);
+    return NULL;
+}
+
+
+static Tree *notWindow(Array *window, WindowInfo *&info,
+                       bool needSamples = false)
+// ----------------------------------------------------------------------------
+//   Return an error if the array is not a window, NULL otherwise
+// ----------------------------------------------------------------------------
+//   Aggregates like the mean need at least one sample
+{
+    if (Tree *error = notSampling(window, info, "window"))
+        return error;
+    if (window->Length() > info->size)
+        return Ooops("The window $1 was modified", window);
+    if (needSamples && window->Length() == 0)
+        return Ooops("The window $1 is empty", window);
+    return NULL;
+}
+
+
+
+// ============================================================================
+//
+//    Sliding and tumbling windows
+//
+// ============================================================================
+
+static Tree *newWindow(longlong size, TreePosition pos, bool sliding)
+// ----------------------------------------------------------------------------
+//   Create a window with the given number of samples
+// ----------------------------------------------------------------------------
+{
+    if (size <= 0 || (ulonglong) size > std::vector<double>().max_size())
+        return Ooops("Invalid window size $1", new Integer(size, pos));
+    Array *window = sampleArray(size, pos);
+    window->SetInfo<WindowInfo>(new WindowInfo(size, sliding));
+    return window;
+}
+
+
+Tree *elfe_sliding_window(longlong size, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   A window holding the last 'size' samples
+// ----------------------------------------------------------------------------
+{
+    return newWindow(size, pos, true);
+}
+
+
+Tree *elfe_tumbling_window(longlong size, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   A window collecting 'size' samples, then starting over
+// ----------------------------------------------------------------------------
+{
+    return newWindow(size, pos, false);
+}
+
+
+Tree *elfe_window_add(Array *window, double sample)
+// ----------------------------------------------------------------------------
+//   Add a sample to a window, return true if the window is full
+// ----------------------------------------------------------------------------
+{
+    WindowInfo *info;
+    if (Tree *error = notWindow(window, info))
+        return error;
+    info->Add(window, sample);
+    return window->Length() == info->size ? elfe_true : elfe_false;
+}
+
+
+Tree *elfe_window_count(Array *window)
+// ----------------------------------------------------------------------------
+//   Number of samples currently in the window
+// ----------------------------------------------------------------------------
+{
+    WindowInfo *info;
+    if (Tree *error = notWindow(window, info))
+        return error;
+    return Integer::Make(window->Length(), window->Position());
+}
+
+
+Tree *elfe_window_sum(Array *window)
+// ----------------------------------------------------------------------------
+//   Sum of the samples in the window
+// ----------------------------------------------------------------------------
+{
+    WindowInfo *info;
+    if (Tree *error = notWindow(window, info))
+        return error;
+    return new Real(info->sum, window->Position());
+}
+
+
+Tree *elfe_window_min(Array *window)
+// ----------------------------------------------------------------------------
+//   Smallest sample in the window
+// ----------------------------------------------------------------------------
+{
+    WindowInfo *info;
+    if (Tree *error = notWindow(window, info, true))
+        return error;
+    return new Real(info->lows.front().second, window->Position());
+}
+
+
+Tree *elfe_window_max(Array *window)
+// ----------------------------------------------------------------------------
+//   Largest sample in the window
+// ----------------------------------------------------------------------------
+{
+    WindowInfo *info;
+    if (Tree *error = notWindow(window, info, true))
+        return error;
+    return new Real(info->highs.front().second, window->Position());
+}
+
+
+Tree *elfe_window_mean(Array *window)
+// ----------------------------------------------------------------------------
+//   Mean of the samples in the window
+// ----------------------------------------------------------------------------
+{
+    WindowInfo *info;
+    if (Tree *error = notWindow(window, info, true))
+        return error;
+    return new Real(info->sum / window->Length(), window->Position());
+}
+
+
+
+// ============================================================================
+//
+//    Exponentially weighted moving average
+//
+// ============================================================================
+
+Tree *elfe_ewma(double alpha, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   Create an average where each new sample has weight 'alpha'
+// ----------------------------------------------------------------------------
+{
+    if (alpha <= 0.0 || alpha > 1.0)
+        return Ooops("Smoothing factor $1 is not between 0 and 1",
+                     new Real(alpha, pos));
+    Array *average = sampleArray(1, pos);
+    average->SetInfo<AverageInfo>(new AverageInfo(alpha));
+    return average;
+}
+
+
+Tree *elfe_ewma_add(Array *average, double sample)
+// ----------------------------------------------------------------------------
+//   Add a sample to the average, return the new average
+// ----------------------------------------------------------------------------
+//   The first sample initializes the average
+{
+    AverageInfo *info;
+    if (Tree *error = notSampling(average, info, "moving average"))
+        return error;
+    std::vector<double> &value = average->reals;
+    if (value.empty())
+        value.push_back(sample);
+    else
+        value[0] += info->alpha * (sample - value[0]);
+    return new Real(value[0], average->Position());
+}
+
+
+
+// ============================================================================
+//
+//    Change triggers
+//
+// ============================================================================
+
+Tree *elfe_change_trigger(double threshold, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   Create a trigger firing on changes of at least 'threshold'
+// ----------------------------------------------------------------------------
+{
+    Array *trigger = sampleArray(1, pos);
+    trigger->SetInfo<TriggerInfo>(new TriggerInfo(fabs(threshold)));
+    return trigger;
+}
+
+
+Tree *elfe_trigger_add(Array *trigger, double sample)
+// ----------------------------------------------------------------------------
+//   Return true if the sample moved enough since the last one reported
+// ----------------------------------------------------------------------------
+//   The first sample is the initial reference and does not fire. When the
+//   trigger fires, the sample becomes the new reference
+{
+    TriggerInfo *info;
+    if (Tree *error = notSampling(trigger, info, "trigger"))
+        return error;
+    std::vector<double> &reference = trigger->reals;
+    if (reference.empty())
+    {
+        reference.push_back(sample);
+        return elfe_false;
+    }
+    if (fabs(sample - reference[0]) < info->threshold)
+        return elfe_false;
+    reference[0] = sample;
+    return elfe_true;
+}
+
+
+Tree *elfe_trigger_value(Array *trigger)
+// ----------------------------------------------------------------------------
+//   Return the reference sample of a trigger
+// ----------------------------------------------------------------------------
+{
+    TriggerInfo *info;
+    if (Tree *error = notSampling(trigger, info, "trigger"))
+        return error;
+    if (trigger->reals.empty())
+        return Ooops("The trigger $1 has no sample yet", trigger);
+    return new Real(trigger->reals[0], trigger->Position());
+}
+
+ELFE_END
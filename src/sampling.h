@@ -0,0 +1,50 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+// ****************************************************************************
+//  sampling.h                                                   ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//    Streaming aggregation of samples, e.g. moving averages of sensor data
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//  (C) 2015 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2015 Taodyne SAS
+// ****************************************************************************
+
+#include "base.h"
+#include "tree.h"
+#include "array_module.h"
+
+ELFE_BEGIN
+
+// Windows over the most recent samples
+Tree *  elfe_sliding_window(longlong size, TreePosition pos);
+Tree *  elfe_tumbling_window(longlong size, TreePosition pos);
+Tree *  elfe_window_add(Array *window, double sample);
+Tree *  elfe_window_count(Array *window);
+Tree *  elfe_window_sum(Array *window);
+Tree *  elfe_window_min(Array *window);
+Tree *  elfe_window_max(Array *window);
+Tree *  elfe_window_mean(Array *window);
+
+// Exponentially weighted moving average
+Tree *  elfe_ewma(double alpha, TreePosition pos);
+Tree *  elfe_ewma_add(Array *average, double sample);
+
+// Triggers firing when a sample moves far enough from the last one reported
+Tree *  elfe_change_trigger(double threshold, TreePosition pos);
+Tree *  elfe_trigger_add(Array *trigger, double sample);
+Tree *  elfe_trigger_value(Array *trigger);
+
+ELFE_END
+
+#endif // SAMPLING_H
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
+#include <iterator>
 #include "scanner.h"
 #include "errors.h"
 #include "syntax.h"
@@ -31,6 +32,19 @@
 #include "utf8.h"
 #include "utf8_fileutils.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef CONFIG_MINGW
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // CONFIG_MINGW
+
 
 ELFE_BEGIN
 
@@ -72,6 +86,232 @@ private:
 } digit_values;
 
 
+class NameCharacters
+// ----------------------------------------------------------------------------
+//   Characters that always continue a name, except the underscore
+// ----------------------------------------------------------------------------
+//   Letters and digits in the C locale, and all bytes in UTF-8 sequences.
+//   The current locale may accept more characters, the scanner's general
+//   loop deals with them.
+{
+public:
+    NameCharacters()
+    {
+        for (uint c = 0; c < 256; c++)
+            value[c] = ((c >= '0' && c <= '9') ||
+                        (c >= 'A' && c <= 'Z') ||
+                        (c >= 'a' && c <= 'z') ||
+                        IS_UTF8_FIRST(c) || IS_UTF8_NEXT(c));
+    }
+    inline bool operator[] (char c)
+    {
+        return value[(uchar) c];
+    }
+private:
+    bool value[256];
+} name_characters;
+
+
+
+// ============================================================================
+//
+//    Finding runs of characters in a span
+//
+// ============================================================================
+//   These use SSE2 or AVX2 when the compiler targets them to test 16 or 32
+//   bytes at a time, and the scalar loops for the last bytes in the span.
+
+#if defined(__AVX2__)
+typedef __m256i byte_lanes;
+const size_t BYTE_LANES = 32;
+#define BYTES_LOAD(p)           _mm256_loadu_si256((const __m256i *) (p))
+#define BYTES_SET(c)            _mm256_set1_epi8(c)
+#define BYTES_EQ(x, y)          _mm256_cmpeq_epi8(x, y)
+#define BYTES_GT(x, y)          _mm256_cmpgt_epi8(x, y)
+#define BYTES_AND(x, y)         _mm256_and_si256(x, y)
+#define BYTES_OR(x, y)          _mm256_or_si256(x, y)
+#define BYTES_MASK(x)           ((uint) _mm256_movemask_epi8(x))
+#define BYTES_ALL               (~0U)
+#elif defined(__SSE2__)
+typedef __m128i byte_lanes;
+const size_t BYTE_LANES = 16;
+#define BYTES_LOAD(p)           _mm_loadu_si128((const __m128i *) (p))
+#define BYTES_SET(c)            _mm_set1_epi8(c)
+#define BYTES_EQ(x, y)          _mm_cmpeq_epi8(x, y)
+#define BYTES_GT(x, y)          _mm_cmpgt_epi8(x, y)
+#define BYTES_AND(x, y)         _mm_and_si128(x, y)
+#define BYTES_OR(x, y)          _mm_or_si128(x, y)
+#define BYTES_MASK(x)           ((uint) _mm_movemask_epi8(x))
+#define BYTES_ALL               (0xFFFFU)
+#endif
+
+
+size_t ScannerInput::RunOf(char c)
+// ----------------------------------------------------------------------------
+//   Number of characters equal to 'c' at the cursor
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return 0;
+    kstring p = cursor;
+#ifdef BYTES_LOAD
+    byte_lanes wanted = BYTES_SET(c);
+    for (; p + BYTE_LANES <= end; p += BYTE_LANES)
+    {
+        uint match = BYTES_MASK(BYTES_EQ(BYTES_LOAD(p), wanted));
+        if (match != BYTES_ALL)
+            return p - cursor + __builtin_ctz(~match);
+    }
+#endif
+    while (p < end && *p == c)
+        p++;
+    return p - cursor;
+}
+
+
+size_t ScannerInput::RunOfNames()
+// ----------------------------------------------------------------------------
+//   Number of letters, digits or UTF-8 bytes at the cursor
+// ----------------------------------------------------------------------------
+//   Letters are found by setting the lowercase bit and checking 'a'..'z'.
+//   As signed bytes, the UTF-8 bytes 0x80..0xFD are -128..-3.
+{
+    if (stream)
+        return 0;
+    kstring p = cursor;
+#ifdef BYTES_LOAD
+    byte_lanes caseBit = BYTES_SET(0x20);
+    byte_lanes beforeA = BYTES_SET('a' - 1);
+    byte_lanes afterZ  = BYTES_SET('z' + 1);
+    byte_lanes before0 = BYTES_SET('0' - 1);
+    byte_lanes after9  = BYTES_SET('9' + 1);
+    byte_lanes utf8End = BYTES_SET(-2);
+    for (; p + BYTE_LANES <= end; p += BYTE_LANES)
+    {
+        byte_lanes x = BYTES_LOAD(p);
+        byte_lanes lower = BYTES_OR(x, caseBit);
+        byte_lanes letter = BYTES_AND(BYTES_GT(lower, beforeA),
+                                      BYTES_GT(afterZ, lower));
+        byte_lanes digit = BYTES_AND(BYTES_GT(x, before0),
+                                     BYTES_GT(after9, x));
+        byte_lanes utf8 = BYTES_GT(utf8End, x);
+        uint match = BYTES_MASK(BYTES_OR(BYTES_OR(letter, digit), utf8));
+        if (match != BYTES_ALL)
+            return p - cursor + __builtin_ctz(~match);
+    }
+#endif
+    while (p < end && name_characters[*p])
+        p++;
+    return p - cursor;
+}
+
+
+size_t ScannerInput::RunUntil(char first, char second)
+// ----------------------------------------------------------------------------
+//   Number of characters before the next 'first' or 'second'
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return 0;
+    kstring p = cursor;
+#ifdef BYTES_LOAD
+    byte_lanes firstLanes = BYTES_SET(first);
+    byte_lanes secondLanes = BYTES_SET(second);
+    for (; p + BYTE_LANES <= end; p += BYTE_LANES)
+    {
+        byte_lanes x = BYTES_LOAD(p);
+        uint match = BYTES_MASK(BYTES_OR(BYTES_EQ(x, firstLanes),
+                                         BYTES_EQ(x, secondLanes)));
+        if (match)
+            return p - cursor + __builtin_ctz(match);
+    }
+#endif
+    while (p < end && *p != first && *p != second)
+        p++;
+    return p - cursor;
+}
+
+
+
+// ============================================================================
+//
+//    Scanner input
+//
+// ============================================================================
+
+ScannerInput::ScannerInput(kstring name)
+// ----------------------------------------------------------------------------
+//   Map a file in memory, or read it entirely if we can't map it
+// ----------------------------------------------------------------------------
+//   When reloading, files are likely to be truncated while we scan them,
+//   which raises SIGBUS when touching a mapped page past the new end.
+//   So in that case we read the file instead of mapping it.
+    : stream(NULL), start(NULL), cursor(NULL), end(NULL), mapped(0),
+      contents(), atEnd(false), failed(false)
+{
+#ifndef CONFIG_MINGW
+    bool reload = Options::options ? Options::options->reload : false;
+    if (!reload)
+    {
+        int fd = open(name, O_RDONLY);
+        if (fd < 0)
+        {
+            failed = true;
+            return;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                mapped = st.st_size;
+                start = cursor = (kstring) map;
+                end = start + mapped;
+            }
+        }
+        close(fd);
+        if (mapped)
+            return;
+    }
+#endif // CONFIG_MINGW
+
+    // Special files, empty files, reloading or no mmap: read the whole file
+    utf8_ifstream file(name, std::ios::in | std::ios::binary);
+    if (file.fail())
+    {
+        failed = true;
+        return;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+    start = cursor = contents.data();
+    end = start + contents.length();
+}
+
+
+ScannerInput::ScannerInput(std::istream &stream)
+// ----------------------------------------------------------------------------
+//   Read from a stream one character at a time
+// ----------------------------------------------------------------------------
+    : stream(&stream), start(NULL), cursor(NULL), end(NULL), mapped(0),
+      contents(), atEnd(false), failed(false)
+{}
+
+
+ScannerInput::~ScannerInput()
+// ----------------------------------------------------------------------------
+//   Unmap the file if we mapped it
+// ----------------------------------------------------------------------------
+{
+#ifndef CONFIG_MINGW
+    if (mapped)
+        munmap((void *) start, mapped);
+#endif // CONFIG_MINGW
+}
+
+
 
 // ============================================================================
 //
@@ -84,7 +324,7 @@ Scanner::Scanner(kstring name, Syntax &stx, Positions &pos, Errors &err)
 //   Open the file and make sure it's readable
 // ----------------------------------------------------------------------------
     : syntax(stx),
-      input(*new utf8_ifstream(name)),
+      input(*new ScannerInput(name)),
       tokenText(""),
       textValue(""), realValue(0.0), intValue(0), base(10),
       indents(), indent(0), indentChar(0),
@@ -97,28 +337,28 @@ Scanner::Scanner(kstring name, Syntax &stx, Positions &pos, Errors &err)
 {
     indents.push_back(0);       // We start with an indent of 0
     position = positions.OpenFile(name);
-    if (input.fail())
+    if (input.Fail())
         err.Log(Error("File $1 cannot be read: $2", position).
                 Arg(name).Arg(strerror(errno)));
 
     // Skip UTF-8 BOM if present
-    if (input.get() != 0xEF)
-        input.unget();
-    else if (input.get() != 0xBB)
-        input.unget(), input.unget();
-    else if(input.get() != 0xBF)
-        input.unget(), input.unget(), input.unget();
+    if (input.Get() != 0xEF)
+        input.Unget();
+    else if (input.Get() != 0xBB)
+        input.Unget(), input.Unget();
+    else if(input.Get() != 0xBF)
+        input.Unget(), input.Unget(), input.Unget();
 }
 
 
-Scanner::Scanner(std::istream &input,
+Scanner::Scanner(std::istream &stream,
                  Syntax &stx, Positions &pos, Errors &err,
                  kstring fileName)
 // ----------------------------------------------------------------------------
 //   Open the file and make sure it's readable
 // ----------------------------------------------------------------------------
     : syntax(stx),
-      input(input),
+      input(*new ScannerInput(stream)),
       tokenText(""),
       textValue(""), realValue(0.0), intValue(0), base(10),
       indents(), indent(0), indentChar(0),
@@ -127,11 +367,11 @@ Scanner::Scanner(std::istream &input,
       caseSensitive(Options::options ? Options::options->case_sensitive : true),
       checkingIndent(false), settingIndent(false),
       hadSpaceBefore(false), hadSpaceAfter(false),
-      mustDeleteInput(false)
+      mustDeleteInput(true)
 {
     indents.push_back(0);       // We start with an indent of 0
     position = positions.OpenFile(fileName);
-    if (input.fail())
+    if (input.Fail())
         err.Log(Error("Input stream cannot be read: $1", position)
                 .Arg(strerror(errno)));
 }
@@ -173,16 +413,7 @@ Scanner::~Scanner()
 do {                                            \
     tokenText += c;                             \
     textValue += c;                             \
-    c = input.get();                            \
-    position++;                                 \
-} while(0)
-
-
-#define NEXT_LOWER_CHAR(c)                      \
-do {                                            \
-    tokenText += tolower(c);                    \
-    textValue += c;                             \
-    c = input.get();                            \
+    c = input.Get();                            \
     position++;                                 \
 } while(0)
 
@@ -190,11 +421,35 @@ do {                                            \
 #define IGNORE_CHAR(c)                          \
 do {                                            \
     textValue += c;                             \
-    c = input.get();                            \
+    c = input.Get();                            \
     position++;                                 \
 } while (0)
 
 
+void Scanner::NextRun(int &c, size_t run, bool lower)
+// ----------------------------------------------------------------------------
+//   Like NEXT_CHAR, taking 'run' more characters, lowercase in token text
+// ----------------------------------------------------------------------------
+{
+    kstring p = input.Cursor();
+    tokenText += lower ? tolower(c) : c;
+    textValue += c;
+    if (run)
+    {
+        textValue.append(p, run);
+        if (lower)
+            for (size_t i = 0; i < run; i++)
+                tokenText += tolower((uchar) p[i]);
+        else
+            tokenText.append(p, run);
+        input.Skip(run);
+        position += run;
+    }
+    c = input.Get();
+    position++;
+}
+
+
 token_t Scanner::NextToken(bool hungry)
 // ----------------------------------------------------------------------------
 //   Return the next token, and compute the token text and value
@@ -207,7 +462,7 @@ token_t Scanner::NextToken(bool hungry)
     base = 0;
 
     // Check if input was opened correctly
-    if (!input.good())
+    if (!input.Good())
         return tokEOF;
 
     // Check if we unindented far enough for multiple indents
@@ -219,7 +474,7 @@ token_t Scanner::NextToken(bool hungry)
     }
 
     // Read next character
-    int c = input.get();
+    int c = input.Get();
     position++;
 
     // Skip spaces and check indendation
@@ -249,14 +504,22 @@ token_t Scanner::NextToken(bool hungry)
         // Keep looking for more spaces
         if (c == '\n')
             textValue += c;
-        c = input.get();
+        else if ((c == ' ' || c == '\t') &&
+                 (!checkingIndent || c == indentChar))
+        {
+            // The same space repeated does not change the indentation checks
+            size_t run = input.RunOf(c);
+            input.Skip(run);
+            position += run;
+        }
+        c = input.Get();
         position++;
     } // End of space testing
 
     // Stop counting indentation
     if (checkingIndent)
     {
-        input.unget();
+        input.Unget();
         position--;
         checkingIndent = false;
         ulong column = position - lineStart;
@@ -304,7 +567,7 @@ token_t Scanner::NextToken(bool hungry)
     }
 
     // Report end of input if that's what we've got
-    if (input.eof())
+    if (input.Eof())
 	return tokEOF;
 
     // Clear spelling from whitespaces
@@ -359,11 +622,11 @@ token_t Scanner::NextToken(bool hungry)
         realValue = intValue;
         if (c == '.')
         {
-            int nextDigit = input.peek();
+            int nextDigit = input.Peek();
             if (digit_values[nextDigit] >= base)
             {
                 // This is something else following an integer: 1..3, 1.(3)
-                input.unget();
+                input.Unget();
                 position--;
                 hadSpaceAfter = false;
                 return tokINTEGER;
@@ -444,7 +707,7 @@ token_t Scanner::NextToken(bool hungry)
         }
 
         // Return the token
-        input.unget();
+        input.Unget();
         position--;
         hadSpaceAfter = isspace(c);
         return floating_point ? tokREAL : tokINTEGER;
@@ -458,9 +721,9 @@ token_t Scanner::NextToken(bool hungry)
             if (c == '_')
                 IGNORE_CHAR(c);
             else
-                NEXT_LOWER_CHAR(c);
+                NextRun(c, input.RunOfNames(), true);
         }
-        input.unget();
+        input.Unget();
         position--;
         hadSpaceAfter = isspace(c);
         if (syntax.IsBlock(textValue, endMarker))
@@ -473,7 +736,7 @@ token_t Scanner::NextToken(bool hungry)
     {
         char eos = c;
         tokenText = c;
-        c = input.get();
+        c = input.Get();
         position++;
         for(;;)
         {
@@ -481,11 +744,11 @@ token_t Scanner::NextToken(bool hungry)
             if (c == eos)
             {
                 tokenText += c;
-                c = input.get();
+                c = input.Get();
                 position++;
                 if (c != eos)
                 {
-                    input.unget();
+                    input.Unget();
                     position--;
                     hadSpaceAfter = isspace(c);
                     return eos == '"' ? tokSTRING : tokQUOTE;
@@ -499,10 +762,10 @@ token_t Scanner::NextToken(bool hungry)
                                  position));
                 hadSpaceAfter = false;
                 if (c == '\n')
-                    input.unget();
+                    input.Unget();
                 return eos == '"' ? tokSTRING : tokQUOTE;
             }
-            NEXT_CHAR(c);
+            NextRun(c, input.RunUntil(eos, '\n'), false);
         }
     }
 
@@ -523,7 +786,7 @@ token_t Scanner::NextToken(bool hungry)
         if (!hungry && !syntax.KnownPrefix(tokenText))
             break;
     }
-    input.unget();
+    input.Unget();
     position--;
     if (!hungry)
     {
@@ -531,7 +794,7 @@ token_t Scanner::NextToken(bool hungry)
         {
             tokenText.erase(tokenText.length() - 1, 1);
             textValue.erase(textValue.length() - 1, 1);
-            input.unget();
+            input.Unget();
             position--;
         }
     }
@@ -556,7 +819,17 @@ text Scanner::Comment(text EOC, bool stripIndent)
 
     while (*match && c != EOF)
     {
-        c = input.get();
+        // Outside of indentation, characters before a possible end of
+        // comment or line are simply added to the comment
+        if (match == eoc && !checkingIndent)
+        {
+            size_t run = input.RunUntil(*eoc, '\n');
+            comment.append(input.Cursor(), run);
+            input.Skip(run);
+            position += run;
+        }
+
+        c = input.Get();
         position++;
         skip = false;
 
@@ -697,46 +970,40 @@ void Positions::GetInfo(ulong pos, text *out_file, ulong *out_line,
     ulong  column = 0;
     text   source = "";
     text   name = "";
-    FILE  *file;
     char   c;
 
     GetFile (pos, &name, &offset);
     if (name != "")
     {
-        file = fopen(name.c_str(), "r");
-        if (file)
+        // Scan the file in memory, since this is done for each error,
+        // and reading one character at a time locks once threads exist
+        ScannerInput input(name.c_str());
+        kstring next = input.Cursor();
+        kstring end = next + input.Remaining();
+        while (next < end)
         {
-            while (!feof(file))
+            c = *next++;
+            if (c == EOF)
+                break;
+            if (c == '\n')
             {
-                c = fgetc(file);
-                if (c == EOF)
-                    break;
-                if (c == '\n')
-                {
-                    line++;
-                    column = 0;
-                    source = "";
-                }
-                else
-                {
-                    column++;
-                    source += c;
-                }
-                offset--;
-                if (offset <= 1)
-                    break;
+                line++;
+                column = 0;
+                source = "";
             }
-
-            // Read rest of line
-            while(!feof(file))
+            else
             {
-                c = fgetc(file);
-                if (c == '\n' || c == EOF)
-                    break;
+                column++;
                 source += c;
             }
-            fclose(file);
+            offset--;
+            if (offset <= 1)
+                break;
         }
+
+        // Read rest of line
+        while (next < end && *next != '\n' && *next != EOF)
+            source += *next++;
     }
 
     // Output result
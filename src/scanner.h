@@ -132,6 +132,46 @@ enum token_t
 typedef std::vector<uint> indent_list;
 
 
+struct ScannerInput
+// ----------------------------------------------------------------------------
+//   The characters read by a scanner
+// ----------------------------------------------------------------------------
+//   Files are memory-mapped, or read in one go where mapping is not possible
+//   or the file may be truncated under us when reloading, and scanned with
+//   a pointer. Other inputs, like the standard input or
+//   text being parsed, are read one character at a time from a stream.
+{
+    ScannerInput(kstring fileName);
+    ScannerInput(std::istream &stream);
+    ~ScannerInput();
+
+    int                 Get();
+    int                 Peek();
+    void                Unget();
+    bool                Good();
+    bool                Eof();
+    bool                Fail();
+
+    // Runs of characters that can be taken in one go, 0 for streams
+    size_t              RunOf(char c);
+    size_t              RunOfNames();
+    size_t              RunUntil(char first, char second);
+    kstring             Cursor()                { return cursor; }
+    size_t              Remaining()             { return end - cursor; }
+    void                Skip(size_t count)      { cursor += count; }
+
+private:
+    std::istream *      stream;         // Stream input, NULL for a span
+    kstring             start;          // First character of the span
+    kstring             cursor;         // Next character to read
+    kstring             end;            // End of the span
+    size_t              mapped;         // Size of the mapping, 0 if none
+    text                contents;       // File contents if not mapped
+    bool                atEnd;          // We tried to read past the end
+    bool                failed;         // The file could not be read
+};
+
+
 struct Positions
 // ----------------------------------------------------------------------------
 //    Records the positions of various scanners
@@ -142,6 +182,7 @@ struct Positions
 
     ulong               OpenFile(text name);
     void                CloseFile (ulong pos);
+    ulong               CurrentPosition()       { return current_position; }
 
     void                GetFile(ulong pos, text *file, ulong *offset);
     void                GetInfo(ulong pos, text *file, ulong *line,
@@ -198,14 +239,17 @@ public:
     void        CloseParen(uint old);
 
     // Get input of the scanner
-    std::istream & Input()              { return input; }
+    ScannerInput & Input()              { return input; }
     Positions    & InputPositions()     { return positions; }
     Errors       & InputErrors()        { return errors; }
     Syntax       & InputSyntax()        { return syntax; }
 
+private:
+    void           NextRun(int &c, size_t run, bool lower);
+
 private:
     Syntax &       syntax;
-    std::istream & input;
+    ScannerInput & input;
     text           tokenText;
     text           textValue;
     double         realValue;
@@ -227,6 +271,87 @@ private:
     bool           mustDeleteInput;
 };
 
+
+
+
+// ============================================================================
+//
+//    Inline functions
+//
+// ============================================================================
+
+inline int ScannerInput::Get()
+// ----------------------------------------------------------------------------
+//   Read the next character, or EOF
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return stream->get();
+    if (cursor < end)
+        return (unsigned char) *cursor++;
+    atEnd = true;
+    return EOF;
+}
+
+
+inline int ScannerInput::Peek()
+// ----------------------------------------------------------------------------
+//   Return the next character without reading it
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return stream->peek();
+    if (cursor < end)
+        return (unsigned char) *cursor;
+    return EOF;
+}
+
+
+inline void ScannerInput::Unget()
+// ----------------------------------------------------------------------------
+//   Go back one character
+// ----------------------------------------------------------------------------
+//   Like for streams, we can't go back once we read past the end
+{
+    if (stream)
+        stream->unget();
+    else if (!atEnd && cursor > start)
+        cursor--;
+}
+
+
+inline bool ScannerInput::Good()
+// ----------------------------------------------------------------------------
+//   Check if we can read more characters
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return stream->good();
+    return !atEnd && !failed;
+}
+
+
+inline bool ScannerInput::Eof()
+// ----------------------------------------------------------------------------
+//   Check if we read past the end of input
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return stream->eof();
+    return atEnd;
+}
+
+
+inline bool ScannerInput::Fail()
+// ----------------------------------------------------------------------------
+//   Check if the input could not be opened or read
+// ----------------------------------------------------------------------------
+{
+    if (stream)
+        return stream->fail();
+    return failed;
+}
+
 ELFE_END
 
 #endif // SCANNER_H
@@ -41,6 +41,7 @@
 
 #include "serializer.h"
 #include "renderer.h"
+#include "tree-share.h"
 #include <sys/types.h> // Get BYTE_ORDER in a portable way
 #include <sys/param.h>
 
@@ -143,7 +144,7 @@ Tree *Serializer::DoText(Text *what)
 {
     WriteUnsigned(serialTEXT);
     WriteText(what->opening);
-    WriteText(what->value);
+    WriteText(what->Value());
     WriteText(what->closing);
     return what;
 }
@@ -210,6 +211,28 @@ Tree *Serializer::DoBlock(Block *what)
 }
 
 
+Tree *Serializer::DoArray(Array *what)
+// ----------------------------------------------------------------------------
+//   Serialize an array, writing unboxed numbers directly
+// ----------------------------------------------------------------------------
+{
+    WriteUnsigned(serialARRAY);
+    WriteUnsigned(what->packing);
+    size_t length = what->Length();
+    WriteUnsigned(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        switch(what->packing)
+        {
+        case Array::INTEGERS:   WriteSigned(what->integers[i]);  break;
+        case Array::REALS:      WriteReal(what->reals[i]);       break;
+        case Array::TREES:      WriteChild(what->trees[i]);      break;
+        }
+    }
+    return what;
+}
+
+
 void Serializer::WriteSigned(longlong value)
 // ----------------------------------------------------------------------------
 //   Write a signed longlong value (largest native machine type)
@@ -340,6 +363,8 @@ Tree *Deserializer::ReadTree()
     Tree *           right;
     Tree *           child;
     Tree *           result = NULL;
+    Array *          array;
+    ulonglong        packing, length;
 
     switch(tag)
     {
@@ -349,21 +374,22 @@ Tree *Deserializer::ReadTree()
 
     case serialINTEGER:
         ivalue = ReadSigned();
-        result = new Integer(ivalue, pos);
+        result = SharedLeaves::Share(new Integer(ivalue, pos));
         break;
     case serialREAL:
         rvalue = ReadReal();
-        result = new Real(rvalue, pos);
+        result = SharedLeaves::Share(new Real(rvalue, pos));
         break;
     case serialTEXT:
         opening = ReadText();
         tvalue = ReadText();
         closing = ReadText();
         result = new Text(tvalue, opening, closing, pos);
+        result = SharedLeaves::Share(result);
         break;
     case serialNAME:
         tvalue = ReadText();
-        result = new Name(tvalue, pos);
+        result = SharedLeaves::Share(new Name(tvalue, pos));
         break;
 
     case serialBLOCK:
@@ -389,6 +415,35 @@ Tree *Deserializer::ReadTree()
         result = new Postfix(left, right, pos);
         break;
 
+    case serialARRAY:
+        packing = ReadUnsigned();
+        length = ReadUnsigned();
+        result = array = new Array(pos);
+        for (ulonglong i = 0; i < length && in.good(); i++)
+        {
+            switch(packing)
+            {
+            case Array::INTEGERS:
+                array->integers.push_back(ReadSigned());
+                break;
+            case Array::REALS:
+                array->reals.push_back(ReadReal());
+                break;
+            case Array::TREES:
+                if (Tree *item = ReadTree())
+                    array->Append(item);
+                else
+                    in.setstate(in.failbit);
+                break;
+            default:
+                in.setstate(in.failbit);
+                break;
+            }
+        }
+        if (packing == Array::REALS)
+            array->packing = Array::REALS;
+        break;
+
     default:
         in.setstate(in.failbit);
     }
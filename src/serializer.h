@@ -57,6 +57,7 @@ enum SerializationTag
     serialINTEGER, serialREAL, serialTEXT, serialNAME,
     serialBLOCK, serialPREFIX, serialPOSTFIX, serialINFIX,
     serialINVALID,
+    serialARRAY,                // After INVALID to keep older tags stable
 
     serialVERSION = 0x0101,
     serialMAGIC   = 0x05121968
@@ -84,6 +85,7 @@ struct Serializer : Action
     Tree *      DoPostfix(Postfix *what);
     Tree *      DoInfix(Infix *what);
     Tree *      DoBlock(Block *what);
+    Tree *      DoArray(Array *what);
     Tree *      DoChild(Tree *child);
     Tree *      Do(Tree *what);
 
@@ -42,9 +42,108 @@
 #include "scanner.h"
 #include "tree.h"
 #include "errors.h"
+#include "utf8_fileutils.h"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
 
 ELFE_BEGIN
 
+// ============================================================================
+//
+//    Syntax files compiled in the binary
+//
+// ============================================================================
+//
+//  'make syntax-tables' runs 'elfe -syntax_tables' on elfe.syntax and
+//  C.syntax, which reads them with the scanner and prints their finished
+//  token tables and delimiters in syntax_tables.h. When the file found at
+//  runtime has the same contents, or when it cannot be found, reading the
+//  syntax uses these tables and does not need to scan it.
+
+struct CompiledDelimiter
+// ----------------------------------------------------------------------------
+//   A delimiter in a compiled syntax file
+// ----------------------------------------------------------------------------
+{
+    char                kind;           // Comment, Text, Block or Syntax
+    kstring             begin;          // Opening delimiter
+    kstring             end;            // Closing delimiter
+    kstring             child;          // File of the child syntax
+};
+
+
+struct CompiledSyntax
+// ----------------------------------------------------------------------------
+//   A syntax file compiled in the binary
+// ----------------------------------------------------------------------------
+{
+    kstring             name;           // Base name of the file
+    ulonglong           size;           // Size of the file for the tables
+    ulonglong           hash;           // Hash of the file for the tables
+    int                 default_priority;
+    int                 statement_priority;
+    int                 function_priority;
+    const CompiledDelimiter *delimiters;// Delimiters, ending with kind 0
+    uint                salt;           // Salt of the token hash
+    const TokenTable::Entry *entries;   // Token table slots
+    size_t              entryCount;     // Number of slots
+    const uint *        seeds;          // Seeds for each bucket
+    size_t              seedCount;      // Number of buckets, 0 if sorted
+};
+
+#include "syntax_tables.h"
+
+
+static ulonglong contentsHash(const text &contents)
+// ----------------------------------------------------------------------------
+//   FNV-1a hash of the contents of a syntax file
+// ----------------------------------------------------------------------------
+{
+    ulonglong hash = 0xCBF29CE484222325ULL;
+    for (text::const_iterator c = contents.begin(); c != contents.end(); c++)
+        hash = (hash ^ (uchar) *c) * 0x100000001B3ULL;
+    return hash;
+}
+
+
+static const CompiledSyntax *CompiledSyntaxFor(text filename)
+// ----------------------------------------------------------------------------
+//   Return the compiled syntax for a file, unless the file was changed
+// ----------------------------------------------------------------------------
+//   A file with the same size is read to compare its contents, as its date
+//   says nothing about the contents the tables were generated from
+{
+    size_t slash = filename.find_last_of("/\\");
+    text base = slash == filename.npos ? filename : filename.substr(slash+1);
+    for (const CompiledSyntax *compiled = compiled_syntaxes;
+         compiled->name;
+         compiled++)
+    {
+        if (base != compiled->name)
+            continue;
+
+        utf8_filestat_t st;
+        if (utf8_stat(filename.c_str(), &st) < 0)
+            return compiled;
+        if ((ulonglong) st.st_size != compiled->size)
+            return NULL;
+
+        utf8_ifstream file(filename.c_str(), std::ios::in|std::ios::binary);
+        if (file.fail())
+            return compiled;
+        text contents((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+        if (contentsHash(contents) == compiled->hash)
+            return compiled;
+        return NULL;
+    }
+    return NULL;
+}
+
+
+
 // ============================================================================
 // 
 //    Syntax used to parse trees
@@ -59,13 +158,8 @@ int Syntax::InfixPriority(text n)
 //   Return infix priority, which is either this or parent's
 // ----------------------------------------------------------------------------
 {
-    if (infix_priority.count(n))
-    {
-        int p = infix_priority[n];
-        if (p)
-            return p;
-    }
-    return default_priority;
+    int p = Lookup(n).infix;
+    return p ? p : default_priority;
 }
 
 
@@ -75,7 +169,11 @@ void Syntax::SetInfixPriority(text n, int p)
 // ----------------------------------------------------------------------------
 {
     if (p)
+    {
+        ExpandCompiled();
         infix_priority[n] = p;
+        tokens.valid = false;
+    }
 }
 
 
@@ -84,13 +182,8 @@ int Syntax::PrefixPriority(text n)
 //   Return prefix priority, which is either this or parent's
 // ----------------------------------------------------------------------------
 {
-    if (prefix_priority.count(n))
-    {
-        int p = prefix_priority[n];
-        if (p)
-            return p;
-    }
-    return default_priority;
+    int p = Lookup(n).prefix;
+    return p ? p : default_priority;
 }
 
 
@@ -100,7 +193,11 @@ void Syntax::SetPrefixPriority(text n, int p)
 // ----------------------------------------------------------------------------
 {
     if (p)
+    {
+        ExpandCompiled();
         prefix_priority[n] = p;
+        tokens.valid = false;
+    }
 }
 
 
@@ -109,13 +206,8 @@ int Syntax::PostfixPriority(text n)
 //   Return postfix priority, which is either this or parent's
 // ----------------------------------------------------------------------------
 {
-    if (postfix_priority.count(n))
-    {
-        int p = postfix_priority[n];
-        if (p)
-            return p;
-    }
-    return default_priority;
+    int p = Lookup(n).postfix;
+    return p ? p : default_priority;
 }
 
 
@@ -125,7 +217,31 @@ void Syntax::SetPostfixPriority(text n, int p)
 // ----------------------------------------------------------------------------
 {
     if (p)
+    {
+        ExpandCompiled();
         postfix_priority[n] = p;
+        tokens.valid = false;
+    }
+}
+
+
+const TokenTable::Entry &Syntax::Lookup(const text &n)
+// ----------------------------------------------------------------------------
+//   Find what the syntax knows about a token, rebuilding the hash if needed
+// ----------------------------------------------------------------------------
+{
+    if (!tokens.valid)
+        tokens.Build(*this);
+    return tokens.Find(n);
+}
+
+
+bool Syntax::KnownInfix(text n)
+// ----------------------------------------------------------------------------
+//   Check if the given name has an infix priority
+// ----------------------------------------------------------------------------
+{
+    return Lookup(n).infix != 0;
 }
 
 
@@ -134,7 +250,7 @@ bool Syntax::KnownToken(text n)
 //   Check if the given symbol is known in any of the priority tables
 // ----------------------------------------------------------------------------
 {
-    return known_tokens.count(n) > 0;
+    return Lookup(n).token;
 }
 
 
@@ -143,7 +259,22 @@ bool Syntax::KnownPrefix(text n)
 //   Check if the given symbol is a known prefix to a possible token
 // ----------------------------------------------------------------------------
 {
-    return known_prefixes.count(n) > 0;
+    return Lookup(n).prefix_of_token;
+}
+
+
+void Syntax::BuildTokenTables()
+// ----------------------------------------------------------------------------
+//   Build the token tables of this syntax and its child syntaxes if needed
+// ----------------------------------------------------------------------------
+//   Lookup builds them on demand, which is not safe while several threads
+//   are parsing with the same syntax
+{
+    if (!tokens.valid)
+        tokens.Build(*this);
+    subsyntax_table::iterator s;
+    for (s = subsyntax.begin(); s != subsyntax.end(); s++)
+        (*s).second.BuildTokenTables();
 }
 
 
@@ -254,7 +385,7 @@ Syntax *Syntax::HasSpecialSyntax(text Begin, text &End)
 }
 
 
-void Syntax::ReadSyntaxFile(Scanner &scanner, uint indents)
+void Syntax::ReadSyntaxFile(Scanner &input, uint indents)
 // ----------------------------------------------------------------------------
 //   Parse the syntax description table
 // ----------------------------------------------------------------------------
@@ -275,13 +406,14 @@ void Syntax::ReadSyntaxFile(Scanner &scanner, uint indents)
     bool        done = false;
     ChildSyntax *childSyntax = NULL;
 
+    ExpandCompiled();
     while(tok != tokEOF && !done)
     {
-        tok = scanner.NextToken(true);
+        tok = input.NextToken(true);
 
         if (tok == tokSYMBOL || state >= inComment)
         {
-            text t = scanner.TextValue();
+            text t = input.TextValue();
             uint i, len = t.length();
             for (i = 1; i < len; i++)
             {
@@ -296,7 +428,7 @@ void Syntax::ReadSyntaxFile(Scanner &scanner, uint indents)
         case tokEOF:
             break;
         case tokINTEGER:
-            priority = scanner.IntegerValue();
+            priority = input.IntegerValue();
             break;
         case tokINDENT:
         case tokPAROPEN:
@@ -312,7 +444,7 @@ void Syntax::ReadSyntaxFile(Scanner &scanner, uint indents)
         case tokSYMBOL:
         case tokSTRING:
         case tokQUOTE:
-            txt = scanner.TextValue();
+            txt = input.TextValue();
 
             if (txt == "NEWLINE")
                 txt = "\n";
@@ -411,6 +543,7 @@ void Syntax::ReadSyntaxFile(Scanner &scanner, uint indents)
             break;
         }
     }
+    tokens.valid = false;
 }
 
 
@@ -419,6 +552,9 @@ void Syntax::ReadSyntaxFile (text filename, uint indents)
 //   Read a syntax directly from a syntax file
 // ----------------------------------------------------------------------------
 {
+    if (ReadCompiled(filename))
+        return;
+
     Syntax    baseSyntax;
     Positions basePositions;
     Errors    errors;
@@ -426,4 +562,523 @@ void Syntax::ReadSyntaxFile (text filename, uint indents)
     ReadSyntaxFile(scanner, indents);
 }
 
+
+bool Syntax::ReadCompiled(text filename)
+// ----------------------------------------------------------------------------
+//   Take an empty syntax from the tables compiled in the binary if possible
+// ----------------------------------------------------------------------------
+{
+    const CompiledSyntax *compiled = CompiledSyntaxFor(filename);
+    if (!compiled || tokens.Compiled() ||
+        !infix_priority.empty() || !prefix_priority.empty() ||
+        !postfix_priority.empty() || !known_tokens.empty())
+        return false;
+
+    default_priority = compiled->default_priority;
+    statement_priority = compiled->statement_priority;
+    function_priority = compiled->function_priority;
+
+    for (const CompiledDelimiter *d = compiled->delimiters; d->kind; d++)
+    {
+        switch(d->kind)
+        {
+        case 'C':
+            comment_delimiters[d->begin] = d->end;
+            break;
+        case 'T':
+            text_delimiters[d->begin] = d->end;
+            break;
+        case 'B':
+            block_delimiters[d->begin] = d->end;
+            break;
+        case 'S':
+        {
+            text child = d->child;
+            if (child.find("/") == child.npos)
+                child = ELFE_LIB + child;
+            ChildSyntax *childSyntax = &subsyntax[child];
+            if (childSyntax->filename == "")
+            {
+                childSyntax->filename = child;
+                childSyntax->ReadSyntaxFile(child);
+            }
+            childSyntax->delimiters[d->begin] = d->end;
+            subsyntax_file[d->begin] = child;
+            break;
+        }
+        }
+    }
+
+    tokens.Use(compiled);
+    return true;
+}
+
+
+void Syntax::ExpandCompiled()
+// ----------------------------------------------------------------------------
+//   Before changing a compiled syntax, copy its tokens into the tables
+// ----------------------------------------------------------------------------
+{
+    const CompiledSyntax *compiled = tokens.Compiled();
+    if (!compiled)
+        return;
+
+    for (size_t i = 0; i < compiled->entryCount; i++)
+    {
+        const TokenTable::Entry &entry = compiled->entries[i];
+        if (!*entry.name)
+            continue;
+        if (entry.infix)
+            infix_priority[entry.name] = entry.infix;
+        if (entry.prefix)
+            prefix_priority[entry.name] = entry.prefix;
+        if (entry.postfix)
+            postfix_priority[entry.name] = entry.postfix;
+        if (entry.token)
+            known_tokens.insert(entry.name);
+        if (entry.prefix_of_token)
+            known_prefixes.insert(entry.name);
+    }
+    tokens.Use(NULL);
+}
+
+
+static text compiledText(kstring value)
+// ----------------------------------------------------------------------------
+//   Quote a name as a C string literal
+// ----------------------------------------------------------------------------
+{
+    std::ostringstream out;
+    out << '"';
+    for (kstring p = value; *p; p++)
+    {
+        uchar c = *p;
+        if (c == '\\' || c == '"' || c == '?')
+            out << '\\' << c;
+        else if (c == '\n')
+            out << "\\n";
+        else if (c < ' ' || c >= 0x7F)
+            out << '\\' << char('0' + (c >> 6))
+                << char('0' + ((c >> 3) & 7)) << char('0' + (c & 7));
+        else
+            out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+
+static void printDelimiters(std::ostream &out, char kind,
+                            delimiter_table &table, text child = "")
+// ----------------------------------------------------------------------------
+//   Print the entries of a delimiter table for a compiled syntax
+// ----------------------------------------------------------------------------
+{
+    text childText = child == "" ? "NULL" : compiledText(child.c_str());
+    delimiter_table::iterator d;
+    for (d = table.begin(); d != table.end(); d++)
+        out << "    { '" << kind << "', "
+            << compiledText((*d).first.c_str()) << ", "
+            << compiledText((*d).second.c_str()) << ", "
+            << childText << " },\n";
+}
+
+
+int Syntax::PrintTables(std::ostream &out, std::vector<text> &files)
+// ----------------------------------------------------------------------------
+//   Print syntax files as tables that the build compiles in the binary
+// ----------------------------------------------------------------------------
+//   The files are always read with the scanner, never from compiled tables
+{
+    std::ostringstream records;
+    out << "// Generated by 'make syntax-tables', do not edit\n\n";
+
+    for (uint f = 0; f < files.size(); f++)
+    {
+        text file = files[f];
+        utf8_filestat_t st;
+        utf8_ifstream input(file.c_str(), std::ios::in|std::ios::binary);
+        if (utf8_stat(file.c_str(), &st) < 0 || input.fail())
+        {
+            std::cerr << "Cannot read syntax file " << file << "\n";
+            return 1;
+        }
+        text contents((std::istreambuf_iterator<char>(input)),
+                      std::istreambuf_iterator<char>());
+
+        Syntax    syntax;
+        Syntax    baseSyntax;
+        Positions positions;
+        Errors    errors;
+        Scanner   scanner(file.c_str(), baseSyntax, positions, errors);
+        syntax.ReadSyntaxFile(scanner);
+        if (errors.HadErrors())
+            return 1;
+        syntax.tokens.Build(syntax);
+
+        size_t slash = file.find_last_of("/\\");
+        text base = slash == file.npos ? file : file.substr(slash + 1);
+        text name = base;
+        for (uint i = 0; i < name.length(); i++)
+            if (!isalnum(name[i]))
+                name[i] = '_';
+
+        syntax.tokens.Print(out, name);
+
+        out << "static const CompiledDelimiter " << name
+            << "_delimiters[] =\n{\n";
+        printDelimiters(out, 'C', syntax.comment_delimiters);
+        printDelimiters(out, 'T', syntax.text_delimiters);
+        printDelimiters(out, 'B', syntax.block_delimiters);
+        subsyntax_table::iterator s;
+        for (s = syntax.subsyntax.begin(); s != syntax.subsyntax.end(); s++)
+        {
+            text child = (*s).second.filename;
+            text lib = ELFE_LIB;
+            if (child.compare(0, lib.length(), lib) == 0)
+                child = child.substr(lib.length());
+            printDelimiters(out, 'S', (*s).second.delimiters, child);
+        }
+        out << "    { 0, NULL, NULL, NULL }\n};\n\n";
+
+        records << "    { " << compiledText(base.c_str()) << ", "
+                << (ulonglong) st.st_size << "ULL, "
+                << "0x" << std::hex << contentsHash(contents)
+                << std::dec << "ULL, "
+                << syntax.default_priority << ", "
+                << syntax.statement_priority << ", "
+                << syntax.function_priority << ",\n"
+                << "      " << name << "_delimiters,\n      ";
+        syntax.tokens.PrintReference(records, name);
+        records << " },\n";
+    }
+
+    out << "static const CompiledSyntax compiled_syntaxes[] =\n{\n"
+        << records.str()
+        << "    { NULL }\n};\n";
+    return 0;
+}
+
+
+// ============================================================================
+//
+//    Perfect hash of known tokens
+//
+// ============================================================================
+
+static const TokenTable::Entry unknownToken = { "", 0, 0, 0, false, false };
+
+
+TokenTable::TokenTable()
+// ----------------------------------------------------------------------------
+//   An empty table, built on first use
+// ----------------------------------------------------------------------------
+    : valid(false), compiled(NULL), salt(0)
+{}
+
+
+TokenTable::TokenTable(const TokenTable &o)
+// ----------------------------------------------------------------------------
+//   Copy a table, which must be rebuilt unless it is compiled in the binary
+// ----------------------------------------------------------------------------
+//   Built entries point to the keys of the maps in the original syntax
+    : valid(o.compiled != NULL), compiled(o.compiled), salt(o.salt)
+{}
+
+
+TokenTable &TokenTable::operator=(const TokenTable &o)
+// ----------------------------------------------------------------------------
+//   Assign a table, which must be rebuilt unless it is compiled in the binary
+// ----------------------------------------------------------------------------
+{
+    compiled = o.compiled;
+    salt = o.salt;
+    seeds.clear();
+    entries.clear();
+    valid = compiled != NULL;
+    return *this;
+}
+
+
+static bool entryBefore(const TokenTable::Entry &a, const TokenTable::Entry &b)
+// ----------------------------------------------------------------------------
+//   Order entries by name
+// ----------------------------------------------------------------------------
+{
+    return strcmp(a.name, b.name) < 0;
+}
+
+
+void TokenTable::Build(Syntax &syntax)
+// ----------------------------------------------------------------------------
+//   Collect what the syntax knows about each token and lay out the table
+// ----------------------------------------------------------------------------
+//   If no salt of the hash gives a perfect table, for instance because two
+//   names have the same 64-bit hash, the names stay sorted and Find uses
+//   a binary search instead.
+{
+    // Sort the names from all the tables, then merge entries for a name
+    std::vector<Entry> all, names;
+    priority_table::iterator p;
+    token_set::iterator t;
+    for (p = syntax.infix_priority.begin();
+         p != syntax.infix_priority.end(); p++)
+    {
+        Entry entry = { p->first.c_str(), p->second, 0, 0, false, false };
+        all.push_back(entry);
+    }
+    for (p = syntax.prefix_priority.begin();
+         p != syntax.prefix_priority.end(); p++)
+    {
+        Entry entry = { p->first.c_str(), 0, p->second, 0, false, false };
+        all.push_back(entry);
+    }
+    for (p = syntax.postfix_priority.begin();
+         p != syntax.postfix_priority.end(); p++)
+    {
+        Entry entry = { p->first.c_str(), 0, 0, p->second, false, false };
+        all.push_back(entry);
+    }
+    for (t = syntax.known_tokens.begin(); t != syntax.known_tokens.end(); t++)
+    {
+        Entry entry = { t->c_str(), 0, 0, 0, true, false };
+        all.push_back(entry);
+    }
+    for (t = syntax.known_prefixes.begin();
+         t != syntax.known_prefixes.end(); t++)
+    {
+        Entry entry = { t->c_str(), 0, 0, 0, false, true };
+        all.push_back(entry);
+    }
+    std::stable_sort(all.begin(), all.end(), entryBefore);
+
+    for (size_t a = 0; a < all.size(); a++)
+    {
+        if (names.empty() || strcmp(names.back().name, all[a].name) != 0)
+        {
+            names.push_back(all[a]);
+            continue;
+        }
+        Entry &entry = names.back();
+        entry.infix = std::max(entry.infix, all[a].infix);
+        entry.prefix = std::max(entry.prefix, all[a].prefix);
+        entry.postfix = std::max(entry.postfix, all[a].postfix);
+        entry.token |= all[a].token;
+        entry.prefix_of_token |= all[a].prefix_of_token;
+    }
+
+    compiled = NULL;
+    valid = true;
+    for (salt = 0; salt < MAX_SALTS; salt++)
+        if (Layout(names, salt))
+            return;
+
+    salt = 0;
+    seeds.clear();
+    entries.swap(names);
+}
+
+
+bool TokenTable::Layout(std::vector<Entry> &names, uint salt)
+// ----------------------------------------------------------------------------
+//   Try to place the names in a perfect hash table with the given salt
+// ----------------------------------------------------------------------------
+//   The table has at least twice as many slots as names, and there are
+//   about four names per bucket. Buckets are placed largest first, each
+//   trying seeds until its names all land in free slots. If that fails,
+//   the table doubles a few times before giving up on this salt.
+{
+    std::vector<ulonglong> hashes;
+    for (size_t n = 0; n < names.size(); n++)
+        hashes.push_back(Hash(names[n].name, salt));
+
+    // Names with the same hash can never land in different slots
+    std::vector<ulonglong> sorted(hashes);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        return false;
+
+    size_t size = 8;
+    while (size < 2 * names.size())
+        size *= 2;
+
+    for (uint doubling = 0; doubling < MAX_DOUBLINGS; doubling++, size *= 2)
+    {
+        // Distribute the names in buckets, and sort largest buckets first
+        size_t count = size / 8;
+        std::vector< std::vector<ulonglong> > buckets(count);
+        std::vector< std::pair<size_t, size_t> > order;
+        for (size_t n = 0; n < names.size(); n++)
+            buckets[hashes[n] & (count-1)].push_back(hashes[n]);
+        for (size_t b = 0; b < count; b++)
+            order.push_back(std::make_pair(buckets[b].size(), b));
+        std::sort(order.rbegin(), order.rend());
+
+        // Find a seed for each bucket
+        std::vector<bool> taken(size, false);
+        bool placed = true;
+        seeds.assign(count, 0);
+        for (size_t o = 0; o < count && placed; o++)
+        {
+            size_t b = order[o].second;
+            uint seed = 0;
+            while (seed < MAX_SEEDS && !Place(buckets[b], seed, taken))
+                seed++;
+            seeds[b] = seed;
+            placed = seed < MAX_SEEDS;
+        }
+        if (!placed)
+            continue;
+
+        // Copy the entries to their slots
+        entries.assign(size, unknownToken);
+        for (size_t n = 0; n < names.size(); n++)
+        {
+            uint seed = seeds[hashes[n] & (count-1)];
+            entries[Slot(hashes[n], seed) & (size-1)] = names[n];
+        }
+        return true;
+    }
+    seeds.clear();
+    return false;
+}
+
+
+void TokenTable::Use(const CompiledSyntax *table)
+// ----------------------------------------------------------------------------
+//   Use a table compiled in the binary, or rebuild on next use if NULL
+// ----------------------------------------------------------------------------
+{
+    compiled = table;
+    salt = table ? table->salt : 0;
+    seeds.clear();
+    entries.clear();
+    valid = table != NULL;
+}
+
+
+const TokenTable::Entry &TokenTable::Find(const text &name)
+// ----------------------------------------------------------------------------
+//   Return the entry for a name, or an empty entry if the name is unknown
+// ----------------------------------------------------------------------------
+{
+    const Entry *table = compiled ? compiled->entries : entries.data();
+    size_t size = compiled ? compiled->entryCount : entries.size();
+    const uint *seed = compiled ? compiled->seeds : seeds.data();
+    size_t count = compiled ? compiled->seedCount : seeds.size();
+    if (!size)
+        return unknownToken;
+
+    if (count)
+    {
+        ulonglong hash = Hash(name, salt);
+        const Entry &entry =
+            table[Slot(hash, seed[hash & (count-1)]) & (size-1)];
+        return name == entry.name ? entry : unknownToken;
+    }
+
+    // No perfect hash for these names, search the sorted names
+    size_t low = 0, high = size;
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+        int cmp = strcmp(table[mid].name, name.c_str());
+        if (cmp == 0)
+            return table[mid];
+        if (cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return unknownToken;
+}
+
+
+void TokenTable::Print(std::ostream &out, text name)
+// ----------------------------------------------------------------------------
+//   Print the entries and seeds as C arrays for a compiled syntax
+// ----------------------------------------------------------------------------
+{
+    if (!valid)
+        return;
+    out << "static const TokenTable::Entry " << name << "_entries[] =\n{\n";
+    for (size_t e = 0; e < entries.size(); e++)
+    {
+        const Entry &entry = entries[e];
+        out << "    { " << compiledText(entry.name) << ", "
+            << entry.infix << ", " << entry.prefix << ", "
+            << entry.postfix << ", "
+            << (entry.token ? "true" : "false") << ", "
+            << (entry.prefix_of_token ? "true" : "false") << " },\n";
+    }
+    if (entries.empty())
+        out << "    { \"\", 0, 0, 0, false, false }\n";
+    out << "};\n\n";
+
+    out << "static const uint " << name << "_seeds[] =\n{";
+    for (size_t s = 0; s < seeds.size(); s++)
+        out << (s % 8 ? " " : "\n    ") << seeds[s] << ",";
+    if (seeds.empty())
+        out << "\n    0";
+    out << "\n};\n\n";
+}
+
+
+void TokenTable::PrintReference(std::ostream &out, text name)
+// ----------------------------------------------------------------------------
+//   Print the fields of a compiled syntax that refer to the printed arrays
+// ----------------------------------------------------------------------------
+{
+    out << salt << ", "
+        << name << "_entries, " << entries.size() << ", "
+        << name << "_seeds, " << seeds.size();
+}
+
+
+ulonglong TokenTable::Hash(const text &name, uint salt)
+// ----------------------------------------------------------------------------
+//   FNV-1a hash of a name, starting from a basis that depends on the salt
+// ----------------------------------------------------------------------------
+{
+    ulonglong hash = 0xCBF29CE484222325ULL + salt * 0x9E3779B97F4A7C15ULL;
+    for (text::const_iterator c = name.begin(); c != name.end(); c++)
+        hash = (hash ^ (uchar) *c) * 0x100000001B3ULL;
+    return hash;
+}
+
+
+ulonglong TokenTable::Slot(ulonglong hash, uint seed)
+// ----------------------------------------------------------------------------
+//   Mix the seed of the bucket into the hash to find a slot
+// ----------------------------------------------------------------------------
+{
+    ulonglong x = hash + (seed + 1) * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+
+bool TokenTable::Place(std::vector<ulonglong> &bucket, uint seed,
+                       std::vector<bool> &taken)
+// ----------------------------------------------------------------------------
+//   Mark the slots for a bucket of hashes as taken if they are all free
+// ----------------------------------------------------------------------------
+{
+    size_t mask = taken.size() - 1;
+    size_t i, count = bucket.size();
+    for (i = 0; i < count; i++)
+    {
+        size_t slot = Slot(bucket[i], seed) & mask;
+        if (taken[slot])
+            break;
+        taken[slot] = true;
+    }
+    if (i == count)
+        return true;
+    while (i--)
+        taken[Slot(bucket[i], seed) & mask] = false;
+    return false;
+}
+
 ELFE_END
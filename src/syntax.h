@@ -40,12 +40,15 @@
 
 #include <map>
 #include <set>
+#include <vector>
+#include <iostream>
 #include "base.h"
 
 ELFE_BEGIN
 
 struct Tree;
 struct Scanner;
+struct Syntax;
 struct ChildSyntax;
 
 typedef std::map<text, int>             priority_table;
@@ -54,6 +57,55 @@ typedef std::map<text, ChildSyntax>     subsyntax_table;
 typedef std::set<text>                  token_set;
 
 
+struct CompiledSyntax;                          // Syntax file in the binary
+
+
+struct TokenTable
+// ----------------------------------------------------------------------------
+//   Perfect hash of the tokens known to a syntax
+// ----------------------------------------------------------------------------
+//   Looking up a name costs one hash and one probe, whether it is known
+//   or not. Each bucket of names has a seed chosen when building the table
+//   so that no two names in the syntax land in the same slot. The table is
+//   either built from the syntax maps, or compiled in the binary.
+{
+    struct Entry
+    {
+        kstring         name;           // Name, "" for empty slots
+        int             infix;          // Infix priority, 0 if none
+        int             prefix;         // Prefix priority, 0 if none
+        int             postfix;        // Postfix priority, 0 if none
+        bool            token;          // Known token
+        bool            prefix_of_token;// Start of a longer known token
+    };
+
+    TokenTable();
+    TokenTable(const TokenTable &o);
+    TokenTable &operator=(const TokenTable &o);
+
+    void                Build(Syntax &syntax);
+    void                Use(const CompiledSyntax *compiled);
+    const Entry &       Find(const text &name);
+    const CompiledSyntax *Compiled()    { return compiled; }
+    void                Print(std::ostream &out, text name);
+    void                PrintReference(std::ostream &out, text name);
+    bool                valid;          // Built from the current tables
+
+private:
+    enum { MAX_SALTS = 8, MAX_DOUBLINGS = 4, MAX_SEEDS = 65536 };
+    static ulonglong    Hash(const text &name, uint salt);
+    static ulonglong    Slot(ulonglong hash, uint seed);
+    static bool         Place(std::vector<ulonglong> &bucket, uint seed,
+                              std::vector<bool> &taken);
+    bool                Layout(std::vector<Entry> &names, uint salt);
+
+    const CompiledSyntax *compiled;     // Compiled table in use, if any
+    uint                salt;           // Salt of the hash for this table
+    std::vector<uint>   seeds;          // Seed for each bucket, empty if none
+    std::vector<Entry>  entries;        // Slots, or sorted names if no seeds
+};
+
+
 struct Syntax
 // ----------------------------------------------------------------------------
 //   This is the execution environment for all trees
@@ -84,8 +136,12 @@ public:
     void                SetPrefixPriority(text n, int p);
     int                 PostfixPriority(text n);
     void                SetPostfixPriority(text n, int p);
+    bool                KnownInfix(text n);
     bool                KnownToken(text n);
     bool                KnownPrefix(text n);
+    void                BuildTokenTables();
+    static int          PrintTables(std::ostream &out,
+                                    std::vector<text> &files);
 
     // Read a complete syntax file (elfe.syntax)
     void                ReadSyntaxFile (Scanner &scanner, uint indents = 1);
@@ -102,6 +158,11 @@ public:
     bool                IsBlock(char Begin, text &end);
     Syntax *            HasSpecialSyntax(text Begin, text &end);
 
+private:
+    const TokenTable::Entry &Lookup(const text &n);
+    bool                ReadCompiled(text filename);
+    void                ExpandCompiled();
+
 public:
     priority_table      infix_priority;
     priority_table      prefix_priority;
@@ -113,6 +174,7 @@ public:
     subsyntax_table     subsyntax;
     token_set           known_tokens;
     token_set           known_prefixes;
+    TokenTable          tokens;
     int                 priority;
 
     int                 default_priority;
@@ -0,0 +1,706 @@
+// Generated by 'make syntax-tables', do not edit
+
+static const TokenTable::Entry elfe_syntax_entries[] =
+{
+    { "", 0, 0, 0, false, false },
+    { "constant", 0, 350, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "not", 0, 350, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "^=", 85, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "inch", 0, 0, 400, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "ensure", 50, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "*/", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "const", 0, 350, 0, false, false },
+    { "..", 280, 0, 0, true, false },
+    { "SYNTA", 0, 0, 0, false, true },
+    { "e", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "->", 21, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "<<", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "=>", 21, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "m", 0, 0, 400, false, false },
+    { "into", 31, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "*", 320, 370, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "by", 280, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "|", 300, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "NE", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "COMM", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "ext", 0, 0, 0, false, true },
+    { "T", 0, 0, 0, false, true },
+    { "CO", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "I-", 5, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "+", 310, 370, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "h", 0, 0, 400, false, false },
+    { "when", 211, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ":", 600, 0, 0, true, true },
+    { "extern", 0, 0, 0, true, false },
+    { "NEWLIN", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "\n\n", 0, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "\n\n\n", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "SY", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "//", 0, 0, 0, true, false },
+    { "500", 0, 0, 0, true, false },
+    { "-", 310, 370, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "to", 271, 410, 0, false, false },
+    { "=", 290, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "/=", 85, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "rem", 320, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "%", 0, 0, 400, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "exte", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "px", 0, 0, 400, false, false },
+    { "yield", 0, 121, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "us", 0, 0, 400, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "~", 0, 360, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "/", 320, 370, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "NEWLINE", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "+=", 85, 0, 0, true, false },
+    { "&=", 85, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "&", 300, 430, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "while", 40, 40, 0, false, false },
+    { "written", 120, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "ashr", 330, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "--", 0, 420, 420, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "else", 31, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ">=", 290, 0, 0, true, false },
+    { "loop", 40, 40, 0, false, false },
+    { "SYNTAX", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "with", 75, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "SYN", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "then", 50, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "UNINDENT", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "exter", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "[", 500, 0, 0, true, false },
+    { "type", 0, 410, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "COM", 0, 0, 0, false, true },
+    { "NEW", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "N", 0, 0, 0, false, true },
+    { "INDE", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "SYNT", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "<", 290, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "cm", 0, 0, 400, false, false },
+    { "UNINDEN", 0, 0, 0, false, true },
+    { "TE", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "or", 250, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ".", 480, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "-=", 85, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "U", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "pt", 0, 0, 400, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "NEWLI", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "function", 0, 410, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "mm", 0, 0, 400, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "I+", 5, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "in", 260, 350, 0, false, false },
+    { ">", 290, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "50", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "]", 500, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "\?", 0, 0, 400, true, false },
+    { "<=", 290, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { ")", 500, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "{", 25, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "\n", 11, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "IN", 0, 0, 0, false, true },
+    { "!=", 290, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "ms", 0, 0, 400, false, false },
+    { "", 0, 0, 0, false, false },
+    { "NEWL", 0, 0, 0, false, true },
+    { "variable", 0, 350, 0, false, false },
+    { "until", 40, 40, 0, false, false },
+    { "|=", 85, 0, 0, true, false },
+    { ";", 61, 0, 0, true, false },
+    { "lshr", 330, 0, 0, false, false },
+    { "INDENT", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "is", 110, 0, 0, false, false },
+    { "25", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "UNINDE", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "out", 0, 350, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ">>", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "C", 0, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "UNI", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "var", 0, 350, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "^", 381, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "*=", 85, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "++", 0, 420, 420, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ":=", 85, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "s", 0, 0, 400, false, false },
+    { "", 0, 0, 0, false, false },
+    { "and", 250, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "TEX", 0, 0, 0, false, true },
+    { "COMME", 0, 0, 0, false, true },
+    { "S", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "as", 75, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "COMMEN", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "IND", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "2", 0, 0, 0, false, true },
+    { "data", 0, 30, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "!", 0, 360, 400, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "shl", 330, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "iterator", 0, 410, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "5", 0, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "case", 0, 121, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "COMMENT", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "at", 260, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "<>", 290, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "property", 0, 50, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "UN", 0, 0, 0, false, true },
+    { "transform", 0, 121, 0, false, false },
+    { "(", 500, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "if", 0, 121, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "INDEN", 0, 0, 0, false, true },
+    { "}", 25, 0, 0, true, false },
+    { "I", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "xor", 250, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "return", 240, 121, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "UNIN", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "where", 130, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ",", 231, 0, 0, true, false },
+    { "mod", 320, 0, 0, false, false },
+    { "TEXT", 0, 0, 0, true, false },
+    { "of", 271, 0, 0, false, false },
+    { "ex", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "require", 50, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "/*", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "contains", 260, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "UNIND", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "procedure", 0, 410, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+};
+
+static const uint elfe_syntax_seeds[] =
+{
+    0, 0, 2, 0, 1, 0, 3, 0,
+    0, 0, 2, 0, 4, 0, 3, 1,
+    0, 0, 0, 0, 0, 0, 1, 1,
+    0, 0, 1, 0, 0, 0, 0, 0,
+    1, 1, 0, 0, 0, 0, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 3, 0, 2, 0, 0, 1,
+    0, 0, 0, 1, 0, 0, 0, 0,
+};
+
+static const CompiledDelimiter elfe_syntax_delimiters[] =
+{
+    { 'C', "/*", "*/", NULL },
+    { 'C', "//", "\n", NULL },
+    { 'T', "<<", ">>", NULL },
+    { 'B', "(", ")", NULL },
+    { 'B', ")", "", NULL },
+    { 'B', "I+", "I-", NULL },
+    { 'B', "I-", "", NULL },
+    { 'B', "[", "]", NULL },
+    { 'B', "]", "", NULL },
+    { 'B', "{", "}", NULL },
+    { 'B', "}", "", NULL },
+    { 'S', "extern", ";", "C.syntax" },
+    { 0, NULL, NULL, NULL }
+};
+
+static const TokenTable::Entry C_syntax_entries[] =
+{
+    { "signed", 0, 450, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "NEWLI", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "COMMEN", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "50", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "*/", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "..", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "5", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "\n", 0, 0, 0, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "COMMENT", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, true, false },
+    { "COMME", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "*", 0, 0, 100, true, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "NEWL", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "short", 0, 450, 0, false, false },
+    { "NE", 0, 0, 0, false, true },
+    { "COM", 0, 0, 0, false, true },
+    { "NEW", 0, 0, 0, false, true },
+    { "unsigned", 0, 450, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "N", 0, 0, 0, false, true },
+    { "CO", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "COMM", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "C", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "extern", 0, 30, 0, false, false },
+    { "\n\n", 0, 0, 0, true, false },
+    { ".", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "//", 0, 0, 0, true, false },
+    { "500", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ",", 41, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "]", 500, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "NEWLIN", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { ")", 500, 0, 0, true, false },
+    { "long", 0, 450, 0, false, false },
+    { "/*", 0, 0, 0, true, false },
+    { "(", 500, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "[", 500, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "", 0, 0, 0, false, false },
+    { "/", 0, 0, 0, false, true },
+    { "", 0, 0, 0, false, false },
+    { "NEWLINE", 0, 0, 0, true, false },
+    { "", 0, 0, 0, false, false },
+    { "...", 0, 30, 0, true, false },
+};
+
+static const uint C_syntax_seeds[] =
+{
+    0, 0, 0, 0, 4, 0, 1, 0,
+    0, 1, 0, 0, 0, 0, 0, 0,
+};
+
+static const CompiledDelimiter C_syntax_delimiters[] =
+{
+    { 'C', "/*", "*/", NULL },
+    { 'C', "//", "\n", NULL },
+    { 'B', "(", ")", NULL },
+    { 'B', ")", "", NULL },
+    { 'B', "[", "]", NULL },
+    { 'B', "]", "", NULL },
+    { 0, NULL, NULL, NULL }
+};
+
+static const CompiledSyntax compiled_syntaxes[] =
+{
+    { "elfe.syntax", 1341ULL, 0x5052f42fd9196d47ULL, 200, 100, 401,
+      elfe_syntax_delimiters,
+      0, elfe_syntax_entries, 512, elfe_syntax_seeds, 64 },
+    { "C.syntax", 241ULL, 0x7c79785b6a353991ULL, 0, 100, 400,
+      C_syntax_delimiters,
+      0, C_syntax_entries, 128, C_syntax_seeds, 16 },
+    { NULL }
+};
@@ -0,0 +1,70 @@
+#include "tree.h"
+#include <iostream>
+#include <cassert>
+
+using namespace ELFE;
+
+static uint deleted = 0;
+
+struct TestOpcode : Info
+{
+    ~TestOpcode()               { deleted++; }
+    INFO_SLOT(TestOpcode, OPCODE_SLOT);
+};
+
+struct TestTypeCheck : TestOpcode
+{
+    // Like TypeCheckOpcode, found both as an opcode and as a type check
+    enum { SLOT = Info::TYPECHECK_SLOT };
+    typedef TestTypeCheck slot_t;
+    virtual uint Slots()
+    {
+        return (1U << Info::OPCODE_SLOT) | (1U << Info::TYPECHECK_SLOT);
+    }
+};
+
+struct TestOther : Info
+{
+    ~TestOther()                { deleted++; }
+};
+
+
+int main()
+{
+    // Replace the opcode on a typechecked tree, then remove the new opcode
+    Name_p tree = new Name("integer");
+    TestTypeCheck *check = new TestTypeCheck;
+    TestOpcode *opcode = new TestOpcode;
+    tree->SetInfo<TestTypeCheck>(check);
+    tree->SetInfo<TestOpcode>(opcode);
+    assert(tree->GetInfo<TestOpcode>() == opcode);
+    assert(tree->GetInfo<TestTypeCheck>() == check);
+    assert(tree->Remove<TestOpcode>(opcode) == opcode);
+    assert(tree->GetInfo<TestOpcode>() == check);
+    assert(tree->GetInfo<TestTypeCheck>() == check);
+    delete opcode;
+    assert(tree->Purge<TestTypeCheck>());
+    assert(!tree->GetInfo<TestOpcode>());
+    assert(deleted == 2);
+    tree = NULL;
+    for (uint i = 0; i < 3; i++)
+    {
+        GarbageCollector::MustRun();
+        GarbageCollector::SafePoint();
+    }
+
+    // Each info is deleted once with the slots, even when displaced
+    deleted = 0;
+    {
+        InfoSlots slots;
+        slots.Insert(new TestTypeCheck);
+        slots.Insert(new TestOpcode);
+        slots.Insert(new TestOther);
+        slots.Insert(new TestTypeCheck);
+        assert(slots.Find<TestOther>());
+    }
+    assert(deleted == 4);
+
+    std::cerr << "Info slots OK\n";
+    return 0;
+}
@@ -40,6 +40,7 @@
 // ****************************************************************************
 
 #include "tree.h"
+#include "save.h"
 
 ELFE_BEGIN
 
@@ -83,7 +84,7 @@ public:
     }
     Tree *DoText(Text *what)
     {
-        return Adjust(what, new Text(what->value,
+        return Adjust(what, new Text(what->Value(),
                                      what->opening, what->closing, 
                                      what->Position()));
     }
@@ -114,6 +115,14 @@ public:
         return Adjust(what, new Postfix(Clone(what->left), Clone(what->right),
                                         what->Position()));
     }
+    Tree *DoArray(Array *what)
+    {
+        Array *copy = new Array(what);
+        for (TreeList::iterator i = copy->trees.begin();
+             i != copy->trees.end(); i++)
+            *i = Clone(*i);
+        return Adjust(what, copy);
+    }
 
 };
 
@@ -194,7 +203,7 @@ template <CopyMode mode> struct TreeCopyTemplate
 //   Copy a tree into another tree. Node values are copied, infos are not.
 // ----------------------------------------------------------------------------
 {
-    TreeCopyTemplate(Tree *dest): dest(dest) {}
+    TreeCopyTemplate(Tree *dest): dest(dest), parent(NULL), slot(NULL) {}
     ~TreeCopyTemplate() {}
 
     typedef Tree *value_type;
@@ -203,6 +212,15 @@ template <CopyMode mode> struct TreeCopyTemplate
     {
         if (Integer *it = dest->AsInteger())
         {
+            // Integers may be shared from the pool, so replace them
+            if (slot)
+            {
+                slot->Set(parent, new Integer(what->value,
+                                              what->Position()));
+                return what;
+            }
+            if (it->IsPooled())
+                return NULL;
             it->value = what->value;
             it->tag = ((what->Position()<<Tree::KINDBITS) | it->Kind());
             return what;
@@ -223,7 +241,7 @@ template <CopyMode mode> struct TreeCopyTemplate
     {
         if (Text *tt = dest->AsText())
         {
-            tt->value = what->value;
+            tt->Value() = what->Value();
             tt->tag = ((what->Position()<<Tree::KINDBITS) | tt->Kind());
             return what;
         }
@@ -239,6 +257,19 @@ template <CopyMode mode> struct TreeCopyTemplate
         }
         return NULL;
     }
+    Tree *DoArray(Array *what)
+    {
+        if (Array *at = dest->AsArray())
+        {
+            at->packing = what->packing;
+            at->integers = what->integers;
+            at->reals = what->reals;
+            at->trees = what->trees;
+            at->tag = ((what->Position()<<Tree::KINDBITS) | at->Kind());
+            return what;
+        }
+        return NULL;
+    }
 
     Tree *DoBlock(Block *what)
     {
@@ -248,12 +279,7 @@ template <CopyMode mode> struct TreeCopyTemplate
             bt->closing = what->closing;
             bt->tag = ((what->Position()<<Tree::KINDBITS) | bt->Kind());
             if (mode == CM_RECURSIVE)
-            {
-                dest = bt->child;
-                Tree *  br = what->child->Do(this);
-                dest = bt;
-                return br;
-            }
+                return Child(what->child, bt->child);
             return what;
         }
         return NULL;
@@ -265,18 +291,9 @@ template <CopyMode mode> struct TreeCopyTemplate
             it->name = what->name;
             it->tag = ((what->Position()<<Tree::KINDBITS) | it->Kind());
             if (mode == CM_RECURSIVE)
-            {
-                dest = it->left;
-                Tree *lr = what->left->Do(this);
-                dest = it;
-                if (!lr)
-                    return NULL;
-                dest = it->right;
-                Tree *rr = what->right->Do(this);
-                dest = it;
-                if (!rr)
+                if (!Child(what->left, it->left) ||
+                    !Child(what->right, it->right))
                     return NULL;
-            }
             return what;
         }
         return NULL;
@@ -287,18 +304,9 @@ template <CopyMode mode> struct TreeCopyTemplate
         {
             pt->tag = ((what->Position()<<Tree::KINDBITS) | pt->Kind());
             if (mode == CM_RECURSIVE)
-            {
-                dest = pt->left;
-                Tree *lr = what->left->Do(this);
-                dest = pt;
-                if (!lr)
-                    return NULL;
-                dest = pt->right;
-                Tree *rr = what->right->Do(this);
-                dest = pt;
-                if (!rr)
+                if (!Child(what->left, pt->left) ||
+                    !Child(what->right, pt->right))
                     return NULL;
-            }
             return what;
         }
         return NULL;
@@ -309,18 +317,9 @@ template <CopyMode mode> struct TreeCopyTemplate
         {
             pt->tag = ((what->Position()<<Tree::KINDBITS) | pt->Kind());
             if (mode == CM_RECURSIVE)
-            {
-                dest = pt->left;
-                Tree *lr = what->left->Do(this);
-                dest = pt;
-                if (!lr)
-                    return NULL;
-                dest = pt->right;
-                Tree *rr = what->right->Do(this);
-                dest = pt;
-                if (!rr)
+                if (!Child(what->left, pt->left) ||
+                    !Child(what->right, pt->right))
                     return NULL;
-            }
             return what;
         }
         return NULL;
@@ -329,7 +328,16 @@ template <CopyMode mode> struct TreeCopyTemplate
     {
         return what;            // ??? Should not happen
     }
-    Tree *dest;
+    Tree *Child(Tree *what, TreeChild &child)
+    {
+        Save<Tree *>      saveParent(parent, dest);
+        Save<Tree *>      saveDest(dest, child);
+        Save<TreeChild *> saveSlot(slot, &child);
+        return what->Do(this);
+    }
+    Tree *      dest;
+    Tree *      parent;         // Tree holding dest, if any
+    TreeChild * slot;           // Where dest is in parent
 };
 
 ELFE_END
@@ -0,0 +1,503 @@
+// ****************************************************************************
+//  tree-cycles.cpp                                              ELFE project
+// ****************************************************************************
+// 
+//   File Description:
+// 
+//     Backup collector for reference cycles between trees
+// 
+// 
+// 
+// 
+// 
+// 
+// 
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+//
+//  The algorithm is the trial deletion used by other reference-counted
+//  runtimes. For each non-leaf tree, we start from its reference count,
+//  and subtract the references coming from the children of other trees.
+//  What remains are references from outside the trees, i.e. from the stack,
+//  from contexts, from infos or from other garbage-collected types.
+//  Everything reachable from a tree with outside references is alive.
+//  Anything else can only be reached from a cycle, and is garbage.
+//
+//  Some pointers we cannot see, like infos pointing to trees, are counted
+//  as outside references. This makes the collector conservative: it may
+//  keep a dead cycle, but it never frees a tree referenced from outside.
+//
+//  Trees that were marked in use since the last garbage collection may be
+//  held by a C++ pointer on the stack, so they are also outside references.
+//  This is why we run at the beginning of a collection, before the scan
+//  clears that mark.
+//
+//  Listing, counting and marking the whole heap is split in steps, so that
+//  each collection only spends its time budget on it. Listed trees are held
+//  until the search ends, so that they cannot be freed between steps. Since
+//  the program changes trees between steps, what the search finds is only
+//  a list of candidates. The last step checks them again in one go, with
+//  the same algorithm restricted to the candidates, before cutting them.
+//
+
+#include "tree-cycles.h"
+#include "traces.h"
+#include "recorder.h"
+
+#include <cstdio>
+
+ELFE_BEGIN
+
+CycleCollector *CycleCollector::collector = NULL;
+
+
+CycleCollector::CycleCollector(uint interval)
+// ----------------------------------------------------------------------------
+//   Create a cycle collector running after 'interval' collections
+// ----------------------------------------------------------------------------
+    : interval(interval), collections(0),
+      phase(IDLE), allocator(0), chunk(0), cursor(0),
+      runs(0), examined(0), roots(0), found(0), duration(0)
+{
+    for (uint k = KIND_FIRST; k <= KIND_LAST; k++)
+        foundKind[k] = 0;
+}
+
+
+void CycleCollector::Install(uint interval)
+// ----------------------------------------------------------------------------
+//   Install the cycle collector as a listener for non-leaf trees
+// ----------------------------------------------------------------------------
+{
+    if (!collector)
+    {
+        collector = new CycleCollector(interval);
+        Allocator<Block>    ::Singleton()->AddListener(collector);
+        Allocator<Prefix>   ::Singleton()->AddListener(collector);
+        Allocator<Postfix>  ::Singleton()->AddListener(collector);
+        Allocator<Infix>    ::Singleton()->AddListener(collector);
+        Allocator<Array>    ::Singleton()->AddListener(collector);
+    }
+    collector->interval = interval;
+}
+
+
+void CycleCollector::BeginCollection()
+// ----------------------------------------------------------------------------
+//   Every 'interval' collections, start a search, and continue it if running
+// ----------------------------------------------------------------------------
+{
+    if (phase == IDLE)
+    {
+        if (!interval || ++collections < interval)
+            return;
+        collections = 0;
+        phase = LISTING;
+    }
+
+    uint budget = GarbageCollector::Budget();
+    ulonglong start = GarbageCollector::Microseconds();
+    bool done = Step(budget ? start + budget : 0);
+    duration += GarbageCollector::Microseconds() - start;
+    if (done)
+        Cut();
+}
+
+
+void CycleCollector::MemoryPressure()
+// ----------------------------------------------------------------------------
+//   When memory is tight, look for cycles in the next collection
+// ----------------------------------------------------------------------------
+//   We are called after the scan cleared the in-use marks, so we cannot
+//   tell which trees are held from the stack right now
+{
+    collections = interval;
+}
+
+
+int CycleCollector::Find(Tree *tree)
+// ----------------------------------------------------------------------------
+//   Find the index of a listed tree, or -1 if not a listed non-leaf
+// ----------------------------------------------------------------------------
+{
+    if (!tree)
+        return -1;
+    Index::iterator found = index.find(tree);
+    if (found == index.end())
+        return -1;
+    return (*found).second;
+}
+
+
+static inline void Children(Tree *tree, std::vector<Tree *> &children)
+// ----------------------------------------------------------------------------
+//   Return the children of a non-leaf tree or the boxed items of an array
+// ----------------------------------------------------------------------------
+{
+    children.clear();
+    switch(tree->Kind())
+    {
+    case BLOCK:
+        children.push_back(((Block *) tree)->child.Pointer());
+        break;
+    case PREFIX:
+        children.push_back(((Prefix *) tree)->left.Pointer());
+        children.push_back(((Prefix *) tree)->right.Pointer());
+        break;
+    case POSTFIX:
+        children.push_back(((Postfix *) tree)->left.Pointer());
+        children.push_back(((Postfix *) tree)->right.Pointer());
+        break;
+    case INFIX:
+        children.push_back(((Infix *) tree)->left.Pointer());
+        children.push_back(((Infix *) tree)->right.Pointer());
+        break;
+    case ARRAY:
+    {
+        TreeList &items = ((Array *) tree)->trees;
+        for (TreeList::iterator i = items.begin(); i != items.end(); i++)
+            children.push_back((*i).Pointer());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+
+static TypeAllocator *treeAllocator(uint index)
+// ----------------------------------------------------------------------------
+//   The allocators for trees that have children, NULL after the last one
+// ----------------------------------------------------------------------------
+{
+    switch(index)
+    {
+    case 0:     return Allocator<Block>     ::Singleton();
+    case 1:     return Allocator<Prefix>    ::Singleton();
+    case 2:     return Allocator<Postfix>   ::Singleton();
+    case 3:     return Allocator<Infix>     ::Singleton();
+    case 4:     return Allocator<Array>     ::Singleton();
+    default:    return NULL;
+    }
+}
+
+
+bool CycleCollector::Step(ulonglong deadline)
+// ----------------------------------------------------------------------------
+//   Advance the search until the deadline, return true when it is complete
+// ----------------------------------------------------------------------------
+//   If the deadline is zero, we run the search to completion
+{
+    Trees children;
+    uint  max = trees.size();
+    uint  checked = 0;
+
+    while (true)
+    {
+        // Check the time every now and then
+        if (deadline && (++checked & 255) == 0 &&
+            GarbageCollector::Microseconds() >= deadline)
+            return false;
+
+        switch(phase)
+        {
+        case IDLE:
+            return true;
+
+        case LISTING:
+        {
+            // List non-leaf trees, and hold them until we are done
+            TypeAllocator *listed = treeAllocator(allocator);
+            if (!listed)
+            {
+                max = trees.size();
+                refs.assign(max, 0);
+                reachable.assign(max, false);
+                phase = COUNTING;
+                cursor = 0;
+                break;
+            }
+
+            TypeAllocator::Objects objects;
+            bool done = listed->ListObjects(objects, chunk, deadline);
+            for (uint i = 0, n = objects.size(); i < n; i++)
+            {
+                // Trees in flight have no count, they are not candidates
+                Tree *tree = (Tree *) objects[i];
+                if (TypeAllocator::RefCount(tree))
+                {
+                    index[tree] = trees.size();
+                    trees.push_back(tree);
+                }
+            }
+            if (done)
+            {
+                allocator++;
+                chunk = 0;
+            }
+            else if (deadline)
+            {
+                return false;
+            }
+            break;
+        }
+
+        case COUNTING:
+            // Record the reference count, minus the one we hold
+            if (cursor < max)
+            {
+                Tree *tree = trees[cursor].Pointer();
+                refs[cursor] = TypeAllocator::RefCount(tree) - 1;
+                if (TypeAllocator::IsInUse(tree))
+                    reachable[cursor] = true;
+                cursor++;
+                break;
+            }
+            phase = SUBTRACTING;
+            cursor = 0;
+            break;
+
+        case SUBTRACTING:
+            // Subtract references from children of other trees
+            if (cursor < max)
+            {
+                Children(trees[cursor++].Pointer(), children);
+                for (uint c = 0, count = children.size(); c < count; c++)
+                {
+                    int index = Find(children[c]);
+                    if (index >= 0 && refs[index])
+                        refs[index]--;
+                }
+                break;
+            }
+            phase = MARKING;
+            cursor = 0;
+            break;
+
+        case MARKING:
+            // Mark what is reachable from trees with outside references
+            if (!stack.empty())
+            {
+                // Use an explicit stack, since trees can be very deep
+                Children(stack.back(), children);
+                stack.pop_back();
+                for (uint c = 0, count = children.size(); c < count; c++)
+                {
+                    int index = Find(children[c]);
+                    if (index >= 0 && !reachable[index])
+                    {
+                        reachable[index] = true;
+                        stack.push_back(children[c]);
+                    }
+                }
+                break;
+            }
+            if (cursor < max)
+            {
+                if (refs[cursor])
+                    reachable[cursor] = true;
+                if (reachable[cursor])
+                {
+                    roots++;
+                    stack.push_back(trees[cursor].Pointer());
+                }
+                cursor++;
+                break;
+            }
+            phase = IDLE;
+            return true;
+        }
+    }
+}
+
+
+uint CycleCollector::Cut()
+// ----------------------------------------------------------------------------
+//   Check the candidates found by the search, and break the cycles
+// ----------------------------------------------------------------------------
+//   This runs in one step, so that the program cannot change the trees
+//   while we check them. It takes a time proportional to the candidates.
+{
+    ulonglong start = GarbageCollector::Microseconds();
+
+    // Hold the candidates, and release all the other trees
+    TreePtrs garbage;
+    uint max = trees.size();
+    for (uint i = 0; i < max; i++)
+        if (!reachable[i])
+            garbage.push_back(trees[i]);
+    trees.clear();
+    index.clear();
+    refs.clear();
+    reachable.clear();
+    stack.clear();
+    allocator = 0;
+    chunk = 0;
+    cursor = 0;
+    runs++;
+    examined += max;
+
+    // Candidates that only we hold are not in a cycle, let them go
+    bool released = true;
+    while (released)
+    {
+        released = false;
+        for (uint i = 0, n = garbage.size(); i < n; i++)
+        {
+            Tree *tree = garbage[i].Pointer();
+            if (tree && TypeAllocator::RefCount(tree) == 1)
+            {
+                garbage[i] = NULL;
+                released = true;
+            }
+        }
+    }
+
+    // Run the search again on the candidates alone
+    max = 0;
+    for (uint i = 0, n = garbage.size(); i < n; i++)
+    {
+        if (Tree *tree = garbage[i].Pointer())
+        {
+            index[tree] = max;
+            garbage[max++] = tree;
+        }
+    }
+    garbage.resize(max);
+    refs.assign(max, 0);
+    reachable.assign(max, false);
+    for (uint i = 0; i < max; i++)
+    {
+        Tree *tree = garbage[i].Pointer();
+        refs[i] = TypeAllocator::RefCount(tree) - 1;
+        if (TypeAllocator::IsInUse(tree))
+            reachable[i] = true;
+    }
+    Trees children;
+    for (uint i = 0; i < max; i++)
+    {
+        Children(garbage[i].Pointer(), children);
+        for (uint c = 0, count = children.size(); c < count; c++)
+        {
+            int index = Find(children[c]);
+            if (index >= 0 && refs[index])
+                refs[index]--;
+        }
+    }
+    for (uint i = 0; i < max; i++)
+    {
+        if (refs[i])
+            reachable[i] = true;
+        if (reachable[i])
+            stack.push_back(garbage[i].Pointer());
+    }
+    while (!stack.empty())
+    {
+        Children(stack.back(), children);
+        stack.pop_back();
+        for (uint c = 0, count = children.size(); c < count; c++)
+        {
+            int index = Find(children[c]);
+            if (index >= 0 && !reachable[index])
+            {
+                reachable[index] = true;
+                stack.push_back(children[c]);
+            }
+        }
+    }
+
+    // What remains is only reachable from cycles: cut it
+    uint cut = 0;
+    for (uint i = 0; i < max; i++)
+    {
+        if (reachable[i])
+            continue;
+
+        Tree *tree = garbage[i].Pointer();
+        foundKind[tree->Kind()]++;
+        cut++;
+
+        // No reachable tree contains it, so no cached hash depends on it
+        switch(tree->Kind())
+        {
+        case BLOCK:
+            ((Block *) tree)->child.Replace(NULL);
+            break;
+        case PREFIX:
+            ((Prefix *) tree)->left.Replace(NULL);
+            ((Prefix *) tree)->right.Replace(NULL);
+            break;
+        case POSTFIX:
+            ((Postfix *) tree)->left.Replace(NULL);
+            ((Postfix *) tree)->right.Replace(NULL);
+            break;
+        case INFIX:
+            ((Infix *) tree)->left.Replace(NULL);
+            ((Infix *) tree)->right.Replace(NULL);
+            break;
+        case ARRAY:
+            ((Array *) tree)->trees.clear();
+            break;
+        default:
+            break;
+        }
+    }
+    index.clear();
+    refs.clear();
+    reachable.clear();
+
+    // Releasing the garbage now frees it through reference counting
+    garbage.clear();
+
+    ulonglong elapsed = GarbageCollector::Microseconds() - start;
+    found += cut;
+    duration += elapsed;
+
+    MEMORY("Cycle collection checked %u candidates, %u garbage in %lluus",
+           max, cut, elapsed);
+    IFTRACE(memory)
+        printf("Cycle collection: checked %u candidates, %u garbage, %lluus\n",
+               max, cut, elapsed);
+    return cut;
+}
+
+
+void CycleCollector::PrintStatistics()
+// ----------------------------------------------------------------------------
+//   Print statistics about what the cycle collector found
+// ----------------------------------------------------------------------------
+{
+    static kstring names[] = { "integer", "real", "text", "name",
+                               "block", "prefix", "postfix", "infix",
+                               "array" };
+    printf("%24s %8s %8s %8s %8s %8s\n",
+           "CYCLES", "RUNS", "EXAMINED", "ROOTS", "FOUND", "USEC");
+    printf("%24s %8u %8u %8u %8u %8llu\n",
+           "Trees", runs, examined, roots, found, duration);
+    for (uint k = KIND_NLEAF_FIRST; k <= KIND_LAST; k++)
+        printf("%24s %8s %8s %8s %8u %8s\n",
+               names[k], "", "", "", foundKind[k], "");
+}
+
+ELFE_END
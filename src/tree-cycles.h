@@ -0,0 +1,103 @@
+#ifndef TREE_CYCLES_H
+#define TREE_CYCLES_H
+// ****************************************************************************
+//  tree-cycles.h                                                 ELFE project
+// ****************************************************************************
+// 
+//   File Description:
+// 
+//     Backup collector for reference cycles between trees
+// 
+//     Reference counting alone cannot reclaim a closure whose scope refers
+//     back to the closure itself, e.g. a local function stored in the
+//     scope it captures. Every few collections, the cycle collector looks
+//     for groups of trees that are only referenced from one another, and
+//     breaks them so that reference counting can free them.
+//     The search is split in steps that fit in the collector's time budget.
+// 
+// 
+// 
+// 
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "tree.h"
+#include <map>
+
+ELFE_BEGIN
+
+
+struct CycleCollector : TypeAllocator::Listener
+// ----------------------------------------------------------------------------
+//   Find and break unreachable cycles after some garbage collections
+// ----------------------------------------------------------------------------
+//   A search runs in steps at the beginning of collections, each limited
+//   by the time budget of the garbage collector.
+{
+    CycleCollector(uint interval);
+
+    virtual void                BeginCollection();
+    virtual void                MemoryPressure();
+    uint                        Found()         { return found; }
+    void                        PrintStatistics();
+
+    static CycleCollector *     Singleton()     { return collector; }
+    static void                 Install(uint interval);
+
+private:
+    enum Phase { IDLE, LISTING, COUNTING, SUBTRACTING, MARKING };
+    typedef std::vector<Tree *>         Trees;
+    typedef std::vector<Tree_p>         TreePtrs;
+    typedef std::map<Tree *, uint>      Index;
+    bool                        Step(ulonglong deadline);
+    uint                        Cut();
+    int                         Find(Tree *tree);
+
+private:
+    static CycleCollector *     collector;
+
+    uint                        interval;       // Collections between runs
+    uint                        collections;    // Collections since last run
+    Phase                       phase;          // Current step of the search
+    uint                        allocator;      // Allocator being listed
+    uint                        chunk;          // Chunk being listed
+    uint                        cursor;         // Tree being examined
+    TreePtrs                    trees;          // Listed non-leaf trees
+    Index                       index;          // Position of listed trees
+    std::vector<uint>           refs;           // External references
+    std::vector<bool>           reachable;      // Marked from outside
+    Trees                       stack;          // Trees left to mark
+
+    // Statistics
+    uint                        runs;
+    uint                        examined;
+    uint                        roots;
+    uint                        found;
+    uint                        foundKind[KIND_LAST+1];
+    ulonglong                   duration;
+};
+
+ELFE_END
+
+#endif // TREE_CYCLES_H
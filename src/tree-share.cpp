@@ -0,0 +1,210 @@
+// ****************************************************************************
+//  tree-share.cpp                                                ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Hash-consing table for constant leaves
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "tree-share.h"
+#include "atomic.h"
+
+#include <vector>
+#include <string.h>
+
+
+ELFE_BEGIN
+
+typedef std::vector<Tree *>     SharedTable;
+uint                            SharedLeaves::limit = 0;
+static uint                     sharedCount = 0;
+static Atomic<uint>             sharedLock  = 0;
+
+
+static SharedTable &sharedTable()
+// ----------------------------------------------------------------------------
+//   Open-addressing hash table of shared leaves, size is a power of 2
+// ----------------------------------------------------------------------------
+{
+    static SharedTable table(256, (Tree *) NULL);
+    return table;
+}
+
+
+static inline uint sharedHash(kstring t, size_t length, uint hash)
+// ----------------------------------------------------------------------------
+//   FNV-1a hash of some bytes
+// ----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (byte) t[i]) * 16777619U;
+    return hash;
+}
+
+
+static uint sharedHash(Tree *leaf)
+// ----------------------------------------------------------------------------
+//   Hash the kind and value of a leaf, ignoring its position
+// ----------------------------------------------------------------------------
+{
+    uint hash = 2166136261U ^ leaf->Kind();
+    switch(leaf->Kind())
+    {
+    case INTEGER:
+    {
+        Integer::value_t value = ((Integer *) leaf)->value;
+        return sharedHash((kstring) &value, sizeof(value), hash);
+    }
+    case REAL:
+    {
+        Real::value_t value = ((Real *) leaf)->value;
+        return sharedHash((kstring) &value, sizeof(value), hash);
+    }
+    case TEXT:
+    {
+        Text *t = (Text *) leaf;
+        kstring open = t->opening.c_str();
+        hash = sharedHash((kstring) &open, sizeof(open), hash);
+        Text::value_t &value = t->Value();
+        return sharedHash(value.data(), value.length(), hash);
+    }
+    case NAME:
+    {
+        Name *n = (Name *) leaf;
+        return sharedHash(n->value.data(), n->value.length(), hash);
+    }
+    default:
+        break;
+    }
+    return hash;
+}
+
+
+static bool sharedEqual(Tree *left, Tree *right)
+// ----------------------------------------------------------------------------
+//   Check if two leaves can share a node
+// ----------------------------------------------------------------------------
+//   Reals are compared bit for bit, so that -0.0 and 0.0 remain distinct
+{
+    if (left->Kind() != right->Kind())
+        return false;
+    if (left->Kind() == REAL)
+        return memcmp(&((Real *) left)->value, &((Real *) right)->value,
+                      sizeof(Real::value_t)) == 0;
+    return Tree::Equal(left, right, false);
+}
+
+
+static Tree *sharedLookup(Tree *leaf, bool insert)
+// ----------------------------------------------------------------------------
+//   Find an equal leaf in the table, possibly enter the input if not found
+// ----------------------------------------------------------------------------
+//   Must be called with the lock held
+{
+    SharedTable &shared = sharedTable();
+    uint mask = shared.size() - 1;
+    uint index = sharedHash(leaf) & mask;
+    while (Tree *found = shared[index])
+    {
+        if (sharedEqual(found, leaf))
+            return found;
+        index = (index + 1) & mask;
+    }
+    if (!insert)
+        return leaf;
+
+    // Shared leaves are never freed
+    TypeAllocator::Acquire(leaf);
+    shared[index] = leaf;
+
+    // Keep the table at most half full
+    if (2 * ++sharedCount > mask)
+    {
+        SharedTable larger(2 * (mask + 1), (Tree *) NULL);
+        uint largerMask = larger.size() - 1;
+        for (uint i = 0; i <= mask; i++)
+        {
+            if (Tree *entry = shared[i])
+            {
+                uint e = sharedHash(entry);
+                while (larger[e & largerMask])
+                    e++;
+                larger[e & largerMask] = entry;
+            }
+        }
+        shared.swap(larger);
+    }
+    return leaf;
+}
+
+
+Tree *SharedLeaves::Share(Tree *leaf)
+// ----------------------------------------------------------------------------
+//   Return the shared node equal to the given leaf, entering it if needed
+// ----------------------------------------------------------------------------
+{
+    if (!limit || !leaf || !leaf->IsLeaf())
+        return leaf;
+
+    while (!sharedLock.SetQ(0, 1)) {}
+    bool insert = leaf->IsConstant() && sharedCount < limit;
+    Tree *result = sharedLookup(leaf, insert);
+    sharedLock.SetQ(1, 0);
+    return result;
+}
+
+
+void SharedLeaves::Enter(Name *name)
+// ----------------------------------------------------------------------------
+//   Enter a builtin name, so that names with the same value share it
+// ----------------------------------------------------------------------------
+{
+    if (!limit)
+        return;
+
+    while (!sharedLock.SetQ(0, 1)) {}
+    sharedLookup(name, true);
+    sharedLock.SetQ(1, 0);
+}
+
+
+void SharedLeaves::SetLimit(uint max)
+// ----------------------------------------------------------------------------
+//   Set the maximum number of shared constants, 0 to disable sharing
+// ----------------------------------------------------------------------------
+{
+    limit = max;
+}
+
+ELFE_END
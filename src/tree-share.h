@@ -0,0 +1,64 @@
+#ifndef TREE_SHARE_H
+#define TREE_SHARE_H
+// ****************************************************************************
+//  tree-share.h                                                  ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Hash-consing of constant leaves, so that equal constants share a node
+//
+//     Constants built at run time, e.g. when code is received from another
+//     process or compiled into bytecode, often repeat the same values.
+//     When enabled, these constants are looked up in a table holding one
+//     node per distinct value. Shared nodes are never freed and keep the
+//     position of the first occurrence, so sharing is off by default.
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "tree.h"
+
+ELFE_BEGIN
+
+struct SharedLeaves
+// ----------------------------------------------------------------------------
+//   Table of constant leaves shared by all trees that use them
+// ----------------------------------------------------------------------------
+//   Integer, Real and Text leaves are entered on first use, up to 'limit'.
+//   Names are only shared with builtin names such as 'nil' or 'true',
+//   since code compiled for a name depends on the scope it appears in.
+{
+    static Tree *       Share(Tree *leaf);
+    static void         Enter(Name *name);
+    static void         SetLimit(uint limit);
+    static bool         Enabled()               { return limit != 0; }
+
+private:
+    static uint         limit;
+};
+
+ELFE_END
+
+#endif // TREE_SHARE_H
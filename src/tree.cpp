@@ -41,29 +41,28 @@ ELFE_BEGIN
 // ============================================================================
 
 TreePosition Tree::NOWHERE = Tree::UNKNOWN_POSITION;
+Atomic<uint> Tree::hashEpoch = TreeHash::FIRST_EPOCH;
+Atomic<bool> Tree::hashCached = false;
 kstring Tree::kindName[KIND_COUNT] =
 // ----------------------------------------------------------------------------
 //   The names of the tree kinds for debugging purpose
 // ----------------------------------------------------------------------------
 {
     "INTEGER", "REAL", "TEXT", "NAME",   
-    "BLOCK", "PREFIX", "POSTFIX", "INFIX"
+    "BLOCK", "PREFIX", "POSTFIX", "INFIX",
+    "ARRAY"
 };
 
 
 Tree::~Tree()
 // ----------------------------------------------------------------------------
-//   Delete the hash if we have one
+//   Delete the information attached to the tree if we have any
 // ----------------------------------------------------------------------------
 {
-    Info *next = NULL;
-    assert (info != (Info *) 0xD00DEL && "Please report this in bug #922");
-    for (Info *i = info; i; i = next)
-    {
-        ELFE_ASSERT(i->owner == this);
-        next = i->next;
-        i->Delete();
-    }
+    InfoSlots *slots = info;
+    assert (slots != (InfoSlots *) 0xD00DEL &&
+            "Please report this in bug #922");
+    delete slots;
 }
 
 
@@ -78,10 +77,63 @@ Tree::operator text()
 }
 
 
+static int compareStructure(Tree *left, Tree *right, bool recurse);
+
+
 int Tree::Compare(Tree *left, Tree *right, bool recurse)
 // ----------------------------------------------------------------------------
 //   Return true if two trees are equal
 // ----------------------------------------------------------------------------
+//   Trees are ordered by kind, then by structural hash, then by structure.
+//   The hash is used the same way for all non-leaf trees, including mutable
+//   trees and arrays whose hash is not cached, so that this is a strict
+//   weak ordering, e.g. for TreeOrder. It is only computed at the top,
+//   since trees with the same hash are very likely equal. Leaves are
+//   cheaper to compare directly.
+{
+    if (left == right)
+        return 0;
+    if (!left)
+        return -4;
+    if (!right)
+        return 4;
+
+    kind lk = left->Kind();
+    kind rk = right->Kind();
+    if (lk != rk)
+        return lk < rk ? -3 : 3;
+
+    if (recurse && lk > KIND_LEAF_LAST)
+    {
+        uint lh = Hash(left);
+        uint rh = Hash(right);
+        if (lh != rh)
+            return lh < rh ? -2 : 2;
+    }
+    return compareStructure(left, right, recurse);
+}
+
+
+static inline int compareDelimiters(const itext &lo, const itext &lc,
+                                    const itext &ro, const itext &rc)
+// ----------------------------------------------------------------------------
+//   Order the delimiters of two texts or blocks, opening first
+// ----------------------------------------------------------------------------
+{
+    if (lo != ro)
+        return lo < ro ? -2 : 2;
+    if (lc != rc)
+        return lc < rc ? -2 : 2;
+    return 0;
+}
+
+
+static int compareStructure(Tree *left, Tree *right, bool recurse)
+// ----------------------------------------------------------------------------
+//   Order two trees of the same kind by their contents
+// ----------------------------------------------------------------------------
+//   NaN is equal to itself and after all other reals, so that this remains
+//   an ordering. Children are compared by structure only.
 {
     if (left == right)
         return 0;
@@ -107,17 +159,22 @@ int Tree::Compare(Tree *left, Tree *right, bool recurse)
     {
         Real *lr = (Real *) left;
         Real *rr = (Real *) right;
+        bool lnan = lr->value != lr->value;
+        bool rnan = rr->value != rr->value;
+        if (lnan || rnan)
+            return lnan == rnan ? 0 : lnan ? 1 : -1;
         return lr->value < rr->value ? -1 : lr->value > rr->value ? 1 : 0;
     }
     case TEXT:
     {
         Text *lt = (Text *) left;
         Text *rt = (Text *) right;
-        if (lt->opening < rt->opening || lt->closing < rt->closing)
-            return -2;
-        if (lt->opening > rt->opening || lt->closing > rt->closing)
-            return  2;
-        return lt->value < rt->value ? -1 : lt->value > rt->value ? 1 : 0;
+        if (int cmpDelim = compareDelimiters(lt->opening, lt->closing,
+                                             rt->opening, rt->closing))
+            return cmpDelim;
+        Text::value_t &lv = lt->Value();
+        Text::value_t &rv = rt->Value();
+        return lv < rv ? -1 : lv > rv ? 1 : 0;
     }
     case NAME:
     {
@@ -135,9 +192,9 @@ int Tree::Compare(Tree *left, Tree *right, bool recurse)
             return 2;
         if (recurse)
         {
-            if (int cmpLeft = Compare(li->left, ri->left))
+            if (int cmpLeft = compareStructure(li->left, ri->left, true))
                 return cmpLeft;
-            if (int cmpRight = Compare(li->right, ri->right))
+            if (int cmpRight = compareStructure(li->right, ri->right, true))
                 return cmpRight;
         }
         return 0;
@@ -148,9 +205,9 @@ int Tree::Compare(Tree *left, Tree *right, bool recurse)
         Prefix *rp = (Prefix *) right;
         if (recurse)
         {
-            if (int cmpLeft = Compare(lp->left, rp->left))
+            if (int cmpLeft = compareStructure(lp->left, rp->left, true))
                 return cmpLeft;
-            if (int cmpRight = Compare(lp->right, rp->right))
+            if (int cmpRight = compareStructure(lp->right, rp->right, true))
                 return cmpRight;
         }
         return 0;
@@ -161,9 +218,9 @@ int Tree::Compare(Tree *left, Tree *right, bool recurse)
         Postfix *rp = (Postfix *) right;
         if (recurse)
         {
-            if (int cmpLeft = Compare(lp->left, rp->left))
+            if (int cmpLeft = compareStructure(lp->left, rp->left, true))
                 return cmpLeft;
-            if (int cmpRight = Compare(lp->right, rp->right))
+            if (int cmpRight = compareStructure(lp->right, rp->right, true))
                 return cmpRight;
         }
         return 0;
@@ -172,13 +229,61 @@ int Tree::Compare(Tree *left, Tree *right, bool recurse)
     {
         Block *lb = (Block *) left;
         Block *rb = (Block *) right;
-        if (lb->opening < rb->opening || lb->closing < rb->closing)
-            return -2;
-        if (lb->opening > rb->opening || lb->closing > rb->closing)
-            return  2;
+        if (int cmpDelim = compareDelimiters(lb->opening, lb->closing,
+                                             rb->opening, rb->closing))
+            return cmpDelim;
         if (!recurse)
             return 0;
-        return Compare(lb->child, rb->child);
+        return compareStructure(lb->child, rb->child, true);
+    }
+    case ARRAY:
+    {
+        Array *la = (Array *) left;
+        Array *ra = (Array *) right;
+        if (la->packing != ra->packing)
+            return la->packing < ra->packing ? -2 : 2;
+        size_t ll = la->Length();
+        size_t rl = ra->Length();
+        if (ll != rl)
+            return ll < rl ? -2 : 2;
+        if (!recurse)
+            return 0;
+        for (size_t i = 0; i < ll; i++)
+        {
+            switch(la->packing)
+            {
+            case Array::INTEGERS:
+            {
+                longlong lv = la->integers[i];
+                longlong rv = ra->integers[i];
+                if (lv != rv)
+                    return lv < rv ? -1 : 1;
+                break;
+            }
+            case Array::REALS:
+            {
+                double lv = la->reals[i];
+                double rv = ra->reals[i];
+                bool lnan = lv != lv;
+                bool rnan = rv != rv;
+                if (lnan || rnan)
+                {
+                    if (lnan != rnan)
+                        return lnan ? 1 : -1;
+                    break;
+                }
+                if (lv < rv || lv > rv)
+                    return lv < rv ? -1 : 1;
+                break;
+            }
+            case Array::TREES:
+                if (int cmpItem = compareStructure(la->trees[i],
+                                                   ra->trees[i], true))
+                    return cmpItem;
+                break;
+            }
+        }
+        return 0;
     }
     }
 
@@ -186,6 +291,144 @@ int Tree::Compare(Tree *left, Tree *right, bool recurse)
 }
 
 
+static inline uint hashMix(uint hash, uint value)
+// ----------------------------------------------------------------------------
+//   Combine a value into a hash
+// ----------------------------------------------------------------------------
+{
+    hash = (hash ^ value) * 0x9E3779B1U;
+    return hash ^ (hash >> 15);
+}
+
+
+static inline uint hashText(uint hash, const text &t)
+// ----------------------------------------------------------------------------
+//   FNV-1a hash of a text value
+// ----------------------------------------------------------------------------
+{
+    for (size_t i = 0, length = t.length(); i < length; i++)
+        hash = (hash ^ (byte) t[i]) * 16777619U;
+    return hash;
+}
+
+
+static inline uint hashPointer(uint hash, const void *ptr)
+// ----------------------------------------------------------------------------
+//   Hash an interned delimiter or operator name by its address
+// ----------------------------------------------------------------------------
+{
+    uintptr_t bits = (uintptr_t) ptr;
+    return hashMix(hashMix(hash, (uint) bits), (uint) (bits >> 16 >> 16));
+}
+
+
+static uint treeHash(Tree *tree, bool &cacheable)
+// ----------------------------------------------------------------------------
+//   Compute the structural hash, caching it if the tree is not mutable
+// ----------------------------------------------------------------------------
+{
+    if (!tree)
+        return 0;
+
+    kind k = tree->Kind();
+    uint hash = hashMix(2166136261U, k);
+    switch(k)
+    {
+    case INTEGER:
+    {
+        ulonglong value = ((Integer *) tree)->value;
+        hash = hashMix(hash, (uint) value);
+        return hashMix(hash, (uint) (value >> 32));
+    }
+    case REAL:
+        return hash;
+    case TEXT:
+    {
+        Text *t = (Text *) tree;
+        hash = hashPointer(hash, &t->opening.str());
+        hash = hashPointer(hash, &t->closing.str());
+        return hashText(hash, t->Value());
+    }
+    case NAME:
+        return hashText(hash, ((Name *) tree)->value);
+    case ARRAY:
+        // Arrays change in place, so trees containing them are not cached
+        cacheable = false;
+        return hashMix(hash, (uint) ((Array *) tree)->Length());
+    default:
+        break;
+    }
+
+    TreeHash *cache = Tree::HashCache(tree);
+    if (cache->epoch == Tree::hashEpoch)
+        return cache->value;
+
+    bool children = true;
+    switch(k)
+    {
+    case BLOCK:
+    {
+        Block *b = (Block *) tree;
+        hash = hashPointer(hash, &b->opening.str());
+        hash = hashPointer(hash, &b->closing.str());
+        hash = hashMix(hash, treeHash(b->child, children));
+        break;
+    }
+    case PREFIX:
+    {
+        Prefix *p = (Prefix *) tree;
+        hash = hashMix(hash, treeHash(p->left, children));
+        hash = hashMix(hash, treeHash(p->right, children));
+        break;
+    }
+    case POSTFIX:
+    {
+        Postfix *p = (Postfix *) tree;
+        hash = hashMix(hash, treeHash(p->left, children));
+        hash = hashMix(hash, treeHash(p->right, children));
+        break;
+    }
+    case INFIX:
+    {
+        Infix *i = (Infix *) tree;
+        hash = hashPointer(hash, &i->name.str());
+        hash = hashMix(hash, treeHash(i->left, children));
+        hash = hashMix(hash, treeHash(i->right, children));
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (!children || cache->epoch == TreeHash::MUTABLE)
+    {
+        // Trees containing mutable trees are considered mutable
+        cache->epoch = TreeHash::MUTABLE;
+        cacheable = false;
+    }
+    else if (Tree::Hashing())
+    {
+        cache->value = hash;
+        cache->epoch = Tree::hashEpoch;
+        Tree::hashCached = true;
+    }
+    return hash;
+}
+
+
+uint Tree::Hash(Tree *tree)
+// ----------------------------------------------------------------------------
+//   Return a structural hash for the tree, ignoring positions
+// ----------------------------------------------------------------------------
+//   Equal trees (as per Compare) have equal hashes. Hashes of non-leaf trees
+//   are computed on demand and kept until some tree child is reassigned.
+//   All reals hash the same, so that 0.0 and -0.0, which are equal, do too.
+{
+    bool cacheable = true;
+    return treeHash(tree, cacheable);
+}
+
+
 void Tree::SetPosition(TreePosition pos, bool recurse)
 // ----------------------------------------------------------------------------
 //   Set the position for the tree and possibly its children
@@ -224,10 +467,444 @@ void Tree::SetPosition(TreePosition pos, bool recurse)
 }
 
 
-text Block::indent   = "I+";
-text Block::unindent = "I-";
-text Text::textQuote = "\"";
-text Text::charQuote = "'";
+void Tree::ShiftPositions(TreePosition offset)
+// ----------------------------------------------------------------------------
+//   Move the positions of a tree and its children by the given offset
+// ----------------------------------------------------------------------------
+//   This is for trees parsed with positions of their own, e.g. in another
+//   thread. Nodes without a position are left alone. Long infix chains
+//   nest deeply on the left, so the left children are kept in a vector.
+{
+    std::vector<Tree *> pending;
+    Tree *tree = this;
+    while (tree)
+    {
+        if ((long) tree->Position() >= 0)
+            tree->tag += offset << KINDBITS;
+        switch(tree->Kind())
+        {
+        case INFIX:
+            pending.push_back(((Infix *) tree)->left);
+            tree = ((Infix *) tree)->right;
+            break;
+        case PREFIX:
+            pending.push_back(((Prefix *) tree)->left);
+            tree = ((Prefix *) tree)->right;
+            break;
+        case POSTFIX:
+            pending.push_back(((Postfix *) tree)->right);
+            tree = ((Postfix *) tree)->left;
+            break;
+        case BLOCK:
+            tree = ((Block *) tree)->child;
+            break;
+        default:
+            tree = NULL;
+            break;
+        }
+        if (!tree && !pending.empty())
+        {
+            tree = pending.back();
+            pending.pop_back();
+        }
+    }
+}
+
+
+itext Block::indent   = "I+";
+itext Block::unindent = "I-";
+itext Block::openParen   = "(";
+itext Block::closeParen  = ")";
+itext Block::openBrace   = "{";
+itext Block::closeBrace  = "}";
+itext Block::openSquare  = "[";
+itext Block::closeSquare = "]";
+itext Text::textQuote = "\"";
+itext Text::charQuote = "'";
+itext Infix::rewrite   = "->";
+itext Infix::assign    = ":=";
+itext Infix::colon     = ":";
+itext Infix::as        = "as";
+itext Infix::when      = "when";
+itext Infix::semicolon = ";";
+itext Infix::newline   = "\n";
+itext Infix::comma     = ",";
+itext Infix::dot       = ".";
+itext Infix::bar       = "|";
+
+
+
+// ============================================================================
+//
+//    Pool of small integers
+//
+// ============================================================================
+
+Integer **      Integer::pool     = NULL;
+Integer::value_t Integer::poolLow = 0;
+ulonglong       Integer::poolSize = 0;
+
+
+void Integer::MakePool(value_t low, value_t high)
+// ----------------------------------------------------------------------------
+//   Preallocate immortal integers from low to high-1
+// ----------------------------------------------------------------------------
+//   The pool is built once, before evaluation starts, and never released.
+//   Pooled nodes have no position, so they are only used for computed values
+{
+    if (pool || high <= low)
+        return;
+
+    ulonglong size = high - low;
+    Integer **nodes = new Integer *[size];
+    for (ulonglong i = 0; i < size; i++)
+    {
+        nodes[i] = new Integer(low + (value_t) i);
+        TypeAllocator::Acquire(nodes[i]);
+    }
+    pool = nodes;
+    poolLow = low;
+    poolSize = size;
+}
+
+
+// ============================================================================
+//
+//    Arrays
+//
+// ============================================================================
+
+Tree *Array::Item(size_t index)
+// ----------------------------------------------------------------------------
+//   Return the item at the given index, boxing unboxed numbers
+// ----------------------------------------------------------------------------
+{
+    switch(packing)
+    {
+    case INTEGERS:      return Integer::Make(integers[index]);
+    case REALS:         return new Real(reals[index]);
+    case TREES:         return trees[index];
+    }
+    return NULL;
+}
+
+
+void Array::Append(Tree *item)
+// ----------------------------------------------------------------------------
+//   Add an item at the end, switching to boxed trees if the kind differs
+// ----------------------------------------------------------------------------
+//   An empty array adopts the packing of its first item
+{
+    kind k = item->Kind();
+    if (Length() == 0)
+        packing = k == INTEGER ? INTEGERS : k == REAL ? REALS : TREES;
+
+    if (packing == INTEGERS && k == INTEGER)
+    {
+        integers.push_back(((Integer *) item)->value);
+        return;
+    }
+    if (packing == REALS && k == REAL)
+    {
+        reals.push_back(((Real *) item)->value);
+        return;
+    }
+
+    if (packing != TREES)
+    {
+        // Box the existing items before adding one of a different kind
+        size_t length = Length();
+        trees.reserve(length + 1);
+        for (size_t i = 0; i < length; i++)
+            trees.push_back(Item(i));
+        integers.clear();
+        reals.clear();
+        packing = TREES;
+    }
+    trees.push_back(item);
+}
+
+
+Array *Array::Slice(size_t first, size_t count)
+// ----------------------------------------------------------------------------
+//   Return a new array with 'count' items starting at 'first'
+// ----------------------------------------------------------------------------
+{
+    Array *result = new Array(Position());
+    result->packing = packing;
+    switch(packing)
+    {
+    case INTEGERS:
+        result->integers.assign(integers.begin() + first,
+                                integers.begin() + first + count);
+        break;
+    case REALS:
+        result->reals.assign(reals.begin() + first,
+                             reals.begin() + first + count);
+        break;
+    case TREES:
+        // Go through Append so that a slice of numbers is unboxed again
+        for (size_t i = 0; i < count; i++)
+            result->Append(trees[first + i]);
+        break;
+    }
+    return result;
+}
+
+
+
+// ============================================================================
+//
+//    Ropes for large texts
+//
+// ============================================================================
+
+uint Text::ropeLength = 256;
+
+
+struct TextPieces
+// ----------------------------------------------------------------------------
+//   Walk the flat pieces of a text from left to right, without recursion
+// ----------------------------------------------------------------------------
+//   Ropes built by repeated appends are deep, so we use an explicit stack
+{
+    TextPieces(Text *text): stack(1, text) {}
+    Text::value_t *Next()
+    {
+        while (!stack.empty())
+        {
+            Text *top = stack.back();
+            stack.pop_back();
+            if (!top->rope)
+                return &top->value;
+            stack.push_back(top->rope->right);
+            stack.push_back(top->rope->left);
+        }
+        return NULL;
+    }
+    std::vector<Text *> stack;
+};
+
+
+Text *Text::Concat(Text *left, Text *right, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   Concatenate two texts, building a rope if the result is large
+// ----------------------------------------------------------------------------
+//   Short pieces appended or prepended to a rope are merged with its first
+//   or last piece, so that ropes built a few characters at a time stay
+//   reasonably shallow
+{
+    size_t length = left->Length() + right->Length();
+    if (!ropeLength || length < ropeLength)
+        return new Text(left->Value() + right->Value(), pos);
+
+    if (TextRope *lr = left->rope)
+    {
+        Text *last = lr->right;
+        if (!right->rope && !last->rope &&
+            last->value.length() + right->value.length() < ropeLength)
+        {
+            Text *merged = new Text(last->value + right->value, pos);
+            return new Text(new TextRope(lr->left, merged), pos);
+        }
+    }
+    if (TextRope *rr = right->rope)
+    {
+        Text *first = rr->left;
+        if (!left->rope && !first->rope &&
+            left->value.length() + first->value.length() < ropeLength)
+        {
+            Text *merged = new Text(left->value + first->value, pos);
+            return new Text(new TextRope(merged, rr->right), pos);
+        }
+    }
+    return new Text(new TextRope(left, right), pos);
+}
+
+
+void Text::Flatten()
+// ----------------------------------------------------------------------------
+//   Replace a rope with the contiguous text it represents
+// ----------------------------------------------------------------------------
+{
+    if (!rope)
+        return;
+
+    text result;
+    result.reserve(rope->length);
+    TextPieces pieces(this);
+    while (Text::value_t *piece = pieces.Next())
+        result.append(piece->data(), piece->length());
+    value = result;
+
+    delete rope;
+    rope = NULL;
+}
+
+
+size_t Text::Find(const value_t &what, size_t offset)
+// ----------------------------------------------------------------------------
+//   Find a text in a rope without flattening it
+// ----------------------------------------------------------------------------
+//   We keep the last few characters of previous pieces in 'carry' to find
+//   matches that straddle the boundary between two pieces
+{
+    if (!rope)
+        return value.find(what, offset);
+
+    size_t size = what.length();
+    if (size == 0)
+        return offset <= rope->length ? offset : text::npos;
+
+    text carry;
+    size_t base = 0;
+    TextPieces pieces(this);
+    while (Text::value_t *piece = pieces.Next())
+    {
+        size_t end = base + piece->length();
+        if (end > offset)
+        {
+            // Matches starting in the carry, i.e. in a previous piece
+            if (carry.length())
+            {
+                size_t start = base - carry.length();
+                text joined = carry + piece->substr(0, size - 1);
+                size_t skip = offset > start ? offset - start : 0;
+                size_t found = joined.find(what.data(), skip, size);
+                if (found != text::npos)
+                    return start + found;
+            }
+
+            // Matches entirely within this piece
+            size_t skip = offset > base ? offset - base : 0;
+            size_t found = piece->find(what, skip);
+            if (found != text::npos)
+                return base + found;
+        }
+
+        // Keep the size-1 last characters for the next boundary
+        if (piece->length() >= size - 1)
+            carry = piece->substr(piece->length() - (size - 1));
+        else if (carry.append(piece->data(), piece->length()).length() >= size)
+            carry.erase(0, carry.length() - (size - 1));
+        base = end;
+    }
+    return text::npos;
+}
+
+
+std::ostream &Text::Write(std::ostream &out)
+// ----------------------------------------------------------------------------
+//   Write the text piece by piece
+// ----------------------------------------------------------------------------
+{
+    TextPieces pieces(this);
+    while (Text::value_t *piece = pieces.Next())
+        out << *piece;
+    return out;
+}
+
+
+// ============================================================================
+//
+//    Information attached to trees
+//
+// ============================================================================
+
+InfoSlots::InfoSlots()
+// ----------------------------------------------------------------------------
+//   Start with empty slots
+// ----------------------------------------------------------------------------
+{
+    for (uint s = 0; s < Info::SLOT_COUNT; s++)
+        slots[s] = NULL;
+}
+
+
+InfoSlots::~InfoSlots()
+// ----------------------------------------------------------------------------
+//   Delete all the information, which the list owns
+// ----------------------------------------------------------------------------
+{
+    Info *next = NULL;
+    for (Info *i = slots[Info::OTHER_SLOT]; i; i = next)
+    {
+        next = i->next;
+        i->Delete();
+    }
+}
+
+
+void InfoSlots::Insert(Info *info)
+// ----------------------------------------------------------------------------
+//   Put the information in the list, and make it current in its slots
+// ----------------------------------------------------------------------------
+{
+    LinkedListInsert(slots[Info::OTHER_SLOT], info);
+
+    uint mask = info->Slots();
+    for (uint s = 0; s < Info::OTHER_SLOT; s++)
+    {
+        if (mask & (1U << s))
+        {
+            Info *old;
+            do
+            {
+                old = slots[s];
+            } while (!slots[s].SetQ(old, info));
+        }
+    }
+}
+
+
+bool InfoSlots::Unlink(Info *info)
+// ----------------------------------------------------------------------------
+//   Remove the information, return true if it was found
+// ----------------------------------------------------------------------------
+//   A slot that pointed to it gets the most recent older info for that slot
+{
+    if (!UnlinkOther(info))
+        return false;
+
+    uint mask = info->Slots();
+    for (uint s = 0; s < Info::OTHER_SLOT; s++)
+    {
+        if ((mask & (1U << s)) && slots[s] == info)
+        {
+            Info *older = slots[Info::OTHER_SLOT];
+            while (older && !(older->Slots() & (1U << s)))
+                older = older->next;
+            slots[s].SetQ(info, older);
+        }
+    }
+    return true;
+}
+
+
+bool InfoSlots::UnlinkOther(Info *info)
+// ----------------------------------------------------------------------------
+//   Remove information from the list of all information
+// ----------------------------------------------------------------------------
+{
+retry:
+    Info *prev = NULL;
+    for (Info *i = slots[Info::OTHER_SLOT]; i; i = i->next)
+    {
+        if (i == info)
+        {
+            Info *next = i->next;
+            if (!Atomic<Info *>::SetQ(i->next, next, NULL))
+                goto retry;
+            if (!Atomic<Info *>::SetQ(prev ? prev->next
+                                           : slots[Info::OTHER_SLOT],
+                                      i, next))
+                goto retry;
+            return true;
+        }
+        prev = i;
+    }
+    return false;
+}
 
 ELFE_END
 
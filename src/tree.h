@@ -27,6 +27,8 @@
 #include "base.h"
 #include "gc.h"
 #include "info.h"
+#include "interned.h"
+#include "ctext.h"
 #include <map>
 
 #include <vector>
@@ -51,7 +53,11 @@ struct Block;                                   // Block: (A), {A}
 struct Prefix;                                  // Prefix: sin X
 struct Postfix;                                 // Postfix: 3!
 struct Infix;                                   // Infix: A+B, newline
+struct Array;                                   // Array: array (1, 2, 3)
 struct Info;                                    // Information in trees
+struct InfoSlots;                               // All information for a tree
+struct TreeHash;                                // Cached structural hash
+struct TextRope;                                // Pending text concatenation
 struct Context;                                 // Execution context
 
 
@@ -71,6 +77,7 @@ typedef GCPtr<Block>                    Block_p;
 typedef GCPtr<Prefix>                   Prefix_p;
 typedef GCPtr<Postfix>                  Postfix_p;
 typedef GCPtr<Infix>                    Infix_p;
+typedef GCPtr<Array>                    Array_p;
 typedef Prefix                          Scope;
 
 typedef ulong TreePosition;                     // Position in source files
@@ -92,9 +99,10 @@ enum kind
 {
     INTEGER, REAL, TEXT, NAME,                  // Leaf nodes
     BLOCK, PREFIX, POSTFIX, INFIX,              // Non-leaf nodes
+    ARRAY,                                      // Runtime-only values
 
     KIND_FIRST          = INTEGER,
-    KIND_LAST           = INFIX,
+    KIND_LAST           = ARRAY,
     KIND_LEAF_FIRST     = INTEGER,
     KIND_LEAF_LAST      = NAME,
     KIND_NLEAF_FIRST    = BLOCK,
@@ -111,7 +119,7 @@ struct Tree
 //   The base class for all ELFE trees
 // ----------------------------------------------------------------------------
 {
-    enum { KINDBITS = 3, KINDMASK=7 };
+    enum { KINDBITS = 4, KINDMASK=15 };
     enum { UNKNOWN_POSITION = ~0UL, COMMAND_LINE=~1UL, BUILTIN=~2UL };
     typedef Tree        self_t;
     typedef Tree *      value_t;
@@ -138,6 +146,7 @@ struct Tree
     bool                IsLeaf()              { return Kind() <= NAME; }
     bool                IsConstant()          { return Kind() <= TEXT; }
     void                SetPosition(TreePosition pos, bool recurse = true);
+    void                ShiftPositions(TreePosition offset);
 
     // Safe cast to an appropriate subclass
     template<class T>
@@ -150,6 +159,7 @@ struct Tree
     Infix *             AsInfix();
     Prefix *            AsPrefix();
     Postfix *           AsPostfix();
+    Array *             AsArray();
     Tree *              AsTree();
 
 
@@ -162,6 +172,7 @@ struct Tree
     template<class I>    bool                Purge();
     template<class I>    I*                  Remove();
     template<class I>    I*                  Remove(I *);
+    InfoSlots *                              Infos();
 
     // Conversion to text
                         operator text();
@@ -169,21 +180,74 @@ struct Tree
 public:
     static int          Compare(Tree *t1, Tree *t2, bool recurse = true);
     static bool         Equal(Tree *t1, Tree *t2, bool recurse = true);
+    static uint         Hash(Tree *t);
+    static bool         Hashing()       { return hashEpoch != HASH_OFF; }
+    static void         Changed();
+    static void         Changed(Tree *t);
+    static void         Mutable(Tree *t);
+    static TreeHash *   HashCache(Tree *t);
 
 public:
     ulong               tag;                            // Position + kind
-    Atomic<Info *>      info;                           // Information for tree
+    Atomic<InfoSlots *> info;                           // Information for tree
 
     static TreePosition NOWHERE;
     GARBAGE_COLLECT(Tree);
     static kstring      kindName[KIND_COUNT];
 
+    // Cached structural hashes are valid only for the current epoch
+    enum { HASH_OFF = ~0U };
+    static Atomic<uint> hashEpoch;
+    static Atomic<bool> hashCached;
+
 private:
     Tree (const Tree &);
 };
 
 
 
+struct TreeHash
+// ----------------------------------------------------------------------------
+//   Structural hash cached in a non-leaf tree
+// ----------------------------------------------------------------------------
+{
+    enum { UNKNOWN, MUTABLE, FIRST_EPOCH };
+    TreeHash(): value(0), epoch(UNKNOWN) {}
+    uint                value;
+    uint                epoch;
+};
+
+
+struct TreeChild : Tree_p
+// ----------------------------------------------------------------------------
+//   A child of a non-leaf tree, only replaced with the tree that holds it
+// ----------------------------------------------------------------------------
+//   Trees built through a plain Tree_p * (e.g. lists in the runtime) are new
+//   and cannot have a cached hash yet, so they do not need to go through this
+{
+    TreeChild(Tree *t = NULL): Tree_p(t) {}
+    TreeChild(const Tree_p &t): Tree_p(t) {}
+    TreeChild(const TreeChild &t): Tree_p(t) {}
+
+    // Replace the child of 'parent', dropping hashes that may include it
+    void Set(Tree *parent, Tree *t)
+    {
+        if (pointer != t)
+        {
+            Tree::Changed(parent);
+            Assign(pointer, t);
+        }
+    }
+
+    // Replace the child of a tree marked with Tree::Mutable or unreachable
+    void Replace(Tree *t)               { Assign(pointer, t); }
+
+private:
+    TreeChild &operator=(const TreeChild &);
+};
+
+
+
 // ============================================================================
 //
 //   Leaf nodes (integer, real, name, text)
@@ -205,6 +269,14 @@ struct Integer : Tree
     value_t  value;
     operator value_t()         { return value; }
 
+    // Shared immortal nodes for small values, which have no position
+    static Integer *    Make(value_t i, TreePosition pos = NOWHERE);
+    static void         MakePool(value_t low, value_t high);
+    bool                IsPooled();
+    static Integer **   pool;
+    static value_t      poolLow;
+    static ulonglong    poolSize;
+
     GARBAGE_COLLECT(Integer);
 };
 
@@ -234,32 +306,59 @@ struct Text : Tree
 {
     static const kind KIND = TEXT;
     typedef Text self_t;
-    typedef text value_t;
+    typedef ctext value_t;
     
-    Text(value_t t, text open="\"", text close="\"", TreePosition pos=NOWHERE):
-        Tree(TEXT, pos), value(t), opening(open), closing(close) {}
+    Text(value_t t, itext open=textQuote, itext close=textQuote,
+         TreePosition pos=NOWHERE):
+        Tree(TEXT, pos), value(t), opening(open), closing(close), rope(0) {}
     Text(value_t t, TreePosition pos):
-        Tree(TEXT, pos), value(t), opening(textQuote), closing(textQuote) {}
-    Text(Text *t):
-        Tree(TEXT, t),
-        value(t->value), opening(t->opening), closing(t->closing) {}
+        Tree(TEXT, pos), value(t), opening(textQuote), closing(textQuote),
+        rope(0) {}
+    Text(TextRope *rope, TreePosition pos):
+        Tree(TEXT, pos), opening(textQuote), closing(textQuote), rope(rope) {}
+    Text(Text *t);
+    ~Text();
     value_t             value;
-    text                opening, closing;
-    static text         textQuote, charQuote;
-    operator value_t()  { return value; }
+    itext               opening, closing;
+    TextRope *          rope;
+    static itext        textQuote, charQuote;
+    static uint         ropeLength;
+    operator value_t()  { return Value(); }
+    operator text()     { return Value(); }
     bool IsCharacter()
     {
         return
             opening == charQuote &&
             closing == charQuote &&
+            !rope &&
             value.length() == 1;
     }
     bool IsText()       { return !IsCharacter(); }
 
+    // Ropes: concatenations of large texts are only copied when needed
+    static Text *       Concat(Text *left, Text *right, TreePosition pos);
+    value_t &           Value()         { if (rope) Flatten(); return value; }
+    size_t              Length();
+    size_t              Find(const value_t &what, size_t offset = 0);
+    std::ostream &      Write(std::ostream &out);
+    void                Flatten();
+
     GARBAGE_COLLECT(Text);
 };
 
 
+struct TextRope
+// ----------------------------------------------------------------------------
+//   The two halves of a text built by concatenation, see Text::Concat
+// ----------------------------------------------------------------------------
+{
+    TextRope(Text *left, Text *right)
+        : left(left), right(right), length(left->Length()+right->Length()) {}
+    Text_p              left, right;
+    size_t              length;
+};
+
+
 struct Name : Tree
 // ----------------------------------------------------------------------------
 //   A node representing a name or symbol
@@ -267,7 +366,7 @@ struct Name : Tree
 {
     static const kind KIND = NAME;
     typedef Name self_t;
-    typedef text value_t;
+    typedef ctext value_t;
     
     Name(value_t n, TreePosition pos = NOWHERE):
         Tree(NAME, pos), value(n) {}
@@ -279,6 +378,7 @@ struct Name : Tree
     bool        IsBoolean()     { return value=="true" || value=="false"; }
     value_t     value;
     operator    value_t()       { return value; }
+    operator    text()          { return value; }
     GARBAGE_COLLECT(Name);
 };
 
@@ -299,19 +399,22 @@ struct Block : Tree
     typedef Block       self_t;
     typedef Block *     value_t;
 
-    Block(Tree *c, text open, text close, TreePosition pos = NOWHERE):
+    Block(Tree *c, itext open, itext close, TreePosition pos = NOWHERE):
         Tree(BLOCK, pos), child(c), opening(open), closing(close) {}
     Block(Block *b, Tree *ch):
         Tree(BLOCK, b),
         child(ch), opening(b->opening), closing(b->closing) {}
     bool IsIndent()     { return opening == indent && closing == unindent; }
-    bool IsParentheses(){ return opening == "(" && closing == ")"; }
-    bool IsBraces()     { return opening == "{" && closing == "}"; }
-    bool IsSquare()     { return opening == "[" && closing == "]"; }
+    bool IsParentheses(){ return opening==openParen && closing==closeParen; }
+    bool IsBraces()     { return opening==openBrace && closing==closeBrace; }
+    bool IsSquare()     { return opening==openSquare && closing==closeSquare; }
     bool IsGroup()      { return IsIndent() || IsParentheses() || IsBraces(); }
-    Tree_p              child;
-    text                opening, closing;
-    static text         indent, unindent;
+    TreeChild           child;
+    itext               opening, closing;
+    TreeHash            hash;
+    static itext        indent, unindent;
+    static itext        openParen, closeParen, openBrace, closeBrace;
+    static itext        openSquare, closeSquare;
     GARBAGE_COLLECT(Block);
 };
 
@@ -329,8 +432,9 @@ struct Prefix : Tree
         Tree(PREFIX, pos), left(l), right(r) {}
     Prefix(Prefix *p, Tree *l, Tree *r):
         Tree(PREFIX, p), left(l), right(r) {}
-    Tree_p               left;
-    Tree_p               right;
+    TreeChild           left;
+    TreeChild           right;
+    TreeHash            hash;
     GARBAGE_COLLECT(Prefix);
 };
 
@@ -348,8 +452,9 @@ struct Postfix : Tree
         Tree(POSTFIX, pos), left(l), right(r) {}
     Postfix(Postfix *p, Tree *l, Tree *r):
         Tree(POSTFIX, p), left(l), right(r) {}
-    Tree_p              left;
-    Tree_p              right;
+    TreeChild           left;
+    TreeChild           right;
+    TreeHash            hash;
     GARBAGE_COLLECT(Postfix);
 };
 
@@ -363,19 +468,62 @@ struct Infix : Tree
     typedef Infix       self_t;
     typedef Infix *     value_t;
 
-    Infix(text n, Tree *l, Tree *r, TreePosition pos = NOWHERE):
+    Infix(itext n, Tree *l, Tree *r, TreePosition pos = NOWHERE):
         Tree(INFIX, pos), left(l), right(r), name(n) {}
     Infix(Infix *i, Tree *l, Tree *r):
         Tree(INFIX, i), left(l), right(r), name(i->name) {}
-    bool                IsDeclaration() { return name == "->"; }
-    Tree_p              left;
-    Tree_p              right;
-    text                name;
+    bool                IsDeclaration() { return name == rewrite; }
+    TreeChild           left;
+    TreeChild           right;
+    itext               name;
+    TreeHash            hash;
+
+    // Names the evaluator checks for, compared by pointer
+    static itext        rewrite, assign, colon, as, when;
+    static itext        semicolon, newline, comma, dot, bar;
     GARBAGE_COLLECT(Infix);
 };
 
 
 
+// ============================================================================
+//
+//   Arrays, built at runtime only
+//
+// ============================================================================
+
+struct Array : Tree
+// ----------------------------------------------------------------------------
+//   A packed sequence of values with constant-time indexing
+// ----------------------------------------------------------------------------
+//   As long as all items are integers or all items are reals, they are
+//   kept unboxed in 'integers' or 'reals'. Any other mix is kept in 'trees'.
+//   Arrays are not parsed, they are only created by the 'array' builtin
+{
+    static const kind KIND = ARRAY;
+    typedef Array       self_t;
+    typedef Array *     value_t;
+    enum packing { INTEGERS, REALS, TREES };
+
+    Array(TreePosition pos = NOWHERE):
+        Tree(ARRAY, pos), packing(INTEGERS) {}
+    Array(Array *a):
+        Tree(ARRAY, a), packing(a->packing),
+        integers(a->integers), reals(a->reals), trees(a->trees) {}
+    size_t              Length();
+    Tree *              Item(size_t index);
+    void                Append(Tree *item);
+    Array *             Slice(size_t first, size_t count);
+
+    packing             packing;
+    std::vector<longlong> integers;
+    std::vector<double> reals;
+    TreeList            trees;
+    GARBAGE_COLLECT(Array);
+};
+
+
+
 // ============================================================================
 //
 //    Safe casts
@@ -422,9 +570,76 @@ inline Block   *Tree::AsBlock()         { return As<Block>(); }
 inline Prefix  *Tree::AsPrefix()        { return As<Prefix>(); }
 inline Postfix *Tree::AsPostfix()       { return As<Postfix>(); }
 inline Infix   *Tree::AsInfix()         { return As<Infix>(); }
+inline Array   *Tree::AsArray()         { return As<Array>(); }
 inline Tree    *Tree::AsTree()          { return As<Tree>(); }
 
 
+inline Integer *Integer::Make(value_t i, TreePosition pos)
+// ----------------------------------------------------------------------------
+//   Return a shared node for values in the pool, a new one otherwise
+// ----------------------------------------------------------------------------
+//   Only the shared nodes lose the position, other values keep it
+{
+    ulonglong index = (ulonglong) i - (ulonglong) poolLow;
+    if (index < poolSize)
+        return pool[index];
+    return new Integer(i, pos);
+}
+
+
+inline bool Integer::IsPooled()
+// ----------------------------------------------------------------------------
+//   Check if this is a shared node, whose value must never change
+// ----------------------------------------------------------------------------
+{
+    ulonglong index = (ulonglong) value - (ulonglong) poolLow;
+    return index < poolSize && pool[index] == this;
+}
+
+
+inline Text::Text(Text *t)
+// ----------------------------------------------------------------------------
+//   Copy a text, sharing the halves of a rope rather than flattening it
+// ----------------------------------------------------------------------------
+    : Tree(TEXT, t),
+      value(t->value), opening(t->opening), closing(t->closing),
+      rope(t->rope ? new TextRope(t->rope->left, t->rope->right) : 0)
+{}
+
+
+inline Text::~Text()
+// ----------------------------------------------------------------------------
+//   Release the halves of a rope
+// ----------------------------------------------------------------------------
+{
+    delete rope;
+}
+
+
+inline size_t Array::Length()
+// ----------------------------------------------------------------------------
+//   Number of items in the array, whatever the packing
+// ----------------------------------------------------------------------------
+{
+    switch(packing)
+    {
+    case INTEGERS:      return integers.size();
+    case REALS:         return reals.size();
+    case TREES:         return trees.size();
+    }
+    return 0;
+}
+
+
+inline size_t Text::Length()
+// ----------------------------------------------------------------------------
+//   Length of a text, without flattening it
+// ----------------------------------------------------------------------------
+{
+    return rope ? rope->length : value.length();
+}
+
+
 
 // ============================================================================
 // 
@@ -448,6 +663,7 @@ typename Action::value_type Tree::Do(Action *action)
     case PREFIX:        return action->DoPrefix((Prefix *) this);
     case POSTFIX:       return action->DoPostfix((Postfix *) this);
     case INFIX:         return action->DoInfix((Infix *) this);
+    case ARRAY:         return action->DoArray((Array *) this);
     default:            assert(!"Unexpected tree kind");
     }
     return typename Action::value_type();
@@ -463,6 +679,69 @@ inline bool Tree::Equal(Tree *t1, Tree *t2, bool recurse)
 }
 
 
+inline void Tree::Changed()
+// ----------------------------------------------------------------------------
+//   Some tree changed in place: drop cached hashes if some were computed
+// ----------------------------------------------------------------------------
+//   We cannot find the parents of the tree that changed, so we move to
+//   the next epoch. If we ever run out of epochs, we stop caching hashes
+{
+    if (hashCached.SetQ(true, false))
+    {
+        uint epoch = hashEpoch;
+        if (epoch != HASH_OFF)
+            hashEpoch.SetQ(epoch, epoch + 1);
+    }
+}
+
+
+inline TreeHash *Tree::HashCache(Tree *tree)
+// ----------------------------------------------------------------------------
+//   Return the hash cache for non-leaf trees, NULL for leaves
+// ----------------------------------------------------------------------------
+{
+    switch(tree->Kind())
+    {
+    case BLOCK:         return &((Block *) tree)->hash;
+    case PREFIX:        return &((Prefix *) tree)->hash;
+    case POSTFIX:       return &((Postfix *) tree)->hash;
+    case INFIX:         return &((Infix *) tree)->hash;
+    default:            return NULL;
+    }
+}
+
+
+inline void Tree::Changed(Tree *tree)
+// ----------------------------------------------------------------------------
+//   A child or the name of 'tree' is about to change
+// ----------------------------------------------------------------------------
+//   Computing the hash of a tree caches the hash of its non-leaf children,
+//   so only a tree with a hash for the current epoch can be part of other
+//   cached hashes. In that case, the tree is now known to change in place.
+{
+    if (TreeHash *cache = HashCache(tree))
+        if (cache->epoch == hashEpoch)
+            Mutable(tree);
+}
+
+
+inline void Tree::Mutable(Tree *tree)
+// ----------------------------------------------------------------------------
+//   Mark a tree whose children are replaced in place, e.g. symbol tables
+// ----------------------------------------------------------------------------
+//   The hash of a mutable tree or of trees containing it is never cached,
+//   so its children can be changed with TreeChild::Replace without
+//   invalidating all other cached hashes
+{
+    if (TreeHash *cache = HashCache(tree))
+    {
+        if (cache->epoch == hashEpoch)
+            Changed();
+        cache->epoch = TreeHash::MUTABLE;
+    }
+}
+
+
 
 // ============================================================================
 //
@@ -470,14 +749,31 @@ inline bool Tree::Equal(Tree *t1, Tree *t2, bool recurse)
 //
 // ============================================================================
 
+inline InfoSlots *Tree::Infos()
+// ----------------------------------------------------------------------------
+//   Return the information slots for the tree, create them if needed
+// ----------------------------------------------------------------------------
+{
+    InfoSlots *slots = info;
+    if (!slots)
+    {
+        InfoSlots *created = new InfoSlots;
+        if (info.SetQ(NULL, created))
+            return created;
+        delete created;
+        slots = info;
+    }
+    return slots;
+}
+
+
 template <class I> inline typename I::data_t Tree::Get() const
 // ----------------------------------------------------------------------------
 //   Find if we have an information of the right type in 'info'
 // ----------------------------------------------------------------------------
 {
-    for (Info *i = info; i; i = i->next)
-        if (I *ic = dynamic_cast<I *> (i))
-            return (typename I::data_t) *ic;
+    if (I *ic = GetInfo<I>())
+        return (typename I::data_t) *ic;
     return typename I::data_t();
 }
 
@@ -490,7 +786,7 @@ template <class I> inline void Tree::Set(typename I::data_t data)
     Info *i = new I(data);
     // The info can only be owned by a single tree, should not be linked
     ELFE_ASSERT(Atomic<Tree *>::SetQ(i->owner, NULL, this));
-    LinkedListInsert(info, i);
+    Infos()->Insert(i);
 }
 
 
@@ -498,10 +794,10 @@ template <class I> inline I* Tree::GetInfo() const
 // ----------------------------------------------------------------------------
 //   Find if we have an information of the right type in 'info'
 // ----------------------------------------------------------------------------
+//   For the kinds of info that have a slot, this is a direct lookup
 {
-    for (Info *i = info; i; i = i->next)
-        if (I *ic = dynamic_cast<I *> (i))
-            return ic;
+    if (InfoSlots *slots = info)
+        return slots->Find<I>();
     return NULL;
 }
 
@@ -516,7 +812,7 @@ template <class I> inline void Tree::SetInfo(I *i)
     ELFE_ASSERT(!i->Info::next);
     
     Info *asInfo = i;           // For proper deduction if I is a derived class
-    LinkedListInsert(info, asInfo);
+    Infos()->Insert(asInfo);
 }
 
 
@@ -525,10 +821,7 @@ template <class I> inline bool Tree::Exists() const
 //   Verifies if the tree already has information of the given type
 // ----------------------------------------------------------------------------
 {
-    for (Info *i = info; i; i = i->next)
-        if (dynamic_cast<I *> (i))
-            return true;
-    return false;
+    return GetInfo<I>() != NULL;
 }
 
 
@@ -537,27 +830,11 @@ template <class I> inline bool Tree::Purge()
 //   Find and purge information of the given type
 // ----------------------------------------------------------------------------
 {
-retry:
-    Info *prev = NULL;
-    Info *next = NULL;
     bool purged = false;
-    for (Info *i = info; i; i = next)
+    while (I *ic = Remove<I>())
     {
-        next = i->next;
-        if (I *ic = dynamic_cast<I *> (i))
-        {
-            if (!Atomic<Info *>::SetQ(i->next, next, NULL))
-                goto retry;
-            if (!Atomic<Info *>::SetQ(prev ? prev->next : info, i, next))
-                goto retry;
-            ELFE_ASSERT(Atomic<Tree *>::SetQ(i->owner, this, NULL));
-            ic->Delete();
-            purged = true;
-        }
-        else
-        {
-            prev = i;
-        }
+        ic->Delete();
+        purged = true;
     }
     return purged;
 }
@@ -568,21 +845,16 @@ template <class I> inline I* Tree::Remove()
 //   Find information and unlinks it if it exists
 // ----------------------------------------------------------------------------
 {
-retry:
-    Info *prev = NULL;
-    for (Info *i = info; i; i = i->next)
+    InfoSlots *slots = info;
+    if (!slots)
+        return NULL;
+    while (I *ic = slots->Find<I>())
     {
-        if (I *ic = dynamic_cast<I *> (i))
+        if (slots->Unlink(ic))
         {
-            Info *next = i->next;
-            if (!Atomic<Info *>::SetQ(i->next, next, NULL))
-                goto retry;
-            if (!Atomic<Info *>::SetQ(prev ? prev->next : info, i, next))
-                goto retry;
-            ELFE_ASSERT(Atomic<Tree *>::SetQ(i->owner, this, NULL));
+            ELFE_ASSERT(Atomic<Tree *>::SetQ(ic->owner, this, NULL));
             return ic;
         }
-        prev = i;
     }
     return NULL;
 }
@@ -593,22 +865,11 @@ template <class I> inline I* Tree::Remove(I *toFind)
 //   Find information matching input and remove it if it exists
 // ----------------------------------------------------------------------------
 {
-retry:
-    Info *prev = NULL;
-    for (Info *i = info; i; i = i->next)
+    InfoSlots *slots = info;
+    if (slots && toFind && slots->Unlink(toFind))
     {
-        I *ic = dynamic_cast<I *> (i);
-        if (ic == toFind)
-        {
-            Info *next = i->next;
-            if (!Atomic<Info *>::SetQ(i->next, next, NULL))
-                goto retry;
-            if (!Atomic<Info *>::SetQ(prev ? prev->next : info, i, next))
-                goto retry;
-            ELFE_ASSERT(Atomic<Tree *>::SetQ(i->owner, this, NULL));
-            return ic;
-        }
-        prev = i;
+        ELFE_ASSERT(Atomic<Tree *>::SetQ(toFind->owner, this, NULL));
+        return toFind;
     }
     return NULL;
 }
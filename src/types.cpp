@@ -173,6 +173,15 @@ bool Types::DoText(Text *what)
 }
 
 
+bool Types::DoArray(Array *what)
+// ----------------------------------------------------------------------------
+//   Arrays are runtime values, treat them like constants
+// ----------------------------------------------------------------------------
+{
+    return DoConstant(what);
+}
+
+
 bool Types::DoConstant(Tree *what)
 // ----------------------------------------------------------------------------
 //   All constants have themselves as type, and evaluate normally
@@ -238,7 +247,7 @@ bool Types::DoInfix(Infix *what)
 {
     // For a sequence, both sub-expressions must succeed individually.
     // The type of the sequence is the type of the last statement
-    if (what->name == "\n" || what->name == ";")
+    if (what->name == Infix::newline || what->name == Infix::semicolon)
     {
         // Assign types to left and right
         if (!AssignType(what))
@@ -247,14 +256,14 @@ bool Types::DoInfix(Infix *what)
     }
 
     // Case of 'X : T' : Set type of X to T and unify X:T with X
-    if (what->name == ":" || what->name == "as")
+    if (what->name == Infix::colon || what->name == Infix::as)
         return (AssignType(what->left, what->right) &&
                 what->left->Do(this) &&
                 AssignType(what) &&
                 UnifyExpressionTypes(what, what->left));
 
     // Case of 'X -> Y': Analyze type of X and Y, unify them, set type of result
-    if (what->name == "->")
+    if (what->name == Infix::rewrite)
         return Rewrite(what);
 
     // For other cases, we assign types to left and right
@@ -347,7 +356,7 @@ bool Types::Rewrite(Infix *what)
     // The type of the definition is a pattern type, perform unification
     if (Infix *infix = what->left->AsInfix())
     {
-        if (infix->name == ":" || what->name == "as")
+        if (infix->name == Infix::colon || what->name == Infix::as)
         {
             // Explicit type declaration
             if (!Unify(valueType, infix->right, what->right, infix->right))
@@ -739,7 +748,7 @@ bool Types::UnifyPatterns(Tree *t1, Tree *t2)
     case TEXT:
         if (Text *x1 = t1->AsText())
             if (Text *x2 = t2->AsText())
-                return x1->value == x2->value;
+                return x1->Value() == x2->Value();
         return false;
 
     case NAME:
@@ -815,7 +824,7 @@ bool Types::UnifyPatternAndValue(Tree *pat, Tree *val)
     case TEXT:
         if (Text *x1 = pat->AsText())
             if (Text *x2 = val->AsText())
-                return x1->value == x2->value;
+                return x1->Value() == x2->Value();
         return false;
 
     case NAME:
@@ -827,7 +836,7 @@ bool Types::UnifyPatternAndValue(Tree *pat, Tree *val)
         if (Infix *x1 = pat->AsInfix())
         {
             // Check if the pattern is a type declaration
-            if (x1->name == ":")
+            if (x1->name == Infix::colon)
                 return Unify(x1->right, val);
 
             if (Infix *x2 = val->AsInfix())
@@ -1034,7 +1043,7 @@ Tree *ValueMatchesType(Context *ctx, Tree *type, Tree *value, bool convert)
                 return rv;
     if (Text *tt = type->AsText())
         if (Text *tv = value->AsText())
-            if (tv->value == tt->value &&
+            if (tv->Value() == tt->Value() &&
                 tv->opening == tt->opening &&
                 tv->closing == tt->closing)
                 return tv;
@@ -1047,17 +1056,17 @@ Tree *ValueMatchesType(Context *ctx, Tree *type, Tree *value, bool convert)
         return ValueMatchesType(ctx, bt->child, value, convert);
     if (Infix *it = type->AsInfix())
     {
-        if (it->name == "|")
+        if (it->name == Infix::bar)
         {
             if (Tree *lfOK = ValueMatchesType(ctx, it->left, value, convert))
                 return lfOK;
             if (Tree *rtOK = ValueMatchesType(ctx, it->right, value, convert))
                 return rtOK;
         }
-        else if (it->name == "->")
+        else if (it->name == Infix::rewrite)
         {
             if (Infix *iv = value->AsInfix())
-                if (iv->name == "->")
+                if (iv->name == Infix::rewrite)
                 {
                     // REVISIT: Compare function signatures
                     Ooops("Unimplemented: "
@@ -1137,18 +1146,18 @@ Tree *TypeIntersectsType(Context *ctx, Tree *type, Tree *test, bool convert)
     // Check if test is constructed
     if (Infix *itst = test->AsInfix())
     {
-        if (itst->name == "|")
+        if (itst->name == Infix::bar)
         {
             // Does 'integer' intersect 0 | 1 ? Yes if it intersects either
             if (TypeIntersectsType(ctx, type, itst->left, convert) ||
                 TypeIntersectsType(ctx, type, itst->right, convert))
                 return test;
         }
-        else if (itst->name == "->")
+        else if (itst->name == Infix::rewrite)
         {
             if (Infix *it = type->AsInfix())
             {
-                if (it->name == "->")
+                if (it->name == Infix::rewrite)
                 {
                     // REVISIT: Coverage of function types
                     Ooops("Unimplemented: "
@@ -1172,17 +1181,17 @@ Tree *TypeIntersectsType(Context *ctx, Tree *type, Tree *test, bool convert)
         return TypeIntersectsType(ctx, bt->child, test, convert);
     if (Infix *it = type->AsInfix())
     {
-        if (it->name == "|")
+        if (it->name == Infix::bar)
         {
             if (Tree *lfOK = TypeIntersectsType(ctx, it->left, test, convert))
                 return lfOK;
             if (Tree *rtOK = TypeIntersectsType(ctx, it->right,test, convert))
                 return rtOK;
         }
-        else if (it->name == "->")
+        else if (it->name == Infix::rewrite)
         {
             if (Infix *iv = test->AsInfix())
-                if (iv->name == "->")
+                if (iv->name == Infix::rewrite)
                 {
                     // REVISIT: Compare function signatures
                     Ooops("Unimplemented: "
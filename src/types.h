@@ -106,6 +106,7 @@ public:
     bool        DoPostfix(Postfix *what);
     bool        DoInfix(Infix *what);
     bool        DoBlock(Block *what);
+    bool        DoArray(Array *what);
 
     // Common code for all constants (integer, real, text)
     bool        DoConstant(Tree *what);
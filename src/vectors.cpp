@@ -0,0 +1,537 @@
+// ****************************************************************************
+//  vectors.cpp                                                  ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Numeric reductions over arrays of unboxed integers or reals
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//  (C) 2015 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2015 Taodyne SAS
+// ****************************************************************************
+//
+//  The kernels below use AVX or SSE2 when the compiler targets them,
+//  and a scalar loop otherwise. The scalar loop also handles the items
+//  left over after the last full SIMD register.
+//
+//  Reals are processed four at a time with AVX, two at a time with SSE2.
+//  Integers only use SIMD for sums: comparing or multiplying 64-bit
+//  integers requires AVX-512, so we leave these to the compiler.
+//
+
+#include "vectors.h"
+#include "errors.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+ELFE_BEGIN
+
+// ============================================================================
+//
+//    Helpers to reduce SIMD registers
+//
+// ============================================================================
+
+#if defined(__AVX__)
+typedef __m256d real_lanes;
+const size_t REAL_LANES = 4;
+#define LANES_LOAD(p)           _mm256_loadu_pd(p)
+#define LANES_STORE(p, x)       _mm256_storeu_pd(p, x)
+#define LANES_SET(x)            _mm256_set1_pd(x)
+#define LANES_ADD(x, y)         _mm256_add_pd(x, y)
+#define LANES_SUB(x, y)         _mm256_sub_pd(x, y)
+#define LANES_MUL(x, y)         _mm256_mul_pd(x, y)
+#define LANES_MIN(x, y)         _mm256_min_pd(x, y)
+#define LANES_MAX(x, y)         _mm256_max_pd(x, y)
+#define LANES_ABOVE(x, y)       _mm256_movemask_pd(_mm256_cmp_pd(x, y, \
+                                                                 _CMP_GT_OQ))
+#elif defined(__SSE2__)
+typedef __m128d real_lanes;
+const size_t REAL_LANES = 2;
+#define LANES_LOAD(p)           _mm_loadu_pd(p)
+#define LANES_STORE(p, x)       _mm_storeu_pd(p, x)
+#define LANES_SET(x)            _mm_set1_pd(x)
+#define LANES_ADD(x, y)         _mm_add_pd(x, y)
+#define LANES_SUB(x, y)         _mm_sub_pd(x, y)
+#define LANES_MUL(x, y)         _mm_mul_pd(x, y)
+#define LANES_MIN(x, y)         _mm_min_pd(x, y)
+#define LANES_MAX(x, y)         _mm_max_pd(x, y)
+#define LANES_ABOVE(x, y)       _mm_movemask_pd(_mm_cmpgt_pd(x, y))
+#endif
+
+
+#ifdef LANES_LOAD
+static inline void lanesSpill(real_lanes lanes, double out[REAL_LANES])
+// ----------------------------------------------------------------------------
+//   Store the lanes of a register so that we can reduce them
+// ----------------------------------------------------------------------------
+{
+    LANES_STORE(out, lanes);
+}
+#endif // LANES_LOAD
+
+
+
+// ============================================================================
+//
+//    Kernels on contiguous data
+//
+// ============================================================================
+
+double elfe_vector_sum(const double *data, size_t count)
+// ----------------------------------------------------------------------------
+//   Sum of all values
+// ----------------------------------------------------------------------------
+{
+    double result = 0.0;
+    size_t i = 0;
+#ifdef LANES_LOAD
+    if (count >= REAL_LANES)
+    {
+        real_lanes sum = LANES_SET(0.0);
+        for (; i + REAL_LANES <= count; i += REAL_LANES)
+            sum = LANES_ADD(sum, LANES_LOAD(data + i));
+        double lanes[REAL_LANES];
+        lanesSpill(sum, lanes);
+        for (size_t l = 0; l < REAL_LANES; l++)
+            result += lanes[l];
+    }
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        result += data[i];
+    return result;
+}
+
+
+longlong elfe_vector_sum(const longlong *data, size_t count)
+// ----------------------------------------------------------------------------
+//   Sum of all values, wrapping around on overflow like integer addition
+// ----------------------------------------------------------------------------
+{
+    ulonglong result = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    for (; i + 4 <= count; i += 4)
+        sum = _mm256_add_epi64(sum,
+                               _mm256_loadu_si256((const __m256i *)(data+i)));
+    ulonglong lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, sum);
+    result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+    __m128i sum = _mm_setzero_si128();
+    for (; i + 2 <= count; i += 2)
+        sum = _mm_add_epi64(sum, _mm_loadu_si128((const __m128i *)(data+i)));
+    ulonglong lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, sum);
+    result = lanes[0] + lanes[1];
+#endif
+    for (; i < count; i++)
+        result += (ulonglong) data[i];
+    return (longlong) result;
+}
+
+
+double elfe_vector_min(const double *data, size_t count)
+// ----------------------------------------------------------------------------
+//   Smallest value, count must not be zero
+// ----------------------------------------------------------------------------
+{
+    double result = data[0];
+    size_t i = 1;
+#ifdef LANES_LOAD
+    if (count >= REAL_LANES)
+    {
+        real_lanes low = LANES_LOAD(data);
+        for (i = REAL_LANES; i + REAL_LANES <= count; i += REAL_LANES)
+            low = LANES_MIN(low, LANES_LOAD(data + i));
+        double lanes[REAL_LANES];
+        lanesSpill(low, lanes);
+        for (size_t l = 0; l < REAL_LANES; l++)
+            if (lanes[l] < result)
+                result = lanes[l];
+    }
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        if (data[i] < result)
+            result = data[i];
+    return result;
+}
+
+
+longlong elfe_vector_min(const longlong *data, size_t count)
+// ----------------------------------------------------------------------------
+//   Smallest value, count must not be zero
+// ----------------------------------------------------------------------------
+{
+    longlong result = data[0];
+    for (size_t i = 1; i < count; i++)
+        if (data[i] < result)
+            result = data[i];
+    return result;
+}
+
+
+double elfe_vector_max(const double *data, size_t count)
+// ----------------------------------------------------------------------------
+//   Largest value, count must not be zero
+// ----------------------------------------------------------------------------
+{
+    double result = data[0];
+    size_t i = 1;
+#ifdef LANES_LOAD
+    if (count >= REAL_LANES)
+    {
+        real_lanes high = LANES_LOAD(data);
+        for (i = REAL_LANES; i + REAL_LANES <= count; i += REAL_LANES)
+            high = LANES_MAX(high, LANES_LOAD(data + i));
+        double lanes[REAL_LANES];
+        lanesSpill(high, lanes);
+        for (size_t l = 0; l < REAL_LANES; l++)
+            if (lanes[l] > result)
+                result = lanes[l];
+    }
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        if (data[i] > result)
+            result = data[i];
+    return result;
+}
+
+
+longlong elfe_vector_max(const longlong *data, size_t count)
+// ----------------------------------------------------------------------------
+//   Largest value, count must not be zero
+// ----------------------------------------------------------------------------
+{
+    longlong result = data[0];
+    for (size_t i = 1; i < count; i++)
+        if (data[i] > result)
+            result = data[i];
+    return result;
+}
+
+
+double elfe_vector_dot(const double *x, const double *y, size_t count)
+// ----------------------------------------------------------------------------
+//   Sum of the products of corresponding values
+// ----------------------------------------------------------------------------
+{
+    double result = 0.0;
+    size_t i = 0;
+#ifdef LANES_LOAD
+    if (count >= REAL_LANES)
+    {
+        real_lanes sum = LANES_SET(0.0);
+        for (; i + REAL_LANES <= count; i += REAL_LANES)
+            sum = LANES_ADD(sum, LANES_MUL(LANES_LOAD(x + i),
+                                           LANES_LOAD(y + i)));
+        double lanes[REAL_LANES];
+        lanesSpill(sum, lanes);
+        for (size_t l = 0; l < REAL_LANES; l++)
+            result += lanes[l];
+    }
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        result += x[i] * y[i];
+    return result;
+}
+
+
+longlong elfe_vector_dot(const longlong *x, const longlong *y, size_t count)
+// ----------------------------------------------------------------------------
+//   Sum of the products of corresponding values
+// ----------------------------------------------------------------------------
+{
+    ulonglong result = 0;
+    for (size_t i = 0; i < count; i++)
+        result += (ulonglong) x[i] * (ulonglong) y[i];
+    return (longlong) result;
+}
+
+
+double elfe_vector_deviation(const double *data, size_t count, double mean)
+// ----------------------------------------------------------------------------
+//   Sum of the squared differences to the mean
+// ----------------------------------------------------------------------------
+{
+    double result = 0.0;
+    size_t i = 0;
+#ifdef LANES_LOAD
+    if (count >= REAL_LANES)
+    {
+        real_lanes center = LANES_SET(mean);
+        real_lanes sum = LANES_SET(0.0);
+        for (; i + REAL_LANES <= count; i += REAL_LANES)
+        {
+            real_lanes delta = LANES_SUB(LANES_LOAD(data + i), center);
+            sum = LANES_ADD(sum, LANES_MUL(delta, delta));
+        }
+        double lanes[REAL_LANES];
+        lanesSpill(sum, lanes);
+        for (size_t l = 0; l < REAL_LANES; l++)
+            result += lanes[l];
+    }
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        result += (data[i] - mean) * (data[i] - mean);
+    return result;
+}
+
+
+size_t elfe_vector_above(const double *data, size_t count, double limit)
+// ----------------------------------------------------------------------------
+//   Count the values strictly above the limit
+// ----------------------------------------------------------------------------
+{
+    size_t result = 0;
+    size_t i = 0;
+#ifdef LANES_LOAD
+    real_lanes threshold = LANES_SET(limit);
+    for (; i + REAL_LANES <= count; i += REAL_LANES)
+        result += __builtin_popcount(LANES_ABOVE(LANES_LOAD(data + i),
+                                                 threshold));
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        result += data[i] > limit;
+    return result;
+}
+
+
+size_t elfe_vector_above(const longlong *data, size_t count, double limit)
+// ----------------------------------------------------------------------------
+//   Count the values strictly above the limit
+// ----------------------------------------------------------------------------
+{
+    size_t result = 0;
+    for (size_t i = 0; i < count; i++)
+        result += data[i] > limit;
+    return result;
+}
+
+
+void elfe_vector_scale(double *out, const double *data, size_t count,
+                       double factor)
+// ----------------------------------------------------------------------------
+//   Multiply all values by the given factor
+// ----------------------------------------------------------------------------
+{
+    size_t i = 0;
+#ifdef LANES_LOAD
+    real_lanes scale = LANES_SET(factor);
+    for (; i + REAL_LANES <= count; i += REAL_LANES)
+        LANES_STORE(out + i, LANES_MUL(LANES_LOAD(data + i), scale));
+#endif // LANES_LOAD
+    for (; i < count; i++)
+        out[i] = data[i] * factor;
+}
+
+
+
+// ============================================================================
+//
+//    Builtins operating on arrays
+//
+// ============================================================================
+
+static Tree *notNumeric(Array *array, bool needItems = false)
+// ----------------------------------------------------------------------------
+//   Return an error if the array does not hold numbers, NULL otherwise
+// ----------------------------------------------------------------------------
+//   Operations like the mean need at least one item
+{
+    if (array->packing == Array::TREES)
+        return Ooops("The array $1 does not only contain numbers", array);
+    if (needItems && array->Length() == 0)
+        return Ooops("The array $1 is empty", array);
+    return NULL;
+}
+
+
+static double mean(Array *array)
+// ----------------------------------------------------------------------------
+//   Mean value for a non-empty numeric array
+// ----------------------------------------------------------------------------
+{
+    size_t count = array->Length();
+    if (array->packing == Array::INTEGERS)
+        return double(elfe_vector_sum(array->integers.data(), count)) / count;
+    return elfe_vector_sum(array->reals.data(), count) / count;
+}
+
+
+Tree *elfe_vector_sum(Array *array)
+// ----------------------------------------------------------------------------
+//   Sum of the items in an array, an integer for arrays of integers
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(array))
+        return error;
+    if (array->packing == Array::INTEGERS)
+        return Integer::Make(elfe_vector_sum(array->integers.data(),
+                                             array->integers.size()),
+                             array->Position());
+    return new Real(elfe_vector_sum(array->reals.data(), array->reals.size()),
+                    array->Position());
+}
+
+
+Tree *elfe_vector_mean(Array *array)
+// ----------------------------------------------------------------------------
+//   Arithmetic mean of the items in an array
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(array, true))
+        return error;
+    return new Real(mean(array), array->Position());
+}
+
+
+Tree *elfe_vector_min(Array *array)
+// ----------------------------------------------------------------------------
+//   Smallest item in an array
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(array, true))
+        return error;
+    if (array->packing == Array::INTEGERS)
+        return Integer::Make(elfe_vector_min(array->integers.data(),
+                                             array->integers.size()),
+                             array->Position());
+    return new Real(elfe_vector_min(array->reals.data(), array->reals.size()),
+                    array->Position());
+}
+
+
+Tree *elfe_vector_max(Array *array)
+// ----------------------------------------------------------------------------
+//   Largest item in an array
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(array, true))
+        return error;
+    if (array->packing == Array::INTEGERS)
+        return Integer::Make(elfe_vector_max(array->integers.data(),
+                                             array->integers.size()),
+                             array->Position());
+    return new Real(elfe_vector_max(array->reals.data(), array->reals.size()),
+                    array->Position());
+}
+
+
+Tree *elfe_vector_variance(Array *array)
+// ----------------------------------------------------------------------------
+//   Population variance of the items in an array
+// ----------------------------------------------------------------------------
+//   We compute the mean first, then the squared differences to it, which is
+//   more accurate than the difference between sum of squares and squared sum
+{
+    if (Tree *error = notNumeric(array, true))
+        return error;
+    size_t count = array->Length();
+    double center = mean(array);
+    double deviation = 0.0;
+    if (array->packing == Array::INTEGERS)
+    {
+        std::vector<double> reals(array->integers.begin(),
+                                  array->integers.end());
+        deviation = elfe_vector_deviation(reals.data(), count, center);
+    }
+    else
+    {
+        deviation = elfe_vector_deviation(array->reals.data(), count, center);
+    }
+    return new Real(deviation / count, array->Position());
+}
+
+
+Tree *elfe_vector_dot(Array *x, Array *y)
+// ----------------------------------------------------------------------------
+//   Dot product of two arrays with the same length
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(x))
+        return error;
+    if (Tree *error = notNumeric(y))
+        return error;
+    size_t count = x->Length();
+    if (y->Length() != count)
+        return Ooops("Arrays $1 and $2 have different lengths", x, y);
+
+    if (x->packing == Array::INTEGERS && y->packing == Array::INTEGERS)
+        return Integer::Make(elfe_vector_dot(x->integers.data(),
+                                             y->integers.data(), count),
+                             x->Position());
+
+    // Mixed integers and reals: compute on reals
+    std::vector<double> xr, yr;
+    const double *xd = x->reals.data();
+    const double *yd = y->reals.data();
+    if (x->packing == Array::INTEGERS)
+    {
+        xr.assign(x->integers.begin(), x->integers.end());
+        xd = xr.data();
+    }
+    if (y->packing == Array::INTEGERS)
+    {
+        yr.assign(y->integers.begin(), y->integers.end());
+        yd = yr.data();
+    }
+    return new Real(elfe_vector_dot(xd, yd, count), x->Position());
+}
+
+
+Tree *elfe_vector_scale(Array *array, double factor)
+// ----------------------------------------------------------------------------
+//   Return a new array of reals with all items multiplied by the factor
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(array))
+        return error;
+    size_t count = array->Length();
+    Array *result = new Array(array->Position());
+    result->packing = Array::REALS;
+    result->reals.resize(count);
+    if (array->packing == Array::INTEGERS)
+    {
+        std::vector<double> reals(array->integers.begin(),
+                                  array->integers.end());
+        elfe_vector_scale(result->reals.data(), reals.data(), count, factor);
+    }
+    else
+    {
+        elfe_vector_scale(result->reals.data(), array->reals.data(), count,
+                          factor);
+    }
+    return result;
+}
+
+
+Tree *elfe_vector_above(Array *array, double limit)
+// ----------------------------------------------------------------------------
+//   Number of items strictly above the given limit
+// ----------------------------------------------------------------------------
+{
+    if (Tree *error = notNumeric(array))
+        return error;
+    if (array->packing == Array::INTEGERS)
+        return Integer::Make(elfe_vector_above(array->integers.data(),
+                                               array->integers.size(), limit));
+    return Integer::Make(elfe_vector_above(array->reals.data(),
+                                           array->reals.size(), limit));
+}
+
+ELFE_END
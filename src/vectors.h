@@ -0,0 +1,56 @@
+#ifndef VECTORS_H
+#define VECTORS_H
+// ****************************************************************************
+//  vectors.h                                                    ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//    Numeric reductions over arrays of unboxed integers or reals
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//  (C) 2015 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2015 Taodyne SAS
+// ****************************************************************************
+
+#include "base.h"
+#include "tree.h"
+#include "array_module.h"
+
+ELFE_BEGIN
+
+// Kernels working on contiguous data, using SIMD instructions if available
+double   elfe_vector_sum(const double *data, size_t count);
+longlong elfe_vector_sum(const longlong *data, size_t count);
+double   elfe_vector_min(const double *data, size_t count);
+longlong elfe_vector_min(const longlong *data, size_t count);
+double   elfe_vector_max(const double *data, size_t count);
+longlong elfe_vector_max(const longlong *data, size_t count);
+double   elfe_vector_dot(const double *x, const double *y, size_t count);
+longlong elfe_vector_dot(const longlong *x, const longlong *y, size_t count);
+double   elfe_vector_deviation(const double *data, size_t count, double mean);
+size_t   elfe_vector_above(const double *data, size_t count, double limit);
+size_t   elfe_vector_above(const longlong *data, size_t count, double limit);
+void     elfe_vector_scale(double *out, const double *data, size_t count,
+                           double factor);
+
+// Builtins operating on arrays, reporting an error for non-numeric arrays
+Tree *   elfe_vector_sum(Array *array);
+Tree *   elfe_vector_mean(Array *array);
+Tree *   elfe_vector_min(Array *array);
+Tree *   elfe_vector_max(Array *array);
+Tree *   elfe_vector_variance(Array *array);
+Tree *   elfe_vector_dot(Array *x, Array *y);
+Tree *   elfe_vector_scale(Array *array, double factor);
+Tree *   elfe_vector_above(Array *array, double limit);
+
+ELFE_END
+
+#endif // VECTORS_H
@@ -0,0 +1,216 @@
+// ****************************************************************************
+//  watcher.cpp                                                   ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Find the source files that changed on disk, e.g. to reload them
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "watcher.h"
+#include "utf8_fileutils.h"
+
+#include <unistd.h>
+#ifdef CONFIG_LINUX
+#include <sys/inotify.h>
+#endif // CONFIG_LINUX
+
+
+ELFE_BEGIN
+
+FileWatcher::FileWatcher()
+// ----------------------------------------------------------------------------
+//   Create the inotify queue if we can, otherwise we will poll
+// ----------------------------------------------------------------------------
+    : notify(-1), owner(getpid()), directories(), files(), polled(0)
+{
+#ifdef CONFIG_LINUX
+    notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif // CONFIG_LINUX
+}
+
+
+FileWatcher::~FileWatcher()
+// ----------------------------------------------------------------------------
+//   Close the inotify queue
+// ----------------------------------------------------------------------------
+{
+    if (notify >= 0)
+        close(notify);
+}
+
+
+bool FileWatcher::Watch(text file)
+// ----------------------------------------------------------------------------
+//   Start watching a file, return false if it is not a regular file
+// ----------------------------------------------------------------------------
+{
+    utf8_filestat_t st;
+    if (utf8_stat(file.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+        return false;
+    files[file] = st.st_mtime;
+
+#ifdef CONFIG_LINUX
+    if (notify >= 0)
+    {
+        // Watch the directory, since the file may be replaced by a new one
+        size_t slash = file.rfind('/');
+        text   dir   = slash == text::npos ? "." : file.substr(0, slash+1);
+        text   base  = slash == text::npos ? file : file.substr(slash+1);
+        int    wd    = inotify_add_watch(notify, dir.c_str(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0)
+        {
+            directories[wd][base] = file;
+        }
+        else
+        {
+            // Out of watches: poll the times of all the files instead
+            close(notify);
+            notify = -1;
+        }
+    }
+#endif // CONFIG_LINUX
+
+    return true;
+}
+
+
+bool FileWatcher::Changed(file_set &changed)
+// ----------------------------------------------------------------------------
+//   Add the files that changed since last call, return true if there are any
+// ----------------------------------------------------------------------------
+//   This does not block. Processes forked from the one that created the
+//   watcher share its inotify queue, so they leave the events to it.
+{
+#ifdef CONFIG_LINUX
+    if (notify >= 0)
+    {
+        if (getpid() != owner)
+            return false;
+
+        union
+        {
+            struct inotify_event        event;
+            char                        bytes[4096];
+        } buffer;
+        ssize_t size;
+        bool overflow = false;
+        while ((size = read(notify, buffer.bytes, sizeof(buffer))) > 0)
+        {
+            char *next = buffer.bytes;
+            char *last = next + size;
+            while (next < last)
+            {
+                struct inotify_event *event = (struct inotify_event *) next;
+                next += sizeof(struct inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW)
+                    overflow = true;
+                if (!event->len)
+                    continue;
+
+                watch_dirs::iterator dir = directories.find(event->wd);
+                if (dir == directories.end())
+                    continue;
+                file_names &names = (*dir).second;
+                file_names::iterator name = names.find(event->name);
+                if (name != names.end())
+                    changed.insert((*name).second);
+            }
+        }
+
+        // Events were lost, check the times of all the files instead
+        if (overflow)
+            CheckTimes(changed);
+        else
+            UpdateTimes(changed);
+        return !changed.empty();
+    }
+#endif // CONFIG_LINUX
+
+    return Poll(changed);
+}
+
+
+bool FileWatcher::Poll(file_set &changed)
+// ----------------------------------------------------------------------------
+//   Check the modification time of the files, at most once per second
+// ----------------------------------------------------------------------------
+{
+    time_t now = time(NULL);
+    if (now == polled)
+        return false;
+    polled = now;
+
+    CheckTimes(changed);
+    return !changed.empty();
+}
+
+
+void FileWatcher::CheckTimes(file_set &changed)
+// ----------------------------------------------------------------------------
+//   Add the files whose modification time changed since last recorded
+// ----------------------------------------------------------------------------
+{
+    file_times::iterator f;
+    for (f = files.begin(); f != files.end(); f++)
+    {
+        utf8_filestat_t st;
+        if (utf8_stat((*f).first.c_str(), &st) < 0)
+            continue;
+        if (st.st_mtime != (*f).second)
+        {
+            (*f).second = st.st_mtime;
+            changed.insert((*f).first);
+        }
+    }
+}
+
+
+void FileWatcher::UpdateTimes(file_set &changed)
+// ----------------------------------------------------------------------------
+//   Record the modification time of files reported as changed
+// ----------------------------------------------------------------------------
+//   This way, checking times after lost events does not report them again
+{
+    file_set::iterator f;
+    for (f = changed.begin(); f != changed.end(); f++)
+    {
+        file_times::iterator found = files.find(*f);
+        utf8_filestat_t st;
+        if (found != files.end() && utf8_stat((*f).c_str(), &st) == 0)
+            (*found).second = st.st_mtime;
+    }
+}
+
+ELFE_END
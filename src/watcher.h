@@ -0,0 +1,80 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+// ****************************************************************************
+//  watcher.h                                                     ELFE project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Find the source files that changed on disk, e.g. to reload them
+//
+//     On Linux, this uses inotify on the directories holding the files,
+//     because editors often save a file by writing a new one and renaming
+//     it over the old one, which a watch on the file itself would miss.
+//     Elsewhere, or if inotify is not available, file times are polled.
+//
+// ****************************************************************************
+// This document is released under the GNU General Public License, with the
+// following clarification and exception.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library. Thus, the terms and conditions of the
+// GNU General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of this library give you
+// permission to link this library with independent modules to produce an
+// executable, regardless of the license terms of these independent modules,
+// and to copy and distribute the resulting executable under terms of your
+// choice, provided that you also meet, for each linked independent module,
+// the terms and conditions of the license of that module. An independent
+// module is a module which is not derived from or based on this library.
+// If you modify this library, you may extend this exception to your version
+// of the library, but you are not obliged to do so. If you do not wish to
+// do so, delete this exception statement from your version.
+//
+// See http://www.gnu.org/copyleft/gpl.html and Matthew 25:22 for details
+//  (C) 1992-2010 Christophe de Dinechin <christophe@taodyne.com>
+//  (C) 2010 Taodyne SAS
+// ****************************************************************************
+
+#include "base.h"
+
+#include <map>
+#include <set>
+#include <time.h>
+
+ELFE_BEGIN
+
+struct FileWatcher
+// ----------------------------------------------------------------------------
+//   Report the files that were written since the last time we asked
+// ----------------------------------------------------------------------------
+{
+    FileWatcher();
+    ~FileWatcher();
+
+    typedef std::set<text>              file_set;
+
+    bool        Watch(text file);
+    bool        Changed(file_set &changed);
+
+private:
+    bool        Poll(file_set &changed);
+    void        CheckTimes(file_set &changed);
+    void        UpdateTimes(file_set &changed);
+
+private:
+    typedef std::map<text, time_t>      file_times;
+    typedef std::map<text, text>        file_names;
+    typedef std::map<int, file_names>   watch_dirs;
+
+    int         notify;         // inotify descriptor, -1 when polling
+    int         owner;          // Process reading the inotify events
+    watch_dirs  directories;    // Watched files, by directory and base name
+    file_times  files;          // Modification time of the watched files
+    time_t      polled;         // Last time we polled file times
+};
+
+ELFE_END
+
+#endif // WATCHER_H